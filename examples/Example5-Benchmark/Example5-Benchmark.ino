@@ -0,0 +1,134 @@
+/*
+  Benchmarking the Library Functions
+  SparkFun Electronics
+  Date: October 18th, 2026
+  License: This code is public domain but you buy me a beer if you use this and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/15801
+
+  This example measures the cost of the main library functions: the time each one takes
+  (using micros()), the number of I2C transactions and the number of bytes sent on the bus.
+  From the byte count it also estimates the time spent on the bus at 100kHz and 400kHz.
+
+  The results are printed as a table, followed by one "BENCH," line per function that
+  can be copied into a spreadsheet or a script to compare library versions.
+
+  Note: write() erases and reprograms the NVM of the STUSB4500, which has a limited number
+  of write cycles. It is skipped unless BENCHMARK_NVM_WRITE is set to 1 below.
+
+  Quick-start:
+  - Use a SparkFun RedBoard Qwiic -or- attach the Qwiic Shield to your Arduino/Photon/ESP32 or other
+  - Upload the sketch
+  - Plug the Power Delivery Board onto the RedBoard/shield
+  - Open the serial monitor and set the baud rate to 115200
+*/
+
+// Include the SparkFun STUSB4500 library.
+// Click here to get the library: http://librarymanager/All#SparkFun_STUSB4500
+
+#include <Wire.h>
+#include <SparkFun_STUSB4500.h>
+
+#define BENCHMARK_NVM_WRITE 0
+
+STUSB4500 usb;
+
+uint32_t startTime;
+
+void startMeasurement()
+{
+  usb.clearBusStatistics();
+  startTime = micros();
+}
+
+void endMeasurement(const char *name)
+{
+  uint32_t elapsed = micros() - startTime;
+  uint32_t transactions = usb.getTransactionCount();
+  uint32_t bytes = usb.getByteCount();
+
+  // Each byte is 8 data bits plus an ACK bit
+  uint32_t bus100k = bytes * 9 * 10;   // microseconds at 100kHz
+  uint32_t bus400k = bytes * 9 * 10 / 4; // microseconds at 400kHz
+
+  Serial.print(name);
+  Serial.print(":\t");
+  Serial.print(elapsed);
+  Serial.print(" us, ");
+  Serial.print(transactions);
+  Serial.print(" transactions, ");
+  Serial.print(bytes);
+  Serial.print(" bytes, bus time ");
+  Serial.print(bus100k);
+  Serial.print(" us @100kHz / ");
+  Serial.print(bus400k);
+  Serial.println(" us @400kHz");
+
+  // Machine-readable summary: name,elapsed_us,transactions,bytes,bus_us_100k,bus_us_400k
+  Serial.print("BENCH,");
+  Serial.print(name);
+  Serial.print(",");
+  Serial.print(elapsed);
+  Serial.print(",");
+  Serial.print(transactions);
+  Serial.print(",");
+  Serial.print(bytes);
+  Serial.print(",");
+  Serial.print(bus100k);
+  Serial.print(",");
+  Serial.println(bus400k);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Wire.begin(); //Join I2C bus
+
+  delay(500);
+
+  startMeasurement();
+  if(!usb.begin())
+  {
+    Serial.println("Cannot connect to STUSB4500.");
+    Serial.println("Is the board connected? Is the device ID correct?");
+    while(1);
+  }
+  endMeasurement("begin");
+
+  startMeasurement();
+  usb.read();
+  endMeasurement("read");
+
+  startMeasurement();
+  float voltage = usb.getVoltage(2);
+  endMeasurement("getVoltage");
+
+  startMeasurement();
+  usb.setVoltage(2, voltage);
+  endMeasurement("setVoltage");
+
+  startMeasurement();
+  usb.getPdoNumber();
+  endMeasurement("getPdoNumber");
+
+  STUSB4500_Status status;
+  startMeasurement();
+  usb.readStatus(status);
+  endMeasurement("readStatus");
+
+  startMeasurement();
+  usb.softReset();
+  endMeasurement("softReset");
+
+#if BENCHMARK_NVM_WRITE
+  startMeasurement();
+  usb.write();
+  endMeasurement("write");
+#endif
+
+  Serial.println("Done");
+}
+
+void loop()
+{
+}
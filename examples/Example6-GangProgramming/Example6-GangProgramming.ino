@@ -0,0 +1,121 @@
+/*
+  Programming Several Power Delivery Boards at Once
+  SparkFun Electronics
+  Date: October 18th, 2026
+  License: This code is public domain but you buy me a beer if you use this and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/15801
+
+  This example programs the same NVM image into up to four boards on one I2C bus
+  (addresses 0x28-0x2B, set with the address jumpers). Most of the time taken by
+  write() is spent waiting for the NVM of the STUSB4500 to erase and program, so
+  the boards are programmed together: while one board's NVM is busy, the next
+  board is served.
+
+  Boards that already hold the image are skipped, and every programmed board is
+  read back and verified. The result and the time taken by each board are printed,
+  followed by the overall throughput. Send any character to program the next batch.
+
+  Boards on a second I2C port can be added the same way, e.g. usb[i].begin(0x28, Wire1).
+
+  Quick-start:
+  - Use a SparkFun RedBoard Qwiic -or- attach the Qwiic Shield to your Arduino/Photon/ESP32 or other
+  - Upload the sketch
+  - Plug the Power Delivery Boards onto the RedBoard/shield, one per address
+  - Open the serial monitor and set the baud rate to 115200
+*/
+
+// Include the SparkFun STUSB4500 library.
+// Click here to get the library: http://librarymanager/All#SparkFun_STUSB4500
+
+#include <Wire.h>
+#include <SparkFun_STUSB4500.h>
+#include <STUSB4500_GangProgrammer.h>
+
+#define BOARDS 4
+
+// The image programmed into every board: 5V, 9V at 2A and 15V at 1.5A
+const STUSB4500_NvmImage image = STUSB4500_NvmImage::defaults()
+                                 .voltage<2,9000>().current<2,2000>()
+                                 .voltage<3,15000>().current<3,1500>()
+                                 .pdoNumber<3>();
+
+STUSB4500 usb[BOARDS];
+STUSB4500_GangProgrammer programmer;
+
+const char *resultName(uint8_t result)
+{
+  switch(result)
+  {
+    case NVM_JOB_PROGRAMMED:    return "programmed";
+    case NVM_JOB_SKIPPED:       return "already programmed";
+    case NVM_JOB_VERIFY_FAILED: return "FAILED (verify)";
+    case NVM_JOB_BUS_ERROR:     return "FAILED (I2C)";
+    case NVM_JOB_TIMEOUT:       return "FAILED (timeout)";
+    default:                    return "not started";
+  }
+}
+
+void programBatch()
+{
+  programmer.begin(image);
+
+  for(uint8_t i=0; i<BOARDS; i++)
+  {
+    if(usb[i].begin(0x28 + i)) programmer.addBoard(usb[i]);
+    else
+    {
+      Serial.print("No board at 0x");
+      Serial.println(0x28 + i, HEX);
+    }
+  }
+
+  if(programmer.getBoardCount() == 0) return;
+
+  programmer.run();
+
+  for(uint8_t i=0; i<programmer.getBoardCount(); i++)
+  {
+    Serial.print("Board ");
+    Serial.print(i);
+    Serial.print(": ");
+    Serial.print(resultName(programmer.getResult(i)));
+    Serial.print(" in ");
+    Serial.print(programmer.getBoardTime(i));
+    Serial.println(" ms");
+  }
+
+  Serial.print("Programmed: ");
+  Serial.print(programmer.getProgrammedCount());
+  Serial.print(", skipped: ");
+  Serial.print(programmer.getSkippedCount());
+  Serial.print(", failed: ");
+  Serial.println(programmer.getFailedCount());
+
+  Serial.print("Total: ");
+  Serial.print(programmer.getTotalTime());
+  Serial.print(" ms, ");
+  Serial.print(programmer.getThroughput(), 1);
+  Serial.println(" boards/minute");
+  Serial.println();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Wire.begin(); //Join I2C bus
+
+  delay(500);
+
+  programBatch();
+  Serial.println("Send any character to program the next batch");
+}
+
+void loop()
+{
+  if(Serial.available())
+  {
+    while(Serial.available()) Serial.read();
+    programBatch();
+  }
+}
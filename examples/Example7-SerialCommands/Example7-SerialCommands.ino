@@ -0,0 +1,60 @@
+/*
+  Configuring the Power Delivery Board from a PC
+  SparkFun Electronics
+  Date: October 18th, 2026
+  License: This code is public domain but you buy me a beer if you use this and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/15801
+
+  This example turns the RedBoard into a bridge that a PC or a test stand can use to
+  configure the Power Delivery Board over the serial port, without changing the sketch.
+
+  A program on the PC sends binary command frames (see stusb4500_command_format.h). Each
+  frame can change several parameters at once and ask for them to be saved to the NVM
+  and renegotiated. The RedBoard answers with one frame giving the result and timings.
+
+  Text mode is also enabled, so the same commands can be typed in the serial monitor
+  (set the line ending to "Newline"):
+    GET
+    SET v2=9000 i2=2000 pdos=2
+    SET v3=15000 i3=1500 WRITE RESET
+
+  Quick-start:
+  - Use a SparkFun RedBoard Qwiic -or- attach the Qwiic Shield to your Arduino/Photon/ESP32 or other
+  - Upload the sketch
+  - Plug the Power Delivery Board onto the RedBoard/shield
+  - Open the serial monitor and set the baud rate to 115200
+*/
+
+// Include the SparkFun STUSB4500 library.
+// Click here to get the library: http://librarymanager/All#SparkFun_STUSB4500
+
+#include <Wire.h>
+#include <SparkFun_STUSB4500.h>
+#include <STUSB4500_CommandProtocol.h>
+
+STUSB4500 usb;
+STUSB4500_CommandProtocol commands;
+
+void setup()
+{
+  Serial.begin(115200);
+  Wire.begin(); //Join I2C bus
+
+  delay(500);
+
+  if(!usb.begin())
+  {
+    Serial.println("Cannot connect to STUSB4500.");
+    Serial.println("Is the board connected? Is the device ID correct?");
+    while(1);
+  }
+
+  commands.begin(usb, Serial, true);
+  Serial.println("Ready");
+}
+
+void loop()
+{
+  commands.update();
+}
@@ -0,0 +1,182 @@
+/*
+  Minimal Arduino core for building the library on a PC.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "Arduino.h"
+#include <stdio.h>
+
+#define HOST_PINS 64
+
+static uint64_t clockMicros = 0;
+
+static struct {
+  HostPinReader reader;
+  void *context;
+  int level;
+  int output;
+} pins[HOST_PINS];
+
+HardwareSerial Serial;
+
+uint64_t hostMicros(void)
+{
+  return clockMicros;
+}
+
+void hostAdvance(uint64_t us)
+{
+  clockMicros += us;
+}
+
+void hostResetClock(void)
+{
+  clockMicros = 0;
+}
+
+unsigned long millis(void)
+{
+  return (unsigned long)(clockMicros / 1000);
+}
+
+unsigned long micros(void)
+{
+  return (unsigned long)clockMicros;
+}
+
+void delay(unsigned long ms)
+{
+  hostAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  hostAdvance(us);
+}
+
+void hostSetPinReader(uint8_t pin, HostPinReader reader, void *context)
+{
+  if(pin >= HOST_PINS) return;
+  pins[pin].reader = reader;
+  pins[pin].context = context;
+}
+
+void hostSetPinLevel(uint8_t pin, int level)
+{
+  if(pin < HOST_PINS) pins[pin].level = level;
+}
+
+int hostGetPinLevel(uint8_t pin)
+{
+  return pin < HOST_PINS ? pins[pin].output : LOW;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin < HOST_PINS && mode == INPUT_PULLUP && pins[pin].reader == NULL) pins[pin].level = HIGH;
+}
+
+int digitalRead(uint8_t pin)
+{
+  if(pin >= HOST_PINS) return LOW;
+  if(pins[pin].reader != NULL) return pins[pin].reader(pins[pin].context);
+  return pins[pin].level;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if(pin < HOST_PINS) pins[pin].output = value;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while(size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const char str[])                    { return write(str); }
+size_t Print::print(char c)                              { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base)       { return printNumber(value, base); }
+size_t Print::print(int value, int base)                 { return print((long)value, base); }
+size_t Print::print(unsigned int value, int base)        { return printNumber(value, base); }
+size_t Print::print(unsigned long value, int base)       { return printNumber(value, base); }
+size_t Print::print(double value, int digits)            { return printFloat(value, digits); }
+
+size_t Print::print(long value, int base)
+{
+  if(base == DEC && value < 0) return print('-') + printNumber(-(unsigned long)value, base);
+  return printNumber(value, base);
+}
+
+size_t Print::println(void)                              { return write("\r\n"); }
+size_t Print::println(const char str[])                  { return print(str) + println(); }
+size_t Print::println(char c)                            { return print(c) + println(); }
+size_t Print::println(unsigned char value, int base)     { return print(value, base) + println(); }
+size_t Print::println(int value, int base)               { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base)      { return print(value, base) + println(); }
+size_t Print::println(long value, int base)              { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base)     { return print(value, base) + println(); }
+size_t Print::println(double value, int digits)          { return print(value, digits) + println(); }
+
+size_t Print::printNumber(unsigned long value, int base)
+{
+  char buffer[8 * sizeof(long) + 1];
+  char *str = &buffer[sizeof(buffer) - 1];
+  *str = '\0';
+
+  if(base < 2) base = 10;
+  do
+  {
+    unsigned long digit = value % base;
+    value /= base;
+    *--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while(value);
+
+  return write(str);
+}
+
+size_t Print::printFloat(double value, int digits)
+{
+  char buffer[48];
+  if(isnan(value)) return print("nan");
+  if(isinf(value)) return print("inf");
+
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return print(buffer);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  putchar(c);
+  return 1;
+}
+
+int HardwareSerial::available(void)
+{
+  return (_head + sizeof(_input) - _tail) % sizeof(_input);
+}
+
+int HardwareSerial::read(void)
+{
+  if(_head == _tail) return -1;
+  uint8_t c = _input[_tail];
+  _tail = (_tail + 1) % sizeof(_input);
+  return c;
+}
+
+int HardwareSerial::peek(void)
+{
+  return _head == _tail ? -1 : (uint8_t)_input[_tail];
+}
+
+void HardwareSerial::hostInput(const char *text)
+{
+  while(*text && (_head + 1) % sizeof(_input) != _tail)
+  {
+    _input[_head] = *text++;
+    _head = (_head + 1) % sizeof(_input);
+  }
+}
@@ -0,0 +1,126 @@
+/*
+  Minimal Arduino core for building the library on a PC.
+
+  Only what the library and its examples use is provided. Time is simulated:
+  millis()/micros() return a clock that only moves when delay() is called or
+  when bytes are clocked on the emulated I2C bus (see Wire.h), so every run of
+  a test or benchmark is repeatable.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+
+#define DEC             10
+#define HEX             16
+#define BIN             2
+
+#define PROGMEM
+#define F(string)       (string)
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class Print {
+  public:
+  virtual ~Print(void) {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str == NULL ? 0 : write((const uint8_t *)str, strlen(str)); }
+
+  size_t print(const char str[]);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println(void);
+  size_t println(const char str[]);
+  size_t println(char c);
+  size_t println(unsigned char value, int base = DEC);
+  size_t println(int value, int base = DEC);
+  size_t println(unsigned int value, int base = DEC);
+  size_t println(long value, int base = DEC);
+  size_t println(unsigned long value, int base = DEC);
+  size_t println(double value, int digits = 2);
+
+  private:
+  size_t printNumber(unsigned long value, int base);
+  size_t printFloat(double value, int digits);
+};
+
+class Stream : public Print {
+  public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+  virtual void flush(void) {}
+};
+
+/*
+  Serial port of the host build. Output goes to stdout, input comes from
+  hostInput().
+*/
+class HardwareSerial : public Stream {
+  public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end(void) {}
+  operator bool(void) { return true; }
+
+  size_t write(uint8_t c);
+  using Print::write;
+  int available(void);
+  int read(void);
+  int peek(void);
+
+  void hostInput(const char *text);
+
+  private:
+  char _input[256];
+  size_t _head = 0;
+  size_t _tail = 0;
+};
+
+extern HardwareSerial Serial;
+
+/*
+  Host-side controls of the simulated environment.
+*/
+uint64_t hostMicros(void);                       //Simulated time, without the 32-bit wrap
+void hostAdvance(uint64_t us);                   //Moves the simulated clock forward
+void hostResetClock(void);
+
+typedef int (*HostPinReader)(void *context);
+void hostSetPinReader(uint8_t pin, HostPinReader reader, void *context);
+void hostSetPinLevel(uint8_t pin, int level);    //Level of a pin without a reader
+int  hostGetPinLevel(uint8_t pin);               //Last level written with digitalWrite()
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  Emulated I2C bus for the host build.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::attach(HostI2CDevice &device)
+{
+  for(uint8_t i = 0; i < HOST_I2C_MAX_DEVICES; i++)
+  {
+    if(_devices[i] == NULL)
+    {
+      _devices[i] = &device;
+      return;
+    }
+  }
+}
+
+void TwoWire::detach(HostI2CDevice &device)
+{
+  for(uint8_t i = 0; i < HOST_I2C_MAX_DEVICES; i++)
+  {
+    if(_devices[i] == &device) _devices[i] = NULL;
+  }
+}
+
+HostI2CDevice *TwoWire::find(uint8_t address)
+{
+  for(uint8_t i = 0; i < HOST_I2C_MAX_DEVICES; i++)
+  {
+    if(_devices[i] != NULL && _devices[i]->address() == address) return _devices[i];
+  }
+  return NULL;
+}
+
+void TwoWire::clock(uint32_t bytes)
+{
+  _bytes += bytes;
+  hostAdvance((uint64_t)bytes * 9000000 / _clock);
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  _address = address;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t c)
+{
+  if(_txLength >= HOST_I2C_BUFFER_LENGTH) return 0;
+  _txBuffer[_txLength++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length)
+{
+  size_t n = 0;
+  while(length-- && write(*data++)) n++;
+  return n;
+}
+
+//Same return values as the AVR core: 0 success, 2 address NACK, 3 data NACK
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  (void)sendStop;
+  HostI2CDevice *device = find(_address);
+  _transactions++;
+
+  if(device == NULL)
+  {
+    clock(1);
+    return 2;
+  }
+  clock(1 + _txLength);
+  return device->i2cWrite(_txBuffer, _txLength) ? 0 : 3;
+}
+
+//Returns the number of bytes read, 0 when the device does not answer
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop)
+{
+  (void)sendStop;
+  HostI2CDevice *device = find(address);
+  _transactions++;
+  _rxIndex = 0;
+  _rxLength = 0;
+
+  if(quantity > HOST_I2C_BUFFER_LENGTH) quantity = HOST_I2C_BUFFER_LENGTH;
+  if(device == NULL || !device->i2cRead(_rxBuffer, quantity))
+  {
+    clock(1);
+    return 0;
+  }
+  clock(1 + quantity);
+  _rxLength = quantity;
+  return quantity;
+}
+
+int TwoWire::available(void)
+{
+  return _rxLength - _rxIndex;
+}
+
+//Like the AVR core, reading past the received bytes returns -1 (0xFF once stored in a uint8_t)
+int TwoWire::read(void)
+{
+  return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1;
+}
+
+int TwoWire::peek(void)
+{
+  return _rxIndex < _rxLength ? _rxBuffer[_rxIndex] : -1;
+}
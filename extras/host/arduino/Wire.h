@@ -0,0 +1,83 @@
+/*
+  Emulated I2C bus for the host build.
+
+  Devices are C++ objects attached to the bus with TwoWire::attach(). Every byte
+  clocked on the bus (address, register and data bytes) advances the simulated
+  clock by 9 bit times at the bus speed set with setClock(), 100kHz by default.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define HOST_I2C_BUFFER_LENGTH 64
+#define HOST_I2C_MAX_DEVICES   8
+
+/*
+  A device on the emulated bus.
+  i2cWrite() - the data bytes of a write transaction. Returns false to NACK it.
+  i2cRead()  - fills data with the bytes of a read transaction. Returns false to NACK it.
+*/
+class HostI2CDevice {
+  public:
+  virtual ~HostI2CDevice(void) {}
+  virtual uint8_t address(void) const = 0;
+  virtual bool i2cWrite(const uint8_t *data, uint8_t length) = 0;
+  virtual bool i2cRead(uint8_t *data, uint8_t length) = 0;
+};
+
+class TwoWire : public Stream {
+  public:
+  void begin(void) {}
+  void end(void) {}
+  void setClock(uint32_t frequency) { _clock = frequency; }
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint16_t quantity) { return requestFrom(address, (uint8_t)quantity); }
+  uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *data, size_t length);
+  using Print::write;
+  int available(void);
+  int read(void);
+  int peek(void);
+
+  /*
+    Host-side controls.
+	attach()/detach() - connect a device to the bus, up to HOST_I2C_MAX_DEVICES.
+	getTransactions()  - number of START conditions since the last resetCounters().
+	getBytes()         - number of bytes clocked on the bus, addresses included.
+  */
+  void attach(HostI2CDevice &device);
+  void detach(HostI2CDevice &device);
+  uint32_t getTransactions(void) const { return _transactions; }
+  uint32_t getBytes(void) const { return _bytes; }
+  void resetCounters(void) { _transactions = 0; _bytes = 0; }
+
+  private:
+  HostI2CDevice *find(uint8_t address);
+  void clock(uint32_t bytes);
+
+  HostI2CDevice *_devices[HOST_I2C_MAX_DEVICES] = {};
+  uint32_t _clock = 100000;
+  uint8_t _address = 0;
+  uint8_t _txBuffer[HOST_I2C_BUFFER_LENGTH];
+  uint8_t _txLength = 0;
+  uint8_t _rxBuffer[HOST_I2C_BUFFER_LENGTH];
+  uint8_t _rxLength = 0;
+  uint8_t _rxIndex = 0;
+  uint32_t _transactions = 0;
+  uint32_t _bytes = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
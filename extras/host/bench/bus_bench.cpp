@@ -0,0 +1,146 @@
+/*
+  I2C cost of the main library functions against the emulated STUSB4500.
+
+  Each function runs RUNS times, every run on a freshly powered chip so caches
+  and shadow copies start empty, as after a reset of the board. For each one the
+  benchmark reports the I2C transactions and bytes counted by the library, the
+  time they take on the bus at 100kHz and 400kHz, the simulated time of the call
+  at both speeds (bus time plus the delay()s of the library), and the CPU time
+  of the call on this PC. The bus figures do not depend on the PC and the
+  emulator is deterministic, so they only change when the library does.
+  Transactions and bytes are those at 100kHz: write() polls the NVM busy flag,
+  so it makes more of them at 400kHz, and its 400kHz bus time counts those.
+
+  Output: a table, then one line per function, with the same first fields as
+  the BENCH lines of Example5-Benchmark on a board:
+    BENCH,name,elapsed_us,transactions,bytes,bus_us_100k,bus_us_400k,elapsed_us_400k,cpu_ns
+
+  Usage: bus_bench [runs]
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <time.h>
+#include "SparkFun_STUSB4500.h"
+#include "emulated_stusb4500.h"
+
+struct Operation {
+  const char *name;
+  bool begun;                     //begin() is called before the measurement
+  bool nvmRead;                   //read() is called before the measurement
+  void (*run)(STUSB4500 &usb);
+};
+
+struct Measurement {
+  uint32_t transactions;
+  uint32_t bytes;
+  uint32_t elapsed;               //Simulated microseconds
+  uint64_t cpu;                   //Nanoseconds, summed over the runs
+  bool consistent;                //Library and bus byte counts agree, and every run counted the same
+};
+
+static void runBegin(STUSB4500 &usb)       { usb.begin(); }
+static void runRead(STUSB4500 &usb)        { usb.read(); }
+static void runWrite(STUSB4500 &usb)       { usb.write(); }
+static void runSetVoltage(STUSB4500 &usb)  { usb.setVoltage(2, 9.0); }
+static void runGetVoltage(STUSB4500 &usb)  { usb.getVoltage(2); }
+static void runGetPdoNumber(STUSB4500 &usb) { usb.getPdoNumber(); }
+static void runSoftReset(STUSB4500 &usb)   { usb.softReset(); }
+
+static const Operation operations[] = {
+  { "begin",        false, false, runBegin },
+  { "read",         true,  false, runRead },
+  { "write",        true,  true,  runWrite },
+  { "setVoltage",   true,  false, runSetVoltage },
+  { "getVoltage",   true,  false, runGetVoltage },
+  { "getPdoNumber", true,  false, runGetPdoNumber },
+  { "softReset",    true,  false, runSoftReset },
+};
+
+static const uint8_t operationCount = sizeof(operations) / sizeof(operations[0]);
+
+static uint64_t cpuNanoseconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static Measurement measure(const Operation &operation, uint32_t clock, uint16_t runs)
+{
+  Measurement result = {0, 0, 0, 0, true};
+
+  for(uint16_t run=0; run<runs; run++)
+  {
+    hostResetClock();
+    EmulatedSTUSB4500 chip;
+    Wire.attach(chip);
+    Wire.setClock(clock);
+
+    STUSB4500 usb;
+    if(operation.begun) usb.begin();
+    if(operation.nvmRead) usb.read();
+    usb.clearBusStatistics();
+    Wire.resetCounters();
+
+    uint64_t startTime = hostMicros();
+    uint64_t startCpu = cpuNanoseconds();
+    operation.run(usb);
+    result.cpu += cpuNanoseconds() - startCpu;
+    uint32_t elapsed = hostMicros() - startTime;
+
+    if(usb.getByteCount() != Wire.getBytes()) result.consistent = false;
+    if(run == 0)
+    {
+      result.transactions = usb.getTransactionCount();
+      result.bytes = usb.getByteCount();
+      result.elapsed = elapsed;
+    }
+    else if(usb.getTransactionCount() != result.transactions || usb.getByteCount() != result.bytes ||
+            elapsed != result.elapsed)
+    {
+      result.consistent = false;
+    }
+
+    Wire.detach(chip);
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  uint16_t runs = argc > 1 ? atoi(argv[1]) : 100;
+  if(runs == 0) runs = 1;
+  bool consistent = true;
+
+  printf("%-13s %12s %6s %11s %10s %10s %12s %10s\n", "", "transactions", "bytes", "elapsed", "bus 100kHz",
+         "bus 400kHz", "elapsed 400k", "cpu");
+  for(uint8_t i=0; i<operationCount; i++)
+  {
+    const Operation &operation = operations[i];
+    Measurement slow = measure(operation, 100000, runs);
+    Measurement fast = measure(operation, 400000, runs);
+
+    uint32_t bus100k = (uint64_t)slow.bytes * 9000000 / 100000;
+    uint32_t bus400k = (uint64_t)fast.bytes * 9000000 / 400000;
+    uint32_t cpu = (slow.cpu + fast.cpu) / (2 * runs);
+
+    if(!slow.consistent || !fast.consistent)
+    {
+      printf("%s: the byte counts of the library and the bus differ, or differ between runs\n", operation.name);
+      consistent = false;
+    }
+
+    printf("%-13s %12u %6u %8u us %7u us %7u us %9u us %7u ns\n", operation.name, slow.transactions, slow.bytes,
+           slow.elapsed, bus100k, bus400k, fast.elapsed, cpu);
+    printf("BENCH,%s,%u,%u,%u,%u,%u,%u,%u\n", operation.name, slow.elapsed, slow.transactions, slow.bytes,
+           bus100k, bus400k, fast.elapsed, cpu);
+  }
+
+  return consistent ? 0 : 1;
+}
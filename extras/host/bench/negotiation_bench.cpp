@@ -0,0 +1,167 @@
+/*
+  Time-to-contract benchmark against simulated chargers.
+
+  For each charger preset and each sink setting, the PDOs are applied either
+  with the setters (setVoltage(), setCurrent(), setPdoNumber()) or with
+  STUSB4500_ProfileTable::switchProfile(), then softReset() renegotiates and
+  STUSB4500_NegotiationProfiler times it, RUNS times. The source timing has
+  jitter and, for some presets, message loss, from a fixed seed: every run of
+  the benchmark prints the same numbers, so a change in the library shows up
+  as a change in the output.
+
+  Output: a table, then one line per charger, setting and method:
+    NEGO,charger,method,voltage_mV,current_mA,apply_us,runs,timeouts,hard_resets,min_us,avg_us,max_us,contract_mV,contract_mA
+
+  Usage: negotiation_bench [runs]
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include "SparkFun_STUSB4500.h"
+#include "STUSB4500_NegotiationProfiler.h"
+#include "STUSB4500_ProfileTable.h"
+#include "emulated_stusb4500.h"
+#include "simulated_source.h"
+
+struct Charger {
+  const char *name;
+  uint16_t pdo[SOURCE_MAX_PDOS][2]; //mV, mA, ended by a 0V entry
+  SimulatedSourceTiming timing;
+  uint8_t loss;                     //Percentage of lost messages
+  bool hardResetOnSoftReset;
+};
+
+struct Setting {
+  float voltage;
+  float current;
+};
+
+//           capabilities accept  psRdy  softReset recovery vbusOn  jitter
+static const Charger chargers[] = {
+  { "usb-c-15w",  {{5000, 3000}},
+    { 150000,  2000,  20000,  1000,  700000, 100000,  5000 }, 0, false },
+  { "phone-18w",  {{5000, 3000}, {9000, 2000}, {12000, 1500}},
+    { 120000,  3000,  40000,  2000,  750000, 120000, 10000 }, 0, false },
+  { "laptop-65w", {{5000, 3000}, {9000, 3000}, {15000, 3000}, {20000, 3250}},
+    {  90000,  1500,  60000,  1500,  660000,  90000,  8000 }, 0, false },
+  { "slow-45w",   {{5000, 3000}, {9000, 3000}, {15000, 3000}, {20000, 2250}},
+    { 240000,  8000, 250000,  9000,  950000, 250000, 20000 }, 0, false },
+  { "lossy-30w",  {{5000, 3000}, {9000, 3000}, {15000, 2000}},
+    { 150000,  3000,  40000,  2000,  750000, 120000, 10000 }, 5, false },
+  { "hr-on-sr",   {{5000, 3000}, {9000, 3000}, {15000, 3000}},
+    { 150000,  3000,  40000,  2000,  750000, 120000, 10000 }, 0, true },
+};
+
+static const Setting settings[] = {
+  {5.0, 1.5},
+  {9.0, 2.0},
+  {15.0, 2.0},
+  {20.0, 3.0},
+};
+
+static const uint8_t chargerCount = sizeof(chargers) / sizeof(chargers[0]);
+static const uint8_t settingCount = sizeof(settings) / sizeof(settings[0]);
+
+static void applySetters(STUSB4500 &usb, const Setting &setting)
+{
+  if(setting.voltage <= 5)
+  {
+    usb.setCurrent(1, setting.current);
+    usb.setPdoNumber(1);
+  }
+  else
+  {
+    usb.setVoltage(2, setting.voltage);
+    usb.setCurrent(2, setting.current);
+    usb.setPdoNumber(2);
+  }
+}
+
+static void benchmark(const Charger &charger, uint8_t index, bool useProfile, uint16_t runs)
+{
+  const char *method = useProfile ? "profile" : "setters";
+  const Setting &setting = settings[index];
+
+  hostResetClock();
+  EmulatedSTUSB4500 chip;
+  SimulatedSource source;
+  Wire.attach(chip);
+
+  source.clearPdos();
+  for(uint8_t i=0; i<SOURCE_MAX_PDOS && charger.pdo[i][0] != 0; i++) source.addFixedPdo(charger.pdo[i][0], charger.pdo[i][1]);
+  source.setTiming(charger.timing);
+  source.setMessageLoss(charger.loss);
+  source.setHardResetOnSoftReset(charger.hardResetOnSoftReset);
+  source.seed(1 + index);
+
+  STUSB4500 usb;
+  STUSB4500_NegotiationProfiler profiler;
+  STUSB4500_ProfileTable profiles;
+
+  chip.attach(source);
+  usb.begin();
+  profiler.begin(usb, 5000);
+  profiles.begin(usb);
+  profiles.addProfile(setting.voltage, setting.current);
+
+  //Let the first contract settle so every run starts from PE_SNK_READY
+  delay(3000);
+
+  uint32_t applyTime = 0;
+  uint32_t hardResets = chip.getHardResets();
+  for(uint16_t run=0; run<runs; run++)
+  {
+    uint32_t startTime = micros();
+    if(useProfile) profiles.switchProfile(0, false);
+    else applySetters(usb, setting);
+    applyTime += micros() - startTime;
+
+    profiler.run(true);
+    delay(100);
+  }
+  applyTime /= runs;
+  hardResets = chip.getHardResets() - hardResets;
+
+  uint32_t rdo = chip.getRdo();
+  uint16_t contractVoltage = chip.hasContract() ? chip.getVbus() : 0;
+  uint16_t contractCurrent = ((rdo >> 10) & 0x3FF) * 10;
+
+  uint32_t minLatency = 0, avgLatency = 0, maxLatency = 0;
+  if(profiler.getRunCount() > 0)
+  {
+    minLatency = profiler.getMinLatency(PROFILER_PHASE_TOTAL);
+    avgLatency = profiler.getAvgLatency(PROFILER_PHASE_TOTAL);
+    maxLatency = profiler.getMaxLatency(PROFILER_PHASE_TOTAL);
+  }
+
+  printf("%-11s %-8s %5.1fV %4.2fA  apply %5u us  contract %7u/%7u/%7u us  %2u timeouts %2u hard resets  got %5umV %4umA\n",
+         charger.name, method, setting.voltage, setting.current, applyTime, minLatency, avgLatency, maxLatency,
+         profiler.getTimeoutCount(), hardResets, contractVoltage, contractCurrent);
+  printf("NEGO,%s,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", charger.name, method,
+         (unsigned)(setting.voltage * 1000), (unsigned)(setting.current * 1000), applyTime,
+         profiler.getRunCount(), profiler.getTimeoutCount(), hardResets, minLatency, avgLatency, maxLatency,
+         contractVoltage, contractCurrent);
+
+  Wire.detach(chip);
+}
+
+int main(int argc, char **argv)
+{
+  uint16_t runs = argc > 1 ? atoi(argv[1]) : 20;
+  if(runs == 0) runs = 1;
+
+  for(uint8_t c=0; c<chargerCount; c++)
+  {
+    for(uint8_t i=0; i<settingCount; i++)
+    {
+      benchmark(chargers[c], i, false, runs);
+      benchmark(chargers[c], i, true, runs);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+  PC side of the STUSB4500_CommandProtocol serial command protocol.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "command_client.h"
+
+CommandClient::CommandClient(CommandTransport &transport, uint32_t timeout) :
+  _transport(transport), _timeout(timeout), _sequence(0), _requestLength(1), _frameLength(0), _skippedBytes(0)
+{
+}
+
+bool CommandClient::set(uint8_t id, uint16_t value)
+{
+  if(_requestLength + 3 > COMMAND_MAX_PAYLOAD) return false;
+
+  _request[_requestLength++] = id;
+  _request[_requestLength++] = value & 0xFF;
+  _request[_requestLength++] = value >> 8;
+  return true;
+}
+
+uint8_t CommandClient::execute(uint8_t flags, CommandResult &result)
+{
+  uint8_t frame[COMMAND_HEADER_LENGTH + COMMAND_MAX_PAYLOAD + 1];
+
+  _request[0] = flags;
+  uint8_t length = commandFrame(frame, ++_sequence, _request, _requestLength);
+  _requestLength = 1;
+
+  //Whatever is left of an earlier exchange is not the answer to this one
+  _skippedBytes += _frameLength;
+  _frameLength = 0;
+
+  if(!_transport.send(frame, length)) return CLIENT_SEND_FAILED;
+  if(!receiveFrame()) return CLIENT_TIMEOUT;
+
+  decode(result);
+  return CLIENT_OK;
+}
+
+uint32_t CommandClient::getSkippedBytes(void)
+{
+  return _skippedBytes;
+}
+
+bool CommandClient::receiveFrame(void)
+{
+  while(true)
+  {
+    int data = _transport.receive(_timeout);
+    if(data < 0) return false;
+    _frame[_frameLength++] = data;
+
+    //Scan again from each byte after a false start, the response may begin inside it
+    while(_frameLength > 0)
+    {
+      if(_frame[0] != COMMAND_SYNC || (_frameLength > 2 && _frame[2] > COMMAND_MAX_PAYLOAD))
+      {
+        skip();
+        continue;
+      }
+
+      if(_frameLength < COMMAND_HEADER_LENGTH || _frameLength < COMMAND_HEADER_LENGTH + _frame[2] + 1) break;
+
+      uint8_t length = COMMAND_HEADER_LENGTH + _frame[2];
+      if(_frame[1] == _sequence && _frame[2] > 0 &&
+         telemetryCrc8(_frame, length) == _frame[length]) return true;
+
+      skip();
+    }
+  }
+}
+
+void CommandClient::skip(void)
+{
+  memmove(_frame, &_frame[1], --_frameLength);
+  _skippedBytes++;
+}
+
+void CommandClient::decode(CommandResult &result)
+{
+  const uint8_t *payload = &_frame[COMMAND_HEADER_LENGTH];
+  uint8_t length = _frame[2];
+
+  memset(&result, 0, sizeof(result));
+  result.status = payload[0];
+  result.writeResult = COMMAND_NOT_WRITTEN;
+  _frameLength = 0;
+
+  //COMMAND_ERROR_FRAME answers only carry the status
+  if(length < COMMAND_RESPONSE_LENGTH) return;
+
+  result.applied = payload[1];
+  result.writeResult = payload[2];
+  result.applyTime = (uint32_t)payload[3] | ((uint32_t)payload[4]<<8) | ((uint32_t)payload[5]<<16) | ((uint32_t)payload[6]<<24);
+  result.writeTime = (uint32_t)payload[7] | ((uint32_t)payload[8]<<8) | ((uint32_t)payload[9]<<16) | ((uint32_t)payload[10]<<24);
+
+  result.hasValues = length > COMMAND_RESPONSE_LENGTH;
+  for(uint8_t i=COMMAND_RESPONSE_LENGTH; i+2<length; i+=3)
+  {
+    uint8_t id = payload[i];
+    if(id >= 1 && id <= COMMAND_PARAM_COUNT) result.values[id-1] = payload[i+1] | (payload[i+2]<<8);
+  }
+}
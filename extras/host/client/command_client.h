@@ -0,0 +1,92 @@
+/*
+  PC side of the STUSB4500_CommandProtocol serial command protocol.
+
+  CommandClient batches parameter changes into one request frame, sends it and
+  waits for the matching response frame. The bytes go through a
+  CommandTransport: SerialTransport for a serial port on Linux, or an in-memory
+  loopback in the host tests. Only stusb4500_command_format.h is shared with the
+  library, the client has no Arduino dependency.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef COMMAND_CLIENT_H
+#define COMMAND_CLIENT_H
+
+#include <stdint.h>
+#include "stusb4500_command_format.h"
+
+#define CLIENT_OK               0
+#define CLIENT_TIMEOUT          1     //No valid response before the timeout
+#define CLIENT_SEND_FAILED      2
+
+/*
+  Byte link to the board.
+  send()    - sends a complete frame. Returns false if it could not be sent.
+  receive() - next received byte, or -1 if none came within timeout ms.
+*/
+class CommandTransport {
+  public:
+  virtual ~CommandTransport(void) {}
+  virtual bool send(const uint8_t *data, uint8_t length) = 0;
+  virtual int receive(uint32_t timeout) = 0;
+};
+
+/*
+  Decoded response payload, see stusb4500_command_format.h.
+*/
+struct CommandResult {
+  uint8_t status;                         //COMMAND_OK or COMMAND_ERROR_*
+  uint8_t applied;                        //Parameters applied, or index of the rejected one
+  uint8_t writeResult;                    //NVM_WRITE_* or COMMAND_NOT_WRITTEN
+  uint32_t applyTime;                     //us
+  uint32_t writeTime;                     //ms
+  bool hasValues;                         //Set when COMMAND_FLAG_READ was requested
+  uint16_t values[COMMAND_PARAM_COUNT];   //Indexed by COMMAND_PARAM_* id - 1
+};
+
+class CommandClient {
+  public:
+  /*
+    Parameter: transport - the link to the board.
+	           timeout   - time in ms to wait for each byte of the response.
+  */
+  CommandClient(CommandTransport &transport, uint32_t timeout = 3000);
+
+  /*
+    Adds a parameter change to the next request. The value is not checked, see
+	commandParamRange(). Returns false if the request is full.
+  */
+  bool set(uint8_t id, uint16_t value);
+
+  /*
+    Sends the pending changes with the COMMAND_FLAG_* flags and waits for the response.
+	The pending changes are cleared whatever the outcome.
+	Returns CLIENT_OK when a response was received, see result.status for the outcome
+	of the command, or CLIENT_TIMEOUT / CLIENT_SEND_FAILED.
+  */
+  uint8_t execute(uint8_t flags, CommandResult &result);
+
+  /*
+    Number of bytes skipped while looking for the response: text output of the
+	board, corrupted frames and responses to other requests.
+  */
+  uint32_t getSkippedBytes(void);
+
+  private:
+  CommandTransport &_transport;
+  uint32_t _timeout;
+  uint8_t _sequence;
+  uint8_t _request[COMMAND_MAX_PAYLOAD];
+  uint8_t _requestLength;
+  uint8_t _frame[COMMAND_HEADER_LENGTH + COMMAND_MAX_PAYLOAD + 1];
+  uint8_t _frameLength;
+  uint32_t _skippedBytes;
+
+  bool receiveFrame(void);
+  void skip(void);
+  void decode(CommandResult &result);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  CommandTransport over a serial port, for Linux (termios).
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "serial_transport.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+static bool baudConstant(uint32_t baud, speed_t &speed)
+{
+  switch(baud)
+  {
+    case 9600:   speed = B9600;   return true;
+    case 19200:  speed = B19200;  return true;
+    case 38400:  speed = B38400;  return true;
+    case 57600:  speed = B57600;  return true;
+    case 115200: speed = B115200; return true;
+    case 230400: speed = B230400; return true;
+  }
+  return false;
+}
+
+bool SerialTransport::open(const char *path, uint32_t baud)
+{
+  speed_t speed;
+  if(!baudConstant(baud, speed)) return false;
+
+  close();
+  _fd = ::open(path, O_RDWR | O_NOCTTY);
+  if(_fd < 0) return false;
+
+  struct termios options;
+  if(tcgetattr(_fd, &options) != 0)
+  {
+    close();
+    return false;
+  }
+
+  cfmakeraw(&options);
+  options.c_cflag |= CLOCAL | CREAD;
+  options.c_cflag &= ~(CSTOPB | CRTSCTS);
+  options.c_cc[VMIN] = 0;
+  options.c_cc[VTIME] = 0;
+  cfsetispeed(&options, speed);
+  cfsetospeed(&options, speed);
+
+  if(tcsetattr(_fd, TCSANOW, &options) != 0)
+  {
+    close();
+    return false;
+  }
+
+  tcflush(_fd, TCIOFLUSH);
+  return true;
+}
+
+void SerialTransport::close(void)
+{
+  if(_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+bool SerialTransport::send(const uint8_t *data, uint8_t length)
+{
+  while(length > 0)
+  {
+    ssize_t written = ::write(_fd, data, length);
+    if(written <= 0) return false;
+    data += written;
+    length -= written;
+  }
+
+  return tcdrain(_fd) == 0;
+}
+
+int SerialTransport::receive(uint32_t timeout)
+{
+  struct pollfd request = { _fd, POLLIN, 0 };
+  if(poll(&request, 1, timeout) <= 0) return -1;
+
+  uint8_t data;
+  if(::read(_fd, &data, 1) != 1) return -1;
+  return data;
+}
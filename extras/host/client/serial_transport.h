@@ -0,0 +1,34 @@
+/*
+  CommandTransport over a serial port, for Linux (termios).
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef SERIAL_TRANSPORT_H
+#define SERIAL_TRANSPORT_H
+
+#include "command_client.h"
+
+class SerialTransport : public CommandTransport {
+  public:
+  SerialTransport(void) : _fd(-1) {}
+  ~SerialTransport(void) { close(); }
+
+  /*
+    Opens the port in raw mode, 8N1 without flow control.
+	Parameter: path - e.g. /dev/ttyACM0 or /dev/ttyUSB0.
+	           baud - one of the standard rates up to 230400.
+	Returns false if the port could not be opened or the rate is not supported.
+  */
+  bool open(const char *path, uint32_t baud);
+  void close(void);
+
+  bool send(const uint8_t *data, uint8_t length);
+  int receive(uint32_t timeout);
+
+  private:
+  int _fd;
+};
+
+#endif
@@ -0,0 +1,619 @@
+/*
+  Register level emulation of the STUSB4500 for the host build.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "emulated_stusb4500.h"
+#include "stusb4500_register_map.h"
+#include "stusb4500_nvm_image.h"
+
+//Policy engine events
+#define EV_NONE                 0
+#define EV_VBUS_ON              1  //VBUS is up after an attach or a hard reset
+#define EV_CAPABILITIES         2  //Source_Capabilities received
+#define EV_REQUEST              3  //Request sent
+#define EV_ACCEPT               4  //Accept received
+#define EV_PS_RDY               5  //PS_RDY received
+#define EV_SOFT_RESET_ACCEPT    6  //Accept of our Soft_Reset received
+#define EV_HARD_RESET           7  //A sink timer expired, send a Hard_Reset
+#define EV_SOURCE_HARD_RESET    8  //Hard_Reset received from the source
+#define EV_SHUTDOWN             9  //The source turns VBUS off
+#define EV_RECOVERY             10 //The source turns VBUS back on
+
+#define NVM_IDLE                0xFF
+
+//PD message types, in bits 4:0 of the header
+#define MSG_ACCEPT              0x03  //Control message
+#define MSG_PS_RDY              0x06  //Control message
+#define MSG_SOURCE_CAPABILITIES 0x01  //Data message
+
+//Bits of the status window cleared by a read
+static const uint8_t clearOnRead[STATUS_WINDOW_LENGTH] = {
+  0x00, 0x00, 0x01, 0x00, 0x0E, 0x00, 0x00, 0xF0, 0x00, 0x00, 0x00, 0x15
+};
+
+EmulatedSTUSB4500::EmulatedSTUSB4500(uint8_t address)
+{
+  _address = address;
+  _present = true;
+  _failTransactions = 0;
+  _failReads = 0;
+  _nvmOpsLeft = 0;
+  _source = NULL;
+  _softResets = 0;
+  _hardResets = 0;
+  _contracts = 0;
+  _nvmErases = 0;
+  _nvmPrograms = 0;
+  _transactions = 0;
+
+  STUSB4500_NvmImage::defaults().toBytes(_nvm);
+
+  reset();
+}
+
+void EmulatedSTUSB4500::reset(void)
+{
+  memset(_reg, 0, sizeof(_reg));
+  _reg[ALERT_STATUS_1_MASK] = 0xFF;
+  _reg[EMU_DEVICE_ID] = 0x25;
+  _reg[TYPEC_MONITORING_STATUS_1] = 0x04; //VBUS at 0V
+  _pointer = 0;
+  memset(_programLoad, 0, sizeof(_programLoad));
+  _eraseMask = 0;
+  _brownedOut = false;
+  _hardResetAlert = false;
+  _contract = false;
+  _vbus = 0;
+  _contractVoltage = 0;
+  _hardResetCount = 0;
+  _messageId = 0;
+  _peEvent = EV_NONE;
+  _nvmOp = NVM_IDLE;
+  loadPdos();
+}
+
+void EmulatedSTUSB4500::loadPdos(void)
+{
+  uint16_t flex = nvmGet<NVM_I_SNK_PDO_FLEX>(_nvm);
+  uint8_t code[3] = { (uint8_t)nvmGet<NVM_I_SNK_PDO1>(_nvm), (uint8_t)nvmGet<NVM_I_SNK_PDO2>(_nvm),
+                      (uint8_t)nvmGet<NVM_I_SNK_PDO3>(_nvm) };
+  uint16_t voltage[3] = { 100, nvmGet<NVM_V_SNK_PDO2>(_nvm), nvmGet<NVM_V_SNK_PDO3>(_nvm) };
+
+  for(uint8_t i=0; i<3; i++)
+  {
+    //A current code of 0 uses FLEX_I
+    uint32_t pdo = ((uint32_t)voltage[i] << 10) | (code[i] == 0 ? flex : nvmCurrentValue(code[i]));
+    if(i == 0)
+    {
+      pdo |= (uint32_t)nvmGet<NVM_SNK_UNCONS_POWER>(_nvm) << 27;
+      pdo |= (uint32_t)nvmGet<NVM_USB_COMM_CAPABLE>(_nvm) << 26;
+    }
+    for(uint8_t j=0; j<4; j++) _reg[DPM_SNK_PDO1 + i*4 + j] = pdo >> (8*j);
+  }
+
+  _reg[DPM_PDO_NUMB] = nvmGet<NVM_SNK_PDO_NUMB>(_nvm);
+  _reqSrcCurrent = nvmGet<NVM_REQ_SRC_CURRENT>(_nvm);
+}
+
+bool EmulatedSTUSB4500::i2cWrite(const uint8_t *data, uint8_t length)
+{
+  process();
+  _transactions++;
+
+  if(!_present || _brownedOut) return false;
+  if(_failTransactions > 0)
+  {
+    _failTransactions--;
+    return false;
+  }
+
+  //The first byte sets the register address, the data follows with auto-increment
+  if(length == 0) return true;
+  _pointer = data[0];
+  for(uint8_t i=1; i<length; i++) writeRegister(_pointer++, data[i]);
+
+  return true;
+}
+
+bool EmulatedSTUSB4500::i2cRead(uint8_t *data, uint8_t length)
+{
+  process();
+  _transactions++;
+
+  if(!_present || _brownedOut) return false;
+  if(_failTransactions > 0 || _failReads > 0)
+  {
+    if(_failTransactions > 0) _failTransactions--;
+    else _failReads--;
+    return false;
+  }
+
+  for(uint8_t i=0; i<length; i++) data[i] = readRegister(_pointer++);
+
+  return true;
+}
+
+uint8_t EmulatedSTUSB4500::readRegister(uint8_t reg)
+{
+  if(reg == ALERT_STATUS_1)
+  {
+    uint8_t value = alertStatus();
+    _hardResetAlert = false;
+    return value;
+  }
+
+  uint8_t value = _reg[reg];
+  if(reg > ALERT_STATUS_1 && reg <= PRT_STATUS) _reg[reg] &= ~clearOnRead[reg - ALERT_STATUS_1];
+
+  return value;
+}
+
+void EmulatedSTUSB4500::writeRegister(uint8_t reg, uint8_t value)
+{
+  //Status window (except the mask), PE_FSM, RX buffer and RDO are read only
+  if(reg >= ALERT_STATUS_1 && reg <= PRT_STATUS && reg != ALERT_STATUS_1_MASK) return;
+  if(reg == PE_FSM || reg == EMU_DEVICE_ID) return;
+  if(reg >= EMU_RX_BYTE_CNT && reg < EMU_RX_DATA_OBJ + 28) return;
+  if(reg >= RDO_REG_STATUS && reg < RDO_REG_STATUS + 4) return;
+
+  uint64_t now = hostMicros();
+
+  if(reg == PD_COMMAND_CTRL)
+  {
+    //SEND_COMMAND with a SOFT_RESET header
+    if(value == 0x26 && _reg[TX_HEADER_LOW] == 0x0D && _source != NULL && _vbus != 0 &&
+       _reg[PE_FSM] != PE_HARD_RESET)
+    {
+      _softResets++;
+      _contract = false;
+      setPe(PE_SEND_SOFT_RESET);
+
+      uint32_t latency = _source->latency(_source->getTiming().softReset);
+      if(!_source->isPdCapable()) schedule(EV_HARD_RESET, now + EMU_SENDER_RESPONSE);
+      else if(_source->hardResetOnSoftReset()) schedule(EV_SOURCE_HARD_RESET, now + latency);
+      else if(_source->deliver() && latency < EMU_SENDER_RESPONSE) schedule(EV_SOFT_RESET_ACCEPT, now + latency);
+      else schedule(EV_HARD_RESET, now + EMU_SENDER_RESPONSE);
+    }
+    return;
+  }
+
+  if(reg == FTP_CTRL_0)
+  {
+    _reg[FTP_CTRL_0] = value & ~FTP_CUST_REQ;
+
+    //Clearing RST_N resets the NVM controller
+    if((value & FTP_CUST_RST_N) == 0)
+    {
+      _nvmOp = NVM_IDLE;
+      return;
+    }
+
+    //Opcodes only run with the password set and the NVM powered
+    if((value & FTP_CUST_REQ) && (value & FTP_CUST_PWR) && _nvmOp == NVM_IDLE &&
+       _reg[FTP_CUST_PASSWORD_REG] == FTP_CUST_PASSWORD)
+    {
+      _reg[FTP_CTRL_0] |= FTP_CUST_REQ;
+      startNvmOperation(_reg[FTP_CTRL_1] & FTP_CUST_OPCODE, value & FTP_CUST_SECT, now);
+    }
+    return;
+  }
+
+  _reg[reg] = value;
+}
+
+uint8_t EmulatedSTUSB4500::alertStatus(void)
+{
+  uint8_t alert = 0;
+
+  if(_reg[PORT_STATUS_0] & 0x01)              alert |= ALERT_CC_DETECTION_STATUS;
+  if(_reg[TYPEC_MONITORING_STATUS_0] & 0x0E)  alert |= ALERT_MONITORING_STATUS;
+  if(_reg[CC_HW_FAULT_STATUS_0] & 0xF0)       alert |= ALERT_HW_FAULT_STATUS;
+  if(_reg[PRT_STATUS] & 0x15)                 alert |= ALERT_PRT_STATUS;
+  if(_hardResetAlert)                         alert |= ALERT_HARD_RESET;
+
+  return alert;
+}
+
+void EmulatedSTUSB4500::process(void)
+{
+  uint64_t now = hostMicros();
+
+  //Run the due events in time order
+  while(!_brownedOut)
+  {
+    bool pe = _peEvent != EV_NONE && _peDue <= now;
+    bool nvm = _nvmOp != NVM_IDLE && _nvmDue <= now;
+    if(!pe && !nvm) break;
+
+    if(nvm && (!pe || _nvmDue <= _peDue)) finishNvmOperation();
+    else
+    {
+      uint8_t event = _peEvent;
+      _peEvent = EV_NONE;
+      runEvent(event, _peDue);
+    }
+  }
+}
+
+void EmulatedSTUSB4500::schedule(uint8_t event, uint64_t due)
+{
+  _peEvent = event;
+  _peDue = due;
+}
+
+void EmulatedSTUSB4500::runEvent(uint8_t event, uint64_t now)
+{
+  switch(event)
+  {
+    case EV_VBUS_ON:
+      setVbus(5000);
+      setPe(PE_SNK_STARTUP);
+      waitForCapabilities(now);
+      break;
+
+    case EV_CAPABILITIES:
+    {
+      uint8_t count = _source->getPdoCount();
+      receive(MSG_SOURCE_CAPABILITIES, count);
+      for(uint8_t i=0; i<count; i++)
+      {
+        uint32_t pdo = _source->getPdo(i);
+        for(uint8_t j=0; j<4; j++) _reg[EMU_RX_DATA_OBJ + i*4 + j] = pdo >> (8*j);
+      }
+      setPe(PE_SNK_EVALUATE_CAPABILITY);
+      schedule(EV_REQUEST, now + EMU_EVALUATE);
+      break;
+    }
+
+    case EV_REQUEST:
+    {
+      request(now);
+      setPe(PE_SNK_SELECT_CAPABILITY);
+
+      uint32_t latency = _source->latency(_source->getTiming().accept);
+      if(_source->deliver() && latency < EMU_SENDER_RESPONSE) schedule(EV_ACCEPT, now + latency);
+      else schedule(EV_HARD_RESET, now + EMU_SENDER_RESPONSE);
+      break;
+    }
+
+    case EV_ACCEPT:
+    {
+      receive(MSG_ACCEPT, 0);
+      setPe(PE_SNK_TRANSITION_SINK);
+
+      uint32_t latency = _source->latency(_source->getTiming().psRdy);
+      if(_source->deliver() && latency < EMU_PS_TRANSITION) schedule(EV_PS_RDY, now + latency);
+      else schedule(EV_HARD_RESET, now + EMU_PS_TRANSITION);
+      break;
+    }
+
+    case EV_PS_RDY:
+      receive(MSG_PS_RDY, 0);
+      setVbus(_contractVoltage);
+      setPe(PE_SNK_READY);
+      _contract = true;
+      _contracts++;
+      _hardResetCount = 0;
+      break;
+
+    case EV_SOFT_RESET_ACCEPT:
+      receive(MSG_ACCEPT, 0);
+      for(uint8_t i=0; i<4; i++) _reg[RDO_REG_STATUS + i] = 0;
+      waitForCapabilities(now);
+      break;
+
+    case EV_HARD_RESET:
+      hardReset(now, false);
+      break;
+
+    case EV_SOURCE_HARD_RESET:
+      hardReset(now, true);
+      break;
+
+    case EV_SHUTDOWN:
+      setPe(PE_HARD_RESET_SHUTDOWN);
+      setVbus(0);
+      schedule(EV_RECOVERY, now + _source->latency(_source->getTiming().recovery));
+      break;
+
+    case EV_RECOVERY:
+      setPe(PE_HARD_RESET_RECOVERY);
+      schedule(EV_VBUS_ON, now + _source->latency(_source->getTiming().vbusOn));
+      break;
+  }
+}
+
+void EmulatedSTUSB4500::waitForCapabilities(uint64_t now)
+{
+  setPe(PE_SNK_WAIT_FOR_CAPABILITIES);
+
+  //The source resends Source_Capabilities until one gets through, the sink gives
+  //up waiting after tTypeCSinkWaitCap
+  uint32_t latency = EMU_SINK_WAIT_CAP + 1;
+  if(_source->isPdCapable())
+  {
+    latency = _source->latency(_source->getTiming().capabilities);
+    while(latency <= EMU_SINK_WAIT_CAP && !_source->deliver()) latency += EMU_SEND_SOURCE_CAP;
+  }
+
+  if(latency <= EMU_SINK_WAIT_CAP) schedule(EV_CAPABILITIES, now + latency);
+  else if(_hardResetCount < EMU_HARD_RESET_COUNT) schedule(EV_HARD_RESET, now + EMU_SINK_WAIT_CAP);
+}
+
+void EmulatedSTUSB4500::request(uint64_t now)
+{
+  (void)now;
+  uint8_t number = _reg[DPM_PDO_NUMB] & 0x07;
+  if(number < 1) number = 1;
+  else if(number > 3) number = 3;
+
+  uint32_t sink[3];
+  for(uint8_t i=0; i<3; i++)
+  {
+    sink[i] = 0;
+    for(uint8_t j=0; j<4; j++) sink[i] |= (uint32_t)_reg[DPM_SNK_PDO1 + i*4 + j] << (8*j);
+  }
+
+  //Highest priority sink PDO first: same voltage, and enough current
+  uint8_t position = 0;
+  uint16_t sinkCurrent = 0;
+  uint16_t sourceCurrent = 0;
+  for(int8_t i=number-1; i>=0 && position == 0; i--)
+  {
+    for(uint8_t s=0; s<_source->getPdoCount(); s++)
+    {
+      uint32_t pdo = _source->getPdo(s);
+      if((pdo >> 30) == 0 && ((pdo >> 10) & 0x3FF) == ((sink[i] >> 10) & 0x3FF) && (pdo & 0x3FF) >= (sink[i] & 0x3FF))
+      {
+        position = s + 1;
+        sinkCurrent = sink[i] & 0x3FF;
+        sourceCurrent = pdo & 0x3FF;
+        break;
+      }
+    }
+  }
+
+  uint32_t rdo;
+  if(position != 0)
+  {
+    uint16_t current = _reqSrcCurrent ? sourceCurrent : sinkCurrent;
+    rdo = ((uint32_t)position << 28) | ((uint32_t)current << 10) | current;
+  }
+  else
+  {
+    //Capability mismatch: 5V with what the source can give, the max current is what the sink wants
+    position = 1;
+    sinkCurrent = sink[0] & 0x3FF;
+    sourceCurrent = _source->getPdo(0) & 0x3FF;
+    uint16_t current = sinkCurrent < sourceCurrent ? sinkCurrent : sourceCurrent;
+    rdo = (1UL << 28) | (1UL << 26) | ((uint32_t)current << 10) | sinkCurrent;
+  }
+
+  _contractVoltage = _source->getPdoVoltage(position - 1);
+  for(uint8_t j=0; j<4; j++) _reg[RDO_REG_STATUS + j] = rdo >> (8*j);
+}
+
+void EmulatedSTUSB4500::hardReset(uint64_t now, bool fromSource)
+{
+  if(!fromSource) _hardResetCount++;
+  _hardResets++;
+  _hardResetAlert = true;
+  if(fromSource) _reg[PRT_STATUS] |= 0x01;
+  _contract = false;
+  for(uint8_t i=0; i<4; i++) _reg[RDO_REG_STATUS + i] = 0;
+  setPe(PE_HARD_RESET);
+
+  //A source without PD ignores the Hard_Reset and keeps VBUS on
+  if(_source->isPdCapable()) schedule(EV_SHUTDOWN, now + EMU_PS_HARD_RESET);
+  else schedule(EV_VBUS_ON, now + EMU_PS_HARD_RESET);
+}
+
+void EmulatedSTUSB4500::receive(uint8_t type, uint8_t objects)
+{
+  //Source power role, PD revision 2.0, message ID and number of data objects
+  uint16_t header = type | (1 << 6) | (1 << 8) | ((_messageId & 0x07) << 9) | ((objects & 0x07) << 12);
+  _messageId++;
+
+  _reg[EMU_RX_BYTE_CNT] = objects * 4;
+  _reg[EMU_RX_HEADER] = header & 0xFF;
+  _reg[EMU_RX_HEADER + 1] = header >> 8;
+  _reg[PRT_STATUS] |= 0x04;
+}
+
+void EmulatedSTUSB4500::setPe(uint8_t state)
+{
+  _reg[PE_FSM] = state;
+}
+
+void EmulatedSTUSB4500::setVbus(uint16_t millivolts)
+{
+  //VBUS valid and ready above 4V, safe 0V below 0.8V
+  uint8_t monitoring = millivolts >= 4000 ? 0x0A : millivolts < 800 ? 0x04 : 0x00;
+  uint8_t changed = (_reg[TYPEC_MONITORING_STATUS_1] ^ monitoring) & 0x0E;
+
+  _reg[TYPEC_MONITORING_STATUS_0] |= changed;
+  _reg[TYPEC_MONITORING_STATUS_1] = (_reg[TYPEC_MONITORING_STATUS_1] & ~0x0E) | monitoring;
+  _vbus = millivolts;
+}
+
+void EmulatedSTUSB4500::startNvmOperation(uint8_t op, uint8_t sectorNum, uint64_t now)
+{
+  //Busy times of the FTP controller, in microseconds
+  uint32_t duration = 100;
+  if(op == SOFT_PROG_SECTOR) duration = 15000;
+  else if(op == ERASE_SECTOR) duration = 30000;
+  else if(op == PROG_SECTOR)  duration = 8000;
+
+  _nvmOp = op;
+  _nvmSector = sectorNum;
+  _nvmDue = now + duration;
+}
+
+void EmulatedSTUSB4500::finishNvmOperation(void)
+{
+  uint8_t op = _nvmOp;
+  _nvmOp = NVM_IDLE;
+  _reg[FTP_CTRL_0] &= ~FTP_CUST_REQ;
+
+  switch(op)
+  {
+    case READ:
+      if(_nvmSector < 5) memcpy(&_reg[RW_BUFFER], _nvm[_nvmSector], 8);
+      break;
+    case WRITE_PL:
+      memcpy(_programLoad, &_reg[RW_BUFFER], 8);
+      break;
+    case WRITE_SER:
+      _eraseMask = _reg[FTP_CTRL_1] >> 3;
+      break;
+    case SOFT_PROG_SECTOR:
+      break;
+    case ERASE_SECTOR:
+      for(uint8_t i=0; i<5; i++)
+      {
+        if(_eraseMask & (1<<i)) memset(_nvm[i], 0, 8);
+      }
+      _nvmErases++;
+      break;
+    case PROG_SECTOR:
+      //Programming only sets bits, the sector has to be erased first
+      if(_nvmSector < 5)
+      {
+        for(uint8_t j=0; j<8; j++) _nvm[_nvmSector][j] |= _programLoad[j];
+      }
+      _nvmPrograms++;
+      break;
+  }
+
+  if((op == ERASE_SECTOR || op == PROG_SECTOR) && _nvmOpsLeft > 0 && --_nvmOpsLeft == 0)
+  {
+    _brownedOut = true;
+    _peEvent = EV_NONE;
+  }
+}
+
+void EmulatedSTUSB4500::powerCycle(void)
+{
+  reset();
+  if(_source != NULL) attach(*_source);
+}
+
+void EmulatedSTUSB4500::attach(SimulatedSource &source)
+{
+  process();
+  _source = &source;
+  _hardResetCount = 0;
+
+  //Rp level seen on CC1: 1 = Default USB, 2 = 1.5A, 3 = 3.0A
+  uint16_t current = source.getTypeCCurrent();
+  _reg[CC_STATUS] = current >= 3000 ? 3 : current >= 1500 ? 2 : 1;
+  _reg[PORT_STATUS_1] |= 0x01;
+  _reg[PORT_STATUS_0] |= 0x01;
+  setPe(PE_SNK_DISCOVERY);
+
+  schedule(EV_VBUS_ON, hostMicros() + source.latency(source.getTiming().vbusOn));
+}
+
+void EmulatedSTUSB4500::detach(void)
+{
+  process();
+  _source = NULL;
+  _contract = false;
+  _peEvent = EV_NONE;
+
+  _reg[CC_STATUS] = 0;
+  _reg[PORT_STATUS_1] &= ~0x01;
+  _reg[PORT_STATUS_0] |= 0x01;
+  for(uint8_t i=0; i<4; i++) _reg[RDO_REG_STATUS + i] = 0;
+  setVbus(0);
+  setPe(PE_INIT);
+}
+
+void EmulatedSTUSB4500::sourceHardReset(void)
+{
+  process();
+  if(_source != NULL && _vbus != 0) hardReset(hostMicros(), true);
+}
+
+void EmulatedSTUSB4500::setNvm(const uint8_t image[][8])
+{
+  memcpy(_nvm, image, sizeof(_nvm));
+}
+
+void EmulatedSTUSB4500::getNvm(uint8_t image[][8]) const
+{
+  memcpy(image, _nvm, sizeof(_nvm));
+}
+
+void EmulatedSTUSB4500::setPresent(bool present)
+{
+  _present = present;
+}
+
+void EmulatedSTUSB4500::failTransactions(uint8_t count)
+{
+  _failTransactions = count;
+}
+
+void EmulatedSTUSB4500::failReads(uint8_t count)
+{
+  _failReads = count;
+}
+
+void EmulatedSTUSB4500::failAfterNvmOperations(uint16_t count)
+{
+  _nvmOpsLeft = count;
+}
+
+uint8_t EmulatedSTUSB4500::peekRegister(uint8_t reg)
+{
+  process();
+  return reg == ALERT_STATUS_1 ? alertStatus() : _reg[reg];
+}
+
+void EmulatedSTUSB4500::pokeRegister(uint8_t reg, uint8_t value)
+{
+  process();
+  _reg[reg] = value;
+}
+
+uint8_t EmulatedSTUSB4500::getPeState(void)
+{
+  process();
+  return _reg[PE_FSM];
+}
+
+bool EmulatedSTUSB4500::hasContract(void)
+{
+  process();
+  return _contract;
+}
+
+uint32_t EmulatedSTUSB4500::getRdo(void)
+{
+  process();
+  uint32_t rdo = 0;
+  for(uint8_t j=0; j<4; j++) rdo |= (uint32_t)_reg[RDO_REG_STATUS + j] << (8*j);
+  return rdo;
+}
+
+uint16_t EmulatedSTUSB4500::getVbus(void)
+{
+  process();
+  return _vbus;
+}
+
+bool EmulatedSTUSB4500::alertAsserted(void)
+{
+  process();
+  if(!_present || _brownedOut) return false;
+  return (alertStatus() & ~_reg[ALERT_STATUS_1_MASK]) != 0;
+}
+
+int EmulatedSTUSB4500::alertPin(void *emulator)
+{
+  return ((EmulatedSTUSB4500 *)emulator)->alertAsserted() ? LOW : HIGH;
+}
@@ -0,0 +1,177 @@
+/*
+  Register level emulation of the STUSB4500 for the host build.
+
+  The emulator sits on the emulated I2C bus (see Wire.h) and models what the
+  library relies on:
+    - the register file with auto-increment, the clear-on-read transition
+      registers of the status window and the ALERT pin;
+    - the NVM and its FTP controller (password, opcodes, busy times), and the
+      reload of the volatile PDO registers from the NVM at power up;
+    - the sink policy engine (PE_FSM) negotiating with a SimulatedSource:
+      capabilities, request built from the DPM_SNK_PDO registers, accept,
+      PS_RDY, soft reset, and hard reset with VBUS recovery, including the
+      sink's SinkWaitCap, SenderResponse and PSTransition timeouts;
+    - the RDO and the RX buffer holding the last message received.
+  Time is the simulated clock of the host Arduino core. Pending events are run
+  whenever the emulator is accessed, so its state is always up to date with
+  millis()/micros().
+
+  Failure injection: absent chip, NACKed transactions, brown-out during NVM
+  programming, chip reset (volatile registers reloaded from the NVM).
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef EMULATED_STUSB4500_H
+#define EMULATED_STUSB4500_H
+
+#include <Wire.h>
+#include "simulated_source.h"
+
+//RX buffer, the last PD message received
+#define EMU_RX_BYTE_CNT         0x30
+#define EMU_RX_HEADER           0x31
+#define EMU_RX_DATA_OBJ         0x33
+#define EMU_DEVICE_ID           0x2F
+
+//Sink timers, in microseconds
+#define EMU_SENDER_RESPONSE     27000   //tSenderResponse
+#define EMU_SINK_WAIT_CAP       465000  //tTypeCSinkWaitCap
+#define EMU_PS_TRANSITION       500000  //tPSTransition
+#define EMU_SEND_SOURCE_CAP     150000  //tTypeCSendSourceCap, a lost Source_Capabilities is resent
+#define EMU_EVALUATE            300     //Source_Capabilities to Request
+#define EMU_PS_HARD_RESET       30000   //Hard reset to VBUS off (tPSHardReset)
+#define EMU_HARD_RESET_COUNT    2       //nHardResetCount
+
+class EmulatedSTUSB4500 : public HostI2CDevice {
+  public:
+  EmulatedSTUSB4500(uint8_t address = 0x28);
+
+  uint8_t address(void) const { return _address; }
+  bool i2cWrite(const uint8_t *data, uint8_t length);
+  bool i2cRead(uint8_t *data, uint8_t length);
+
+  /*
+    Runs the events that are due at the current simulated time. Called by every
+	bus access, ALERT pin read and accessor below.
+  */
+  void process(void);
+
+  /*
+    Power and cable.
+	powerCycle() - VDD off and on: the registers get their reset values and the
+	               volatile PDOs are reloaded from the NVM. A brown-out is cleared.
+	attach()     - plugs in a source. With a PD source the negotiation starts.
+	detach()     - unplugs it.
+	sourceHardReset() - the source sends a Hard_Reset.
+  */
+  void powerCycle(void);
+  void attach(SimulatedSource &source);
+  void detach(void);
+  void sourceHardReset(void);
+
+  /*
+    NVM content, 5 sectors of 8 bytes. Takes effect on the volatile registers at
+	the next powerCycle().
+  */
+  void setNvm(const uint8_t image[][8]);
+  void getNvm(uint8_t image[][8]) const;
+
+  /*
+    Failure injection.
+	setPresent()        - false to NACK every transaction.
+	failTransactions()  - NACK the next count transactions.
+	failReads()         - NACK the next count read transactions only.
+	failAfterNvmOperations() - brown out right after count more NVM erase or program
+	                      operations complete: the chip stops answering until powerCycle().
+  */
+  void setPresent(bool present);
+  void failTransactions(uint8_t count);
+  void failReads(uint8_t count);
+  void failAfterNvmOperations(uint16_t count);
+  bool brownedOut(void) const { return _brownedOut; }
+
+  /*
+    Observation, without the side effects of a bus read.
+  */
+  uint8_t peekRegister(uint8_t reg);
+  void pokeRegister(uint8_t reg, uint8_t value);
+  uint8_t getPeState(void);
+  bool hasContract(void);
+  uint32_t getRdo(void);
+  uint16_t getVbus(void);       //Millivolts
+  bool alertAsserted(void);
+
+  /*
+    Level of the ALERT pin (active low), for hostSetPinReader():
+	  hostSetPinReader(2, EmulatedSTUSB4500::alertPin, &chip);
+  */
+  static int alertPin(void *emulator);
+
+  /*
+    Counters since the emulator was created.
+  */
+  uint32_t getSoftResets(void) const { return _softResets; }
+  uint32_t getHardResets(void) const { return _hardResets; }
+  uint32_t getContracts(void) const { return _contracts; }
+  uint32_t getNvmErases(void) const { return _nvmErases; }
+  uint32_t getNvmPrograms(void) const { return _nvmPrograms; }
+  uint32_t getTransactions(void) const { return _transactions; }
+
+  private:
+  uint8_t _address;
+  uint8_t _reg[256];
+  uint8_t _pointer;
+  uint8_t _nvm[5][8];
+  uint8_t _programLoad[8];
+  uint8_t _eraseMask;
+  bool _reqSrcCurrent;          //REQ_SRC_CURRENT, loaded from the NVM at power up
+
+  bool _present;
+  bool _brownedOut;
+  uint8_t _failTransactions;
+  uint8_t _failReads;
+  uint16_t _nvmOpsLeft;         //0 = no brown-out scheduled
+  bool _hardResetAlert;
+
+  SimulatedSource *_source;
+  bool _contract;
+  uint16_t _vbus;
+  uint16_t _contractVoltage;
+  uint8_t _hardResetCount;
+  uint8_t _messageId;
+
+  uint8_t _peEvent;
+  uint64_t _peDue;
+  uint8_t _nvmOp;
+  uint8_t _nvmSector;
+  uint64_t _nvmDue;
+
+  uint32_t _softResets;
+  uint32_t _hardResets;
+  uint32_t _contracts;
+  uint32_t _nvmErases;
+  uint32_t _nvmPrograms;
+  uint32_t _transactions;
+
+  void reset(void);
+  void loadPdos(void);
+  uint8_t readRegister(uint8_t reg);
+  void writeRegister(uint8_t reg, uint8_t value);
+  uint8_t alertStatus(void);
+
+  void schedule(uint8_t event, uint64_t due);
+  void runEvent(uint8_t event, uint64_t now);
+  void startNvmOperation(uint8_t op, uint8_t sectorNum, uint64_t now);
+  void finishNvmOperation(void);
+
+  void setVbus(uint16_t millivolts);
+  void waitForCapabilities(uint64_t now);
+  void request(uint64_t now);
+  void hardReset(uint64_t now, bool fromSource);
+  void receive(uint8_t type, uint8_t objects);
+  void setPe(uint8_t state);
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+  Simulated USB PD source (charger) for the STUSB4500 emulator.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "simulated_source.h"
+
+//Typical values, well inside the USB PD 3.0 limits
+static const SimulatedSourceTiming defaultTiming = {
+  150000, //capabilities, tFirstSourceCap is at most 250ms
+  3000,   //accept, within tSenderResponse (24-30ms)
+  35000,  //psRdy, tSrcTransition + supply settling, at most 275ms
+  2000,   //softReset
+  750000, //recovery, tSrcRecover is 0.66-1s
+  100000, //vbusOn
+  0       //jitter
+};
+
+SimulatedSource::SimulatedSource(void)
+{
+  _pdoCount = 0;
+  _typeCCurrent = 3000;
+  _pdCapable = true;
+  _hardResetOnSoftReset = false;
+  _timing = defaultTiming;
+  _loss = 0;
+  _drop = 0;
+  _random = 1;
+  _sent = 0;
+  _lost = 0;
+  addFixedPdo(5000, 3000);
+}
+
+void SimulatedSource::clearPdos(void)
+{
+  _pdoCount = 0;
+}
+
+bool SimulatedSource::addFixedPdo(uint16_t millivolts, uint16_t milliamps)
+{
+  if(_pdoCount >= SOURCE_MAX_PDOS) return false;
+
+  //Fixed supply: bits 31:30 = 00, voltage in 50mV units in 19:10, current in 10mA units in 9:0
+  _pdo[_pdoCount++] = ((uint32_t)(millivolts / 50) << 10) | ((milliamps / 10) & 0x3FF);
+  return true;
+}
+
+uint8_t SimulatedSource::getPdoCount(void) const
+{
+  return _pdoCount;
+}
+
+uint32_t SimulatedSource::getPdo(uint8_t index) const
+{
+  return index < _pdoCount ? _pdo[index] : 0;
+}
+
+uint16_t SimulatedSource::getPdoVoltage(uint8_t index) const
+{
+  return ((getPdo(index) >> 10) & 0x3FF) * 50;
+}
+
+uint16_t SimulatedSource::getPdoCurrent(uint8_t index) const
+{
+  return (getPdo(index) & 0x3FF) * 10;
+}
+
+void SimulatedSource::setTypeCCurrent(uint16_t milliamps)
+{
+  _typeCCurrent = milliamps;
+}
+
+uint16_t SimulatedSource::getTypeCCurrent(void) const
+{
+  return _typeCCurrent;
+}
+
+void SimulatedSource::setPdCapable(bool capable)
+{
+  _pdCapable = capable;
+}
+
+bool SimulatedSource::isPdCapable(void) const
+{
+  return _pdCapable;
+}
+
+void SimulatedSource::setTiming(const SimulatedSourceTiming &timing)
+{
+  _timing = timing;
+}
+
+const SimulatedSourceTiming &SimulatedSource::getTiming(void) const
+{
+  return _timing;
+}
+
+void SimulatedSource::setMessageLoss(uint8_t percent)
+{
+  _loss = percent > 100 ? 100 : percent;
+}
+
+void SimulatedSource::dropNextMessages(uint8_t count)
+{
+  _drop = count;
+}
+
+void SimulatedSource::setHardResetOnSoftReset(bool enable)
+{
+  _hardResetOnSoftReset = enable;
+}
+
+bool SimulatedSource::hardResetOnSoftReset(void) const
+{
+  return _hardResetOnSoftReset;
+}
+
+void SimulatedSource::seed(uint32_t seed)
+{
+  _random = seed == 0 ? 1 : seed;
+}
+
+uint32_t SimulatedSource::latency(uint32_t base)
+{
+  if(_timing.jitter == 0) return base;
+  return base + random() % (_timing.jitter + 1);
+}
+
+bool SimulatedSource::deliver(void)
+{
+  _sent++;
+
+  bool lost = false;
+  if(_drop > 0)
+  {
+    _drop--;
+    lost = true;
+  }
+  else if(_loss > 0 && random() % 100 < _loss) lost = true;
+
+  if(lost) _lost++;
+  return !lost;
+}
+
+uint32_t SimulatedSource::getMessagesSent(void) const
+{
+  return _sent;
+}
+
+uint32_t SimulatedSource::getMessagesLost(void) const
+{
+  return _lost;
+}
+
+void SimulatedSource::clearCounters(void)
+{
+  _sent = 0;
+  _lost = 0;
+}
+
+//Numerical Recipes LCG, the upper bits are good enough for jitter and loss
+uint32_t SimulatedSource::random(void)
+{
+  _random = _random * 1664525UL + 1013904223UL;
+  return _random >> 8;
+}
@@ -0,0 +1,110 @@
+/*
+  Simulated USB PD source (charger) for the STUSB4500 emulator.
+
+  A source has a list of fixed supply PDOs, the Type-C current it advertises
+  on CC, and the latencies of its side of the negotiation. Messages it sends
+  can be lost (randomly or on demand) to exercise the sink's timeouts and hard
+  reset recovery. The random numbers come from a seeded generator so a run can
+  be reproduced.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef SIMULATED_SOURCE_H
+#define SIMULATED_SOURCE_H
+
+#include <stdint.h>
+
+#define SOURCE_MAX_PDOS             7
+
+/*
+  Latencies of the source, in microseconds. Each one gets a random extra
+  delay of 0 to jitter microseconds.
+	capabilities - from VBUS on (attach, hard reset) or a soft reset Accept to
+	               the first Source_Capabilities.
+	accept       - from the Request to the Accept.
+	psRdy        - from the Accept to PS_RDY, the supply transition.
+	softReset    - from the Soft_Reset to its Accept.
+	recovery     - VBUS off time during a hard reset (tSrcRecover).
+	vbusOn       - VBUS rise time after an attach or a hard reset.
+*/
+struct SimulatedSourceTiming {
+  uint32_t capabilities;
+  uint32_t accept;
+  uint32_t psRdy;
+  uint32_t softReset;
+  uint32_t recovery;
+  uint32_t vbusOn;
+  uint32_t jitter;
+};
+
+class SimulatedSource {
+  public:
+  SimulatedSource(void);
+
+  /*
+    Capabilities. PDO1 must be 5V. Returns false if the list is full.
+  */
+  void clearPdos(void);
+  bool addFixedPdo(uint16_t millivolts, uint16_t milliamps);
+  uint8_t getPdoCount(void) const;
+  uint32_t getPdo(uint8_t index) const; //Raw 32-bit fixed supply PDO, index 0 = PDO1
+  uint16_t getPdoVoltage(uint8_t index) const;
+  uint16_t getPdoCurrent(uint8_t index) const;
+
+  /*
+    Type-C current advertised on CC: 500 (Default USB), 1500 or 3000mA.
+    A source that is not PD capable never sends Source_Capabilities.
+  */
+  void setTypeCCurrent(uint16_t milliamps);
+  uint16_t getTypeCCurrent(void) const;
+  void setPdCapable(bool capable);
+  bool isPdCapable(void) const;
+
+  void setTiming(const SimulatedSourceTiming &timing);
+  const SimulatedSourceTiming &getTiming(void) const;
+
+  /*
+    Failure injection.
+	setMessageLoss()      - percentage of the messages sent by the source that are lost.
+	dropNextMessages()    - the next count messages sent by the source are lost.
+	setHardResetOnSoftReset() - answer a Soft_Reset with a Hard_Reset, as some chargers do.
+  */
+  void setMessageLoss(uint8_t percent);
+  void dropNextMessages(uint8_t count);
+  void setHardResetOnSoftReset(bool enable);
+  bool hardResetOnSoftReset(void) const;
+  void seed(uint32_t seed);
+
+  /*
+    Used by the emulator: a latency with its jitter, and whether the next message
+	sent by the source reaches the sink.
+  */
+  uint32_t latency(uint32_t base);
+  bool deliver(void);
+
+  /*
+    Counters since the last clearCounters().
+  */
+  uint32_t getMessagesSent(void) const;
+  uint32_t getMessagesLost(void) const;
+  void clearCounters(void);
+
+  private:
+  uint32_t _pdo[SOURCE_MAX_PDOS];
+  uint8_t _pdoCount;
+  uint16_t _typeCCurrent;
+  bool _pdCapable;
+  bool _hardResetOnSoftReset;
+  SimulatedSourceTiming _timing;
+  uint8_t _loss;
+  uint8_t _drop;
+  uint32_t _random;
+  uint32_t _sent;
+  uint32_t _lost;
+
+  uint32_t random(void);
+};
+
+#endif
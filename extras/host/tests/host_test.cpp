@@ -0,0 +1,69 @@
+/*
+  Minimal test framework for the host build.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "host_test.h"
+
+static HostTestCase *first = NULL;
+static HostTestCase *last = NULL;
+static int failures = 0;
+
+HostTestCase::HostTestCase(const char *testName, HostTestFunction testFunction)
+{
+  name = testName;
+  function = testFunction;
+  next = NULL;
+
+  if(last == NULL) first = this;
+  else last->next = this;
+  last = this;
+}
+
+void hostCheck(bool condition, const char *expression, const char *file, int line)
+{
+  if(condition) return;
+  printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+  failures++;
+}
+
+void hostCheckEqual(long expected, long actual, const char *expression, const char *file, int line)
+{
+  if(expected == actual) return;
+  printf("  %s:%d: %s is %ld, expected %ld\n", file, line, expression, actual, expected);
+  failures++;
+}
+
+int main(int argc, char **argv)
+{
+  int run = 0;
+  int failed = 0;
+
+  for(HostTestCase *test = first; test != NULL; test = test->next)
+  {
+    //host_tests [name...] runs the named tests only
+    if(argc > 1)
+    {
+      bool selected = false;
+      for(int i=1; i<argc; i++) if(strcmp(argv[i], test->name) == 0) selected = true;
+      if(!selected) continue;
+    }
+
+    int before = failures;
+    hostResetClock();
+    test->function();
+    run++;
+
+    if(failures != before)
+    {
+      failed++;
+      printf("FAIL %s\n", test->name);
+    }
+    else printf("ok   %s\n", test->name);
+  }
+
+  printf("%d tests, %d failed\n", run, failed);
+  return failed == 0 ? 0 : 1;
+}
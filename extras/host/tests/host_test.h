@@ -0,0 +1,84 @@
+/*
+  Minimal test framework for the host build.
+
+  TEST(name) defines a test case, registered at start-up and run in file order
+  by host_tests. CHECK() and CHECK_EQUAL() record a failure and carry on, so a
+  test reports every wrong value at once.
+
+  HostBench is the usual fixture: an emulated STUSB4500 at 0x28 on Wire, a
+  simulated 5V/3A source and a library object. The simulated clock is reset
+  for each test.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include "SparkFun_STUSB4500.h"
+#include "../emulator/emulated_stusb4500.h"
+#include "../emulator/simulated_source.h"
+
+typedef void (*HostTestFunction)(void);
+
+struct HostTestCase {
+  const char *name;
+  HostTestFunction function;
+  HostTestCase *next;
+
+  HostTestCase(const char *testName, HostTestFunction testFunction);
+};
+
+void hostCheck(bool condition, const char *expression, const char *file, int line);
+void hostCheckEqual(long expected, long actual, const char *expression, const char *file, int line);
+
+#define TEST(name)                                                   \
+  static void name(void);                                            \
+  static HostTestCase name##_case(#name, name);                      \
+  static void name(void)
+
+#define CHECK(condition)                  hostCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual)     hostCheckEqual((long)(expected), (long)(actual), #actual, __FILE__, __LINE__)
+
+/*
+  Emulated board with a source, attached to Wire for the lifetime of the object.
+*/
+struct HostBench {
+  EmulatedSTUSB4500 chip;
+  SimulatedSource source;
+  STUSB4500 usb;
+
+  HostBench(uint8_t address = 0x28) : chip(address)
+  {
+    Wire.attach(chip);
+  }
+
+  ~HostBench(void)
+  {
+    Wire.detach(chip);
+  }
+
+  //Plugs the source in and waits for the first contract. Returns false on a timeout.
+  bool attach(uint32_t timeout = 2000)
+  {
+    chip.attach(source);
+    return waitContract(timeout);
+  }
+
+  bool waitContract(uint32_t timeout = 2000)
+  {
+    uint32_t start = millis();
+    while(!chip.hasContract())
+    {
+      if(millis() - start > timeout) return false;
+      delay(1);
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+  NACKed and short reads: reported by the read helper, and never taken as
+  register contents.
+*/
+
+#include "host_test.h"
+
+TEST(nacked_read_skips_the_reset_check)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.setResetDetection(100);
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.setPdoNumber(2);
+
+  //A NACK used to read as 0xFF bytes, which looked like a reset
+  bench.chip.failReads(1);
+  delay(150);
+  CHECK(!bench.usb.update());
+  CHECK_EQUAL(1, bench.usb.getCheckCount());
+  CHECK_EQUAL(0, bench.usb.getResetCount());
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+  CHECK_EQUAL(2, bench.usb.getPdoNumber());
+
+  //The shadow was left alone: the next check matches
+  delay(150);
+  CHECK(!bench.usb.update());
+  CHECK_EQUAL(2, bench.usb.getCheckCount());
+  CHECK_EQUAL(0, bench.usb.getResetCount());
+}
+
+TEST(reset_is_still_detected_after_a_failed_check)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.setResetDetection(100);
+  bench.usb.setVoltage(2, 9.0);
+
+  bench.chip.failTransactions(1);
+  delay(150);
+  CHECK(!bench.usb.update());
+
+  bench.chip.powerCycle();
+  delay(150);
+  CHECK(bench.usb.update());
+  CHECK_EQUAL(1, bench.usb.getResetCount());
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+}
+
+TEST(read_keeps_the_local_nvm_copy_when_the_chip_is_gone)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.setFlexCurrent(1.5);
+
+  bench.chip.setPresent(false);
+  bench.usb.read();
+  CHECK_EQUAL(150, (long)(bench.usb.getFlexCurrent() * 100 + 0.5));
+
+  STUSB4500_Status status;
+  CHECK(bench.usb.readStatus(status) != 0);
+  bench.chip.setPresent(true);
+}
+
+TEST(write_is_refused_when_the_pdos_cannot_be_read)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.read();
+  bench.usb.setVoltage(2, 9.0);
+
+  uint8_t before[5][8], after[5][8];
+  bench.chip.getNvm(before);
+  uint32_t erases = bench.chip.getNvmErases();
+
+  //The NACKed read used to be saved as 20V and 5A with a warning
+  bench.chip.failReads(1);
+  CHECK_EQUAL(NVM_WRITE_BUS_ERROR, bench.usb.write());
+  bench.chip.getNvm(after);
+  CHECK(memcmp(before, after, sizeof(after)) == 0);
+  CHECK_EQUAL(erases, bench.chip.getNvmErases());
+
+  STUSB4500_Validation validation;
+  bench.chip.failReads(1);
+  CHECK_EQUAL(1, bench.usb.validate(validation));
+  CHECK_EQUAL(1, validation.count);
+  CHECK_EQUAL(VALIDATION_BUS_ERROR, validation.code[0]);
+
+  //Nothing is applied from a configuration that could not be read
+  STUSB4500_Config config;
+  CHECK_EQUAL(0, bench.usb.readConfig(config));
+  config.voltage[1] = 300;
+  bench.chip.failReads(1);
+  CHECK(bench.usb.writeConfig(config) != 0);
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+  bench.chip.failReads(1);
+  CHECK(bench.usb.readConfig(config) != 0);
+
+  CHECK_EQUAL(NVM_WRITE_OK, bench.usb.write());
+  bench.chip.getNvm(after);
+  CHECK(memcmp(before, after, sizeof(after)) != 0);
+}
+
+TEST(failed_nvm_read_leaves_the_test_mode_and_blocks_write)
+{
+  HostBench bench;
+
+  //The first sector poll is NACKed: begin() finds the chip but not its NVM
+  bench.chip.failReads(1);
+  CHECK(bench.usb.begin());
+  CHECK_EQUAL(0, bench.chip.peekRegister(FTP_CUST_PASSWORD_REG));
+
+  uint32_t erases = bench.chip.getNvmErases();
+  CHECK_EQUAL(NVM_WRITE_BUS_ERROR, bench.usb.write());
+  CHECK_EQUAL(erases, bench.chip.getNvmErases());
+
+  bench.usb.read();
+  CHECK_EQUAL(NVM_WRITE_OK, bench.usb.write());
+}
@@ -0,0 +1,208 @@
+/*
+  STUSB4500_CommandProtocol end to end: the PC client talks to the protocol over
+  an in-memory serial link, the protocol drives the emulated STUSB4500.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_CommandProtocol.h"
+#include "command_client.h"
+
+#define LINK_LENGTH 512
+
+//Serial port of the board: what the client sent, and what the board answers
+class LinkStream : public Stream {
+  public:
+  uint8_t input[LINK_LENGTH];
+  size_t inputHead = 0, inputTail = 0;
+  uint8_t output[LINK_LENGTH];
+  size_t outputHead = 0, outputTail = 0;
+
+  size_t write(uint8_t c)
+  {
+    if(outputHead == LINK_LENGTH) return 0;
+    output[outputHead++] = c;
+    return 1;
+  }
+  using Print::write;
+  int available(void) { return inputHead - inputTail; }
+  int read(void) { return inputTail < inputHead ? input[inputTail++] : -1; }
+  int peek(void) { return inputTail < inputHead ? input[inputTail] : -1; }
+
+  void hostInput(const char *text)
+  {
+    while(*text && inputHead < LINK_LENGTH) input[inputHead++] = *text++;
+  }
+
+  //Text printed by the board since the last call
+  const char *text(void)
+  {
+    static char line[LINK_LENGTH + 1];
+    size_t length = outputHead - outputTail;
+    memcpy(line, &output[outputTail], length);
+    line[length] = 0;
+    outputTail = outputHead;
+    return line;
+  }
+};
+
+//Client end of the link. The board only runs when the client waits for a byte.
+class LinkTransport : public CommandTransport {
+  public:
+  LinkStream &port;
+  STUSB4500_CommandProtocol &protocol;
+  int corruptByte = -1;
+
+  LinkTransport(LinkStream &link, STUSB4500_CommandProtocol &commands) : port(link), protocol(commands) {}
+
+  bool send(const uint8_t *data, uint8_t length)
+  {
+    for(uint8_t i=0; i<length && port.inputHead < LINK_LENGTH; i++)
+    {
+      port.input[port.inputHead++] = (i == corruptByte) ? data[i] ^ 0x10 : data[i];
+    }
+    corruptByte = -1;
+    return true;
+  }
+
+  int receive(uint32_t timeout)
+  {
+    if(port.outputTail == port.outputHead) protocol.update();
+    if(port.outputTail == port.outputHead) return -1;
+    return port.output[port.outputTail++];
+  }
+};
+
+struct CommandBench : HostBench {
+  LinkStream link;
+  STUSB4500_CommandProtocol protocol;
+  LinkTransport transport;
+  CommandClient client;
+
+  CommandBench(void) : transport(link, protocol), client(transport)
+  {
+    usb.begin();
+    protocol.begin(usb, link, true);
+  }
+};
+
+TEST(client_batch_is_applied_written_and_read_back)
+{
+  CommandBench bench;
+  CommandResult result;
+
+  bench.client.set(COMMAND_PARAM_VOLTAGE2, 180);
+  bench.client.set(COMMAND_PARAM_CURRENT2, 200);
+  bench.client.set(COMMAND_PARAM_PDO_NUMBER, 2);
+  CHECK_EQUAL(CLIENT_OK, bench.client.execute(COMMAND_FLAG_WRITE | COMMAND_FLAG_READ, result));
+  CHECK_EQUAL(COMMAND_OK, result.status);
+  CHECK_EQUAL(3, result.applied);
+  CHECK_EQUAL(NVM_WRITE_OK, result.writeResult);
+  CHECK(result.hasValues);
+  CHECK_EQUAL(180, result.values[COMMAND_PARAM_VOLTAGE2 - 1]);
+  CHECK_EQUAL(2, result.values[COMMAND_PARAM_PDO_NUMBER - 1]);
+
+  //Saved: the chip negotiates 9V with a charger after a power cycle
+  bench.source.addFixedPdo(9000, 3000);
+  bench.chip.powerCycle();
+  CHECK(bench.attach());
+  CHECK_EQUAL(9000, bench.chip.getVbus());
+  CHECK_EQUAL(0, bench.client.getSkippedBytes());
+}
+
+TEST(out_of_range_values_are_rejected_and_nothing_is_applied)
+{
+  CommandBench bench;
+  CommandResult result;
+  uint32_t erases = bench.chip.getNvmErases();
+
+  //259 used to be stored in the 8-bit PDO number as 3
+  bench.client.set(COMMAND_PARAM_VOLTAGE2, 180);
+  bench.client.set(COMMAND_PARAM_PDO_NUMBER, 259);
+  CHECK_EQUAL(CLIENT_OK, bench.client.execute(COMMAND_FLAG_WRITE | COMMAND_FLAG_READ, result));
+  CHECK_EQUAL(COMMAND_ERROR_PARAM, result.status);
+  CHECK_EQUAL(1, result.applied);
+  CHECK_EQUAL(COMMAND_NOT_WRITTEN, result.writeResult);
+  CHECK(result.values[COMMAND_PARAM_VOLTAGE2 - 1] != 180);
+  CHECK_EQUAL(erases, bench.chip.getNvmErases());
+
+  const uint16_t rejected[][2] = {
+    {COMMAND_PARAM_VOLTAGE1, 180}, {COMMAND_PARAM_VOLTAGE3, 99}, {COMMAND_PARAM_VOLTAGE3, 401},
+    {COMMAND_PARAM_CURRENT1, 501}, {COMMAND_PARAM_FLEX_CURRENT, 501}, {COMMAND_PARAM_PDO_NUMBER, 0},
+    {COMMAND_PARAM_UPPER_LIMIT2, 21}, {COMMAND_PARAM_LOWER_LIMIT3, 4}, {COMMAND_PARAM_LOWER_LIMIT1, 5},
+    {COMMAND_PARAM_GPIO_CTRL, 4}, {COMMAND_PARAM_REQ_SRC_CURRENT, 2}, {COMMAND_PARAM_COUNT + 1, 0},
+  };
+  for(uint8_t i=0; i<sizeof(rejected)/sizeof(rejected[0]); i++)
+  {
+    bench.client.set(rejected[i][0], rejected[i][1]);
+    CHECK_EQUAL(CLIENT_OK, bench.client.execute(0, result));
+    CHECK_EQUAL(COMMAND_ERROR_PARAM, result.status);
+  }
+}
+
+TEST(text_values_are_checked_before_scaling)
+{
+  CommandBench bench;
+
+  bench.link.hostInput("SET pdos=259\n");
+  bench.protocol.update();
+  CHECK(strcmp(bench.link.text(), "ERR parameter pdos\r\n") == 0);
+
+  //atol("-5000") used to wrap around to a valid 16-bit value
+  bench.link.hostInput("SET v2=-5000\nSET v2=9000x\nSET i2=5010\nSET pdos=0\n");
+  bench.protocol.update();
+  CHECK(strcmp(bench.link.text(), "ERR parameter v2\r\nERR parameter v2\r\nERR parameter i2\r\nERR parameter pdos\r\n") == 0);
+  CHECK_EQUAL(5, bench.protocol.getErrorCount());
+
+  bench.link.hostInput("SET v2=9000 pdos=2\n");
+  bench.protocol.update();
+  CHECK(strncmp(bench.link.text(), "OK applied=2", 12) == 0);
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+}
+
+TEST(client_gets_the_frame_error_of_a_corrupted_request)
+{
+  CommandBench bench;
+  CommandResult result;
+
+  bench.transport.corruptByte = 5;
+  bench.client.set(COMMAND_PARAM_PDO_NUMBER, 2);
+  CHECK_EQUAL(CLIENT_OK, bench.client.execute(0, result));
+  CHECK_EQUAL(COMMAND_ERROR_FRAME, result.status);
+  CHECK_EQUAL(COMMAND_NOT_WRITTEN, result.writeResult);
+
+  //Text output and a false sync ahead of the response are skipped
+  bench.link.write((const uint8_t *)"Ready\r\n\xC5", 8);
+  bench.client.set(COMMAND_PARAM_PDO_NUMBER, 2);
+  CHECK_EQUAL(CLIENT_OK, bench.client.execute(0, result));
+  CHECK_EQUAL(COMMAND_OK, result.status);
+  CHECK_EQUAL(8, bench.client.getSkippedBytes());
+}
+
+TEST(oversized_frame_gets_a_frame_error)
+{
+  CommandBench bench;
+
+  //Longer than the buffer, with false syncs in the payload
+  uint8_t payload[COMMAND_MAX_PAYLOAD + 4];
+  memset(payload, COMMAND_SYNC, sizeof(payload));
+  uint8_t frame[COMMAND_HEADER_LENGTH + sizeof(payload) + 1];
+  uint8_t frameLength = commandFrame(frame, 0x42, payload, sizeof(payload));
+  CHECK(bench.transport.send(frame, frameLength));
+  bench.protocol.update();
+
+  //One error response with the sequence number, nothing for the skipped bytes
+  uint8_t response[1] = { COMMAND_ERROR_FRAME };
+  uint8_t expected[COMMAND_HEADER_LENGTH + 2];
+  uint8_t expectedLength = commandFrame(expected, 0x42, response, 1);
+  CHECK_EQUAL(expectedLength, bench.link.outputHead - bench.link.outputTail);
+  CHECK(memcmp(expected, &bench.link.output[bench.link.outputTail], expectedLength) == 0);
+  bench.link.outputTail = bench.link.outputHead;
+  CHECK_EQUAL(1, bench.protocol.getErrorCount());
+
+  //The next request is read from its sync byte
+  CommandResult result;
+  bench.client.set(COMMAND_PARAM_PDO_NUMBER, 2);
+  CHECK_EQUAL(CLIENT_OK, bench.client.execute(0, result));
+  CHECK_EQUAL(COMMAND_OK, result.status);
+  CHECK_EQUAL(0, bench.client.getSkippedBytes());
+}
@@ -0,0 +1,235 @@
+/*
+  STUSB4500_Config: decode()/encode()/diff(), readConfig()/writeConfig(), and
+  200 random NVM images checked against the hand-coded masks the accessors
+  used before the field descriptors.
+*/
+
+#include "host_test.h"
+#include "stusb4500_config.h"
+#include "stusb4500_nvm_image.h"
+
+#define RANDOM_IMAGES 200
+
+//Fixed seed: every run checks the same images
+static uint32_t randomState;
+
+static uint32_t nextRandom(void)
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static void randomImage(uint8_t image[][8])
+{
+  for(uint8_t s=0; s<5; s++)
+  {
+    for(uint8_t b=0; b<8; b++) image[s][b] = nextRandom();
+  }
+}
+
+//A random configuration inside the ranges the NVM and the PDO registers hold exactly
+static void randomConfig(STUSB4500_Config &config)
+{
+  memset(&config, 0, sizeof(config));
+
+  config.voltage[0] = 100;
+  config.voltage[1] = 100 + nextRandom() % 301;
+  config.voltage[2] = 100 + nextRandom() % 301;
+  for(uint8_t i=0; i<3; i++) config.current[i] = nvmCurrentValue(1 + nextRandom() % 15);
+  config.flexCurrent = nextRandom() % 501;
+  config.pdoNumber = 1 + nextRandom() % 3;
+  for(uint8_t i=0; i<3; i++) config.upperVoltageLimit[i] = 5 + nextRandom() % 16;
+  for(uint8_t i=1; i<3; i++) config.lowerVoltageLimit[i] = 5 + nextRandom() % 16;
+  config.externalPower = nextRandom() & 1;
+  config.usbCommCapable = nextRandom() & 1;
+  config.configOkGpio = 2 + nextRandom() % 2;
+  config.gpioCtrl = nextRandom() % 4;
+  config.powerAbove5vOnly = nextRandom() & 1;
+  config.reqSrcCurrent = nextRandom() & 1;
+}
+
+//The masks and shifts of the accessors and read() before stusb4500_nvm_fields.h
+static void checkLegacyFields(const uint8_t sector[][8], const STUSB4500_Config &config)
+{
+  CHECK_EQUAL(((sector[4][1]<<2) + (sector[4][0]>>6)), config.voltage[1]);
+  CHECK_EQUAL((((sector[4][3]&0x03)<<8) + sector[4][2]), config.voltage[2]);
+  CHECK_EQUAL(nvmCurrentValue((sector[3][2]&0xF0) >> 4), config.current[0]);
+  CHECK_EQUAL(nvmCurrentValue(sector[3][4]&0x0F), config.current[1]);
+  CHECK_EQUAL(nvmCurrentValue((sector[3][5]&0xF0) >> 4), config.current[2]);
+  CHECK_EQUAL(((sector[4][4]&0x0F)<<6) + ((sector[4][3]&0xFC)>>2), config.flexCurrent);
+  CHECK_EQUAL((sector[3][2] & 0x06)>>1, config.pdoNumber);
+  CHECK_EQUAL((sector[3][3]>>4) + 5, config.upperVoltageLimit[0]);
+  CHECK_EQUAL((sector[3][5] & 0x0F) + 5, config.upperVoltageLimit[1]);
+  CHECK_EQUAL((sector[3][6]>>4) + 5, config.upperVoltageLimit[2]);
+  CHECK_EQUAL((sector[3][4]>>4) + 5, config.lowerVoltageLimit[1]);
+  CHECK_EQUAL((sector[3][6] & 0x0F) + 5, config.lowerVoltageLimit[2]);
+  CHECK_EQUAL((sector[3][2]&0x08)>>3, config.externalPower);
+  CHECK_EQUAL((sector[3][2]&0x01), config.usbCommCapable);
+  CHECK_EQUAL((sector[4][4]&0x60)>>5, config.configOkGpio);
+  CHECK_EQUAL((sector[1][0]&0x30)>>4, config.gpioCtrl);
+  CHECK_EQUAL((sector[4][6]&0x08)>>3, config.powerAbove5vOnly);
+  CHECK_EQUAL((sector[4][6]&0x10)>>4, config.reqSrcCurrent);
+}
+
+//The same values through the accessors
+static void checkAccessors(STUSB4500 &usb, const STUSB4500_Config &config)
+{
+  for(uint8_t i=0; i<3; i++) CHECK_EQUAL(config.upperVoltageLimit[i], usb.getUpperVoltageLimit(i + 1));
+  for(uint8_t i=1; i<3; i++) CHECK_EQUAL(config.lowerVoltageLimit[i], usb.getLowerVoltageLimit(i + 1));
+  CHECK_EQUAL(config.flexCurrent, (long)(usb.getFlexCurrent() * 100 + 0.5));
+  CHECK_EQUAL(config.externalPower, usb.getExternalPower());
+  CHECK_EQUAL(config.usbCommCapable, usb.getUsbCommCapable());
+  CHECK_EQUAL(config.configOkGpio, usb.getConfigOkGpio());
+  CHECK_EQUAL(config.gpioCtrl, usb.getGpioCtrl());
+  CHECK_EQUAL(config.powerAbove5vOnly, usb.getPowerAbove5vOnly());
+  CHECK_EQUAL(config.reqSrcCurrent, usb.getReqSrcCurrent());
+}
+
+TEST(config_decodes_random_images_like_the_hand_coded_masks)
+{
+  randomState = 0x4500;
+
+  for(uint16_t n=0; n<RANDOM_IMAGES; n++)
+  {
+    uint8_t image[5][8];
+    randomImage(image);
+
+    STUSB4500_Config config;
+    config.decode(image);
+    checkLegacyFields(image, config);
+    CHECK_EQUAL(0, config.reserved);
+
+    //Encoding a decoded image changes nothing, except the values the setters would clamp
+    uint8_t encoded[5][8], expected[5][8];
+    memcpy(encoded, image, sizeof(encoded));
+    memcpy(expected, image, sizeof(expected));
+    if(config.voltage[1] < 100 || config.voltage[1] > 400) nvmSet<NVM_V_SNK_PDO2>(expected, config.voltage[1] < 100 ? 100 : 400);
+    if(config.voltage[2] < 100 || config.voltage[2] > 400) nvmSet<NVM_V_SNK_PDO3>(expected, config.voltage[2] < 100 ? 100 : 400);
+    if(config.flexCurrent > 500) nvmSet<NVM_I_SNK_PDO_FLEX>(expected, 500);
+    if(config.configOkGpio == 1) nvmSet<NVM_POWER_OK_CFG>(expected, 0);
+    config.encode(encoded);
+    CHECK(memcmp(encoded, expected, sizeof(expected)) == 0);
+
+    //A random configuration survives encode() then decode() on a random image
+    STUSB4500_Config written, decoded;
+    randomConfig(written);
+    written.encode(encoded);
+    decoded.decode(encoded);
+    CHECK(decoded == written);
+    CHECK_EQUAL(0, decoded.diff(written));
+  }
+}
+
+TEST(config_diff_reports_each_field)
+{
+  STUSB4500_Config base, other;
+  uint8_t image[5][8];
+  STUSB4500_NvmImage::defaults().toBytes(image);
+  base.decode(image);
+
+  other = base; other.voltage[1]++;            CHECK_EQUAL(CONFIG_VOLTAGE(2), base.diff(other));
+  other = base; other.current[2]++;            CHECK_EQUAL(CONFIG_CURRENT(3), base.diff(other));
+  other = base; other.flexCurrent++;           CHECK_EQUAL(CONFIG_FLEX_CURRENT, base.diff(other));
+  other = base; other.pdoNumber++;             CHECK_EQUAL(CONFIG_PDO_NUMBER, base.diff(other));
+  other = base; other.upperVoltageLimit[0]++;  CHECK_EQUAL(CONFIG_UPPER_LIMIT(1), base.diff(other));
+  other = base; other.lowerVoltageLimit[2]++;  CHECK_EQUAL(CONFIG_LOWER_LIMIT(3), base.diff(other));
+  other = base; other.externalPower ^= 1;      CHECK_EQUAL(CONFIG_EXTERNAL_POWER, base.diff(other));
+  other = base; other.usbCommCapable ^= 1;     CHECK_EQUAL(CONFIG_USB_COMM_CAPABLE, base.diff(other));
+  other = base; other.configOkGpio ^= 1;       CHECK_EQUAL(CONFIG_CONFIG_OK_GPIO, base.diff(other));
+  other = base; other.gpioCtrl ^= 1;           CHECK_EQUAL(CONFIG_GPIO_CTRL, base.diff(other));
+  other = base; other.powerAbove5vOnly ^= 1;   CHECK_EQUAL(CONFIG_POWER_ABOVE_5V_ONLY, base.diff(other));
+  other = base; other.reqSrcCurrent ^= 1;      CHECK_EQUAL(CONFIG_REQ_SRC_CURRENT, base.diff(other));
+  CHECK(other != base);
+
+  other = base;
+  CHECK(other == base);
+  CHECK_EQUAL(0, base.diff(other));
+  other.voltage[0] = 120;
+  other.current[0] = base.current[0] + 10;
+  CHECK_EQUAL(CONFIG_VOLTAGE(1) | CONFIG_CURRENT(1), base.diff(other));
+}
+
+TEST(config_decodes_the_pdo_registers)
+{
+  STUSB4500_Config config;
+  uint8_t image[5][8];
+  STUSB4500_NvmImage::defaults().toBytes(image);
+  config.decode(image);
+
+  //PDO1 5V 1.5A, PDO2 9V 2A with the flags of bits 20-31 set, PDO3 all ones
+  uint8_t pdos[12] = { 0x96, 0x90, 0x01, 0x00,   0xC8, 0xD0, 0xF2, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF };
+  config.decodePdos(pdos, 0xFA);
+  CHECK_EQUAL(100, config.voltage[0]);
+  CHECK_EQUAL(150, config.current[0]);
+  CHECK_EQUAL(180, config.voltage[1]);
+  CHECK_EQUAL(200, config.current[1]);
+  CHECK_EQUAL(0x3FF, config.voltage[2]);
+  CHECK_EQUAL(0x3FF, config.current[2]);
+  CHECK_EQUAL(2, config.pdoNumber);
+
+  //encodePdos() keeps bits 20-31, clamps the voltage and fixes PDO1 at 5V
+  config.voltage[0] = 240;
+  uint8_t encoded[12];
+  memcpy(encoded, pdos, sizeof(encoded));
+  config.encodePdos(encoded);
+  CHECK(memcmp(&encoded[4], &pdos[4], 4) == 0);
+  CHECK_EQUAL(pdos[3], encoded[3]);
+  CHECK_EQUAL(pdos[11], encoded[11]);
+  CHECK_EQUAL(0xF0, encoded[10] & 0xF0);
+  STUSB4500_Config back = config;
+  back.decodePdos(encoded, 2);
+  CHECK_EQUAL(100, back.voltage[0]);
+  CHECK_EQUAL(400, back.voltage[2]);
+}
+
+TEST(config_round_trips_random_images_through_the_library)
+{
+  HostBench bench;
+  randomState = 0x4501;
+
+  for(uint16_t n=0; n<RANDOM_IMAGES; n++)
+  {
+    //A board whose NVM holds a random image
+    uint8_t image[5][8];
+    randomImage(image);
+    bench.chip.setNvm(image);
+    bench.chip.powerCycle();
+    CHECK(bench.usb.begin());
+
+    STUSB4500_Config config, expected;
+    CHECK_EQUAL(0, bench.usb.readConfig(config));
+    expected.decode(image);
+    checkAccessors(bench.usb, expected);
+
+    //The NVM fields come from the image, the PDOs from the volatile registers
+    uint32_t pdoFields = CONFIG_VOLTAGE(1) | CONFIG_VOLTAGE(2) | CONFIG_VOLTAGE(3) | CONFIG_CURRENT(1) |
+                         CONFIG_CURRENT(2) | CONFIG_CURRENT(3) | CONFIG_PDO_NUMBER;
+    CHECK_EQUAL(0, config.diff(expected) & ~pdoFields);
+    CHECK_EQUAL(bench.usb.getPdoNumber(), config.pdoNumber);
+    CHECK_EQUAL((long)(bench.usb.getVoltage(2) * 20 + 0.5), config.voltage[1]);
+
+    //A random configuration applied, saved, and loaded again at power up
+    STUSB4500_Config written;
+    randomConfig(written);
+    bench.usb.setWriteValidation(false);
+    CHECK_EQUAL(0, bench.usb.writeConfig(written));
+    CHECK_EQUAL(0, bench.usb.readConfig(config));
+    CHECK(config == written);
+    CHECK_EQUAL(NVM_WRITE_OK, bench.usb.write());
+
+    bench.chip.powerCycle();
+    bench.usb.read();
+    CHECK_EQUAL(0, bench.usb.readConfig(config));
+    CHECK(config == written);
+    checkAccessors(bench.usb, written);
+
+    //The bits the configuration doesn't cover were kept
+    uint8_t nvm[5][8], untouched[5][8];
+    bench.chip.getNvm(nvm);
+    memcpy(untouched, image, sizeof(untouched));
+    written.encode(untouched);
+    CHECK(memcmp(nvm, untouched, sizeof(nvm)) == 0);
+  }
+}
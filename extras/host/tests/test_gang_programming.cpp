@@ -0,0 +1,141 @@
+/*
+  STUSB4500_NvmJob and STUSB4500_GangProgrammer against several emulated
+  STUSB4500s: addresses 0x28-0x2B on Wire and a board on a second port.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_GangProgrammer.h"
+#include "stusb4500_nvm_image.h"
+
+static constexpr STUSB4500_NvmImage gangImage = STUSB4500_NvmImage::defaults()
+  .pdoNumber<2>().voltage<2, 9000>().current<2, 2000>();
+
+static bool holds(const EmulatedSTUSB4500 &chip, const STUSB4500_NvmImage &image)
+{
+  uint8_t expected[5][8], nvm[5][8];
+  image.toBytes(expected);
+  chip.getNvm(nvm);
+  return memcmp(expected, nvm, sizeof(nvm)) == 0;
+}
+
+//Four boards on Wire and one on a second port, all started
+struct GangBench {
+  TwoWire wire1;
+  EmulatedSTUSB4500 chips[5] = { EmulatedSTUSB4500(0x28), EmulatedSTUSB4500(0x29), EmulatedSTUSB4500(0x2A),
+                                 EmulatedSTUSB4500(0x2B), EmulatedSTUSB4500(0x28) };
+  STUSB4500 boards[5];
+  STUSB4500_GangProgrammer gang;
+
+  GangBench(void)
+  {
+    for(uint8_t i=0; i<4; i++) Wire.attach(chips[i]);
+    wire1.attach(chips[4]);
+
+    for(uint8_t i=0; i<4; i++) CHECK(boards[i].begin(0x28 + i, Wire));
+    CHECK(boards[4].begin(0x28, wire1));
+
+    gang.begin(gangImage);
+    for(uint8_t i=0; i<5; i++) CHECK(gang.addBoard(boards[i]));
+  }
+
+  ~GangBench(void)
+  {
+    for(uint8_t i=0; i<4; i++) Wire.detach(chips[i]);
+  }
+};
+
+TEST(nvm_job_steps_one_transaction_at_a_time)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  STUSB4500_NvmJob job;
+  job.begin(bench.usb);
+  job.start(gangImage);
+
+  //One register access per step: a write, or a read (address then data)
+  for(uint32_t steps=0; steps<5000; steps++)
+  {
+    uint32_t transactions = bench.chip.getTransactions();
+    bool running = job.step();
+    CHECK(bench.chip.getTransactions() - transactions <= 2);
+    if(!running) break;
+    if(job.busy()) delayMicroseconds(500);
+  }
+
+  CHECK_EQUAL(NVM_JOB_PROGRAMMED, job.getResult());
+  CHECK(job.getBusyPolls() > 0);
+  CHECK(holds(bench.chip, gangImage));
+
+  //Only the sectors holding the changed fields were erased
+  uint8_t before[5][8], after[5][8];
+  STUSB4500_NvmImage::defaults().toBytes(before);
+  gangImage.toBytes(after);
+  uint8_t changed = 0;
+  for(uint8_t s=0; s<5; s++) if(memcmp(before[s], after[s], 8) != 0) changed |= 1 << s;
+  CHECK_EQUAL(changed, job.getProgrammedSectors());
+
+  //Already holding the image: skipped after the read
+  uint32_t erases = bench.chip.getNvmErases();
+  job.start(gangImage);
+  while(job.step()) {}
+  CHECK_EQUAL(NVM_JOB_SKIPPED, job.getResult());
+  CHECK_EQUAL(erases, bench.chip.getNvmErases());
+}
+
+TEST(gang_programs_every_board_with_overlapping_busy_times)
+{
+  GangBench bench;
+
+  //One board already holds the image
+  uint8_t bytes[5][8];
+  gangImage.toBytes(bytes);
+  bench.chips[2].setNvm(bytes);
+
+  CHECK_EQUAL(0, bench.gang.run());
+  CHECK_EQUAL(4, bench.gang.getProgrammedCount());
+  CHECK_EQUAL(1, bench.gang.getSkippedCount());
+  CHECK_EQUAL(NVM_JOB_SKIPPED, bench.gang.getResult(2));
+
+  uint32_t longest = 0, sum = 0;
+  for(uint8_t i=0; i<5; i++)
+  {
+    CHECK(holds(bench.chips[i], gangImage));
+    if(i != 2) CHECK_EQUAL(NVM_JOB_PROGRAMMED, bench.gang.getResult(i));
+    if(bench.gang.getBoardTime(i) > longest) longest = bench.gang.getBoardTime(i);
+    sum += bench.gang.getBoardTime(i);
+  }
+
+  //The boards were programmed side by side, not one after the other
+  CHECK(bench.gang.getTotalTime() <= longest + 1);
+  CHECK(bench.gang.getTotalTime() * 2 < sum);
+
+  //The new configuration is what the chips load at power up
+  for(uint8_t i=0; i<5; i++)
+  {
+    bench.chips[i].powerCycle();
+    bench.boards[i].read();
+    CHECK_EQUAL(2, bench.boards[i].getPdoNumber());
+    CHECK_EQUAL(9000, (long)(bench.boards[i].getVoltage(2) * 1000));
+  }
+}
+
+TEST(gang_reports_a_failing_board_and_finishes_the_others)
+{
+  GangBench bench;
+
+  bench.chips[1].failAfterNvmOperations(1);
+  bench.chips[4].setPresent(false);
+
+  CHECK_EQUAL(2, bench.gang.run());
+  CHECK_EQUAL(3, bench.gang.getProgrammedCount());
+  CHECK_EQUAL(2, bench.gang.getFailedCount());
+  CHECK(bench.chips[1].brownedOut());
+  CHECK(bench.gang.getResult(1) == NVM_JOB_BUS_ERROR || bench.gang.getResult(1) == NVM_JOB_TIMEOUT);
+  CHECK_EQUAL(NVM_JOB_BUS_ERROR, bench.gang.getResult(4));
+
+  for(uint8_t i=0; i<4; i++)
+  {
+    if(i != 1) CHECK(holds(bench.chips[i], gangImage));
+  }
+}
@@ -0,0 +1,275 @@
+/*
+  Negotiation of the emulated STUSB4500 with the simulated source, driven
+  through the library: PDO selection from the volatile registers, softReset(),
+  lost messages and hard resets, NVM reload at power up, ALERT.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_NegotiationProfiler.h"
+#include "STUSB4500_Supervisor.h"
+
+static void laptopCharger(SimulatedSource &source)
+{
+  source.clearPdos();
+  source.addFixedPdo(5000, 3000);
+  source.addFixedPdo(9000, 3000);
+  source.addFixedPdo(15000, 3000);
+  source.addFixedPdo(20000, 2250);
+}
+
+static uint8_t rdoPosition(uint32_t rdo)       { return (rdo >> 28) & 0x07; }
+static uint16_t rdoCurrent(uint32_t rdo)       { return ((rdo >> 10) & 0x3FF) * 10; }
+static bool rdoMismatch(uint32_t rdo)          { return rdo & (1UL << 26); }
+
+TEST(attach_negotiates_highest_matching_pdo)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+
+  //NVM defaults: PDO3 is 20V 1A, PDO2 15V 1.5A, three PDOs
+  CHECK(bench.attach());
+  CHECK_EQUAL(4, rdoPosition(bench.chip.getRdo()));
+  CHECK_EQUAL(1000, rdoCurrent(bench.chip.getRdo()));
+  CHECK_EQUAL(20000, bench.chip.getVbus());
+  CHECK_EQUAL(PE_SNK_READY, bench.chip.getPeState());
+}
+
+TEST(soft_reset_renegotiates_with_new_pdos)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.setCurrent(2, 2.0);
+  bench.usb.setPdoNumber(2);
+  bench.usb.softReset();
+  CHECK(!bench.chip.hasContract());
+  CHECK(bench.waitContract());
+
+  CHECK_EQUAL(2, rdoPosition(bench.chip.getRdo()));
+  CHECK_EQUAL(2000, rdoCurrent(bench.chip.getRdo()));
+  CHECK_EQUAL(9000, bench.chip.getVbus());
+  CHECK_EQUAL(1, bench.chip.getSoftResets());
+  CHECK_EQUAL(0, bench.chip.getHardResets());
+}
+
+TEST(unsupported_voltage_falls_back_to_5v)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  bench.usb.setVoltage(2, 12.0);
+  bench.usb.setPdoNumber(2);
+  bench.usb.softReset();
+  CHECK(bench.waitContract());
+
+  uint32_t rdo = bench.chip.getRdo();
+  CHECK_EQUAL(1, rdoPosition(rdo));
+  CHECK(!rdoMismatch(rdo));
+  CHECK_EQUAL(5000, bench.chip.getVbus());
+
+  //Not even PDO1 can be met: 5V with what the source has, and the mismatch flag
+  bench.usb.setCurrent(1, 3.5);
+  bench.usb.setPdoNumber(1);
+  bench.usb.softReset();
+  CHECK(bench.waitContract());
+
+  rdo = bench.chip.getRdo();
+  CHECK_EQUAL(1, rdoPosition(rdo));
+  CHECK(rdoMismatch(rdo));
+  CHECK_EQUAL(3000, rdoCurrent(rdo));
+}
+
+TEST(too_much_current_falls_back_to_a_lower_pdo)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  //20V 3A is more than the 20V 2.25A the source offers, PDO2 15V 1.5A matches
+  bench.usb.setCurrent(3, 3.0);
+  bench.usb.softReset();
+  CHECK(bench.waitContract());
+
+  CHECK_EQUAL(3, rdoPosition(bench.chip.getRdo()));
+  CHECK_EQUAL(15000, bench.chip.getVbus());
+}
+
+TEST(req_src_current_requests_the_source_current)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  CHECK(bench.usb.begin());
+  bench.usb.setReqSrcCurrent(1);
+  bench.usb.write();
+
+  //REQ_SRC_CURRENT is loaded from the NVM at power up
+  bench.chip.powerCycle();
+  CHECK(bench.attach());
+  CHECK_EQUAL(4, rdoPosition(bench.chip.getRdo()));
+  CHECK_EQUAL(2250, rdoCurrent(bench.chip.getRdo()));
+}
+
+TEST(profiler_measures_the_source_latencies)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  SimulatedSourceTiming timing = bench.source.getTiming();
+  timing.softReset = 2000;
+  timing.capabilities = 40000;
+  timing.accept = 5000;
+  timing.psRdy = 60000;
+  bench.source.setTiming(timing);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  //softReset() itself takes two register writes, each followed by a 1ms delay
+  uint32_t startTime = micros();
+  bench.usb.softReset();
+  uint32_t resetTime = micros() - startTime;
+  CHECK(bench.waitContract());
+  delay(100);
+
+  STUSB4500_NegotiationProfiler profiler;
+  profiler.begin(bench.usb);
+  CHECK(profiler.run());
+
+  //Timed from before the soft reset, so no phase is shorter than the source made it
+  CHECK(profiler.getPhaseLatency(PROFILER_PHASE_SOURCE_CAPS) >= timing.softReset + timing.capabilities);
+
+  //The PE_FSM polls are less than a millisecond apart
+  uint32_t expected = timing.softReset + timing.capabilities + EMU_EVALUATE + timing.accept + timing.psRdy;
+  CHECK(profiler.getPhaseLatency(PROFILER_PHASE_TOTAL) <= expected + resetTime + 1000);
+  CHECK(profiler.getPhaseLatency(PROFILER_PHASE_TOTAL) >= expected);
+  CHECK(profiler.getPhaseLatency(PROFILER_PHASE_PS_RDY) + 1000 >= timing.psRdy);
+  CHECK(profiler.getPhaseLatency(PROFILER_PHASE_PS_RDY) <= timing.psRdy + 1000);
+}
+
+TEST(jitter_is_repeatable_with_the_same_seed)
+{
+  uint32_t latency[2];
+
+  for(uint8_t i=0; i<2; i++)
+  {
+    hostResetClock();
+    HostBench bench;
+    laptopCharger(bench.source);
+    SimulatedSourceTiming timing = bench.source.getTiming();
+    timing.jitter = 20000;
+    bench.source.setTiming(timing);
+    bench.source.seed(1234);
+    CHECK(bench.attach());
+    CHECK(bench.usb.begin());
+
+    STUSB4500_NegotiationProfiler profiler;
+    profiler.begin(bench.usb);
+    CHECK(profiler.run());
+    latency[i] = profiler.getPhaseLatency(PROFILER_PHASE_TOTAL);
+  }
+
+  CHECK_EQUAL(latency[0], latency[1]);
+}
+
+TEST(lost_accept_leads_to_a_hard_reset_and_recovers)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  //The Accept of the Soft_Reset is lost: SenderResponseTimer, then a hard reset
+  bench.source.dropNextMessages(1);
+  bench.usb.softReset();
+  delay(EMU_SENDER_RESPONSE / 1000 + 5);
+  CHECK_EQUAL(PE_HARD_RESET, bench.chip.getPeState());
+
+  STUSB4500_Status status;
+  bench.usb.readStatus(status);
+  CHECK(status.alertStatus() & ALERT_HARD_RESET);
+
+  delay(EMU_PS_HARD_RESET / 1000 + 5);
+  CHECK_EQUAL(PE_HARD_RESET_SHUTDOWN, bench.chip.getPeState());
+  CHECK_EQUAL(0, bench.chip.getVbus());
+
+  CHECK(bench.waitContract());
+  CHECK_EQUAL(1, bench.chip.getHardResets());
+  CHECK_EQUAL(20000, bench.chip.getVbus());
+}
+
+TEST(source_answering_soft_reset_with_hard_reset)
+{
+  HostBench bench;
+  laptopCharger(bench.source);
+  bench.source.setHardResetOnSoftReset(true);
+  CHECK(bench.attach());
+  CHECK(bench.usb.begin());
+
+  bench.usb.softReset();
+  CHECK(bench.waitContract());
+  CHECK_EQUAL(1, bench.chip.getHardResets());
+
+  STUSB4500_Status status;
+  bench.usb.readStatus(status);
+  CHECK(status.hardResetReceived());
+}
+
+TEST(source_without_pd_gives_up_after_two_hard_resets)
+{
+  HostBench bench;
+  bench.source.setPdCapable(false);
+  bench.source.setTypeCCurrent(1500);
+  bench.chip.attach(bench.source);
+
+  CHECK(!bench.waitContract(3000));
+  CHECK_EQUAL(EMU_HARD_RESET_COUNT, bench.chip.getHardResets());
+  CHECK_EQUAL(5000, bench.chip.getVbus());
+
+  STUSB4500_Status status;
+  CHECK(bench.usb.begin());
+  bench.usb.readStatus(status);
+  CHECK(status.attached());
+  CHECK_EQUAL(2, status.cc1State());
+}
+
+TEST(power_cycle_reloads_the_pdos_from_the_nvm)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  bench.usb.setVoltage(2, 9.0);
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+
+  bench.chip.powerCycle();
+  CHECK_EQUAL(15000, (long)(bench.usb.getVoltage(2) * 1000));
+
+  //Saved to the NVM, the value survives
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.write();
+  bench.chip.powerCycle();
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+}
+
+TEST(alert_pin_follows_the_mask_and_clears_on_read)
+{
+  HostBench bench;
+  hostSetPinReader(2, EmulatedSTUSB4500::alertPin, &bench.chip);
+  CHECK(bench.usb.begin());
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb, 2));
+  CHECK_EQUAL(HIGH, digitalRead(2));
+
+  bench.chip.attach(bench.source);
+  CHECK_EQUAL(LOW, digitalRead(2));
+  CHECK(supervisor.update());
+  CHECK(supervisor.getEvents() & ALERT_CC_DETECTION_STATUS);
+  CHECK_EQUAL(HIGH, digitalRead(2));
+
+  supervisor.end();
+  hostSetPinReader(2, NULL, NULL);
+}
@@ -0,0 +1,217 @@
+/*
+  NVM field descriptors: nvmGet<>/nvmSet<> and STUSB4500_NvmImage against a
+  plain 64-bit reference, the factory defaults, and the NVM accessors.
+*/
+
+#include "host_test.h"
+#include "stusb4500_nvm_image.h"
+
+//The sector as a little-endian 64-bit value, as the descriptors count the bits
+static uint64_t sectorValue(const uint8_t image[][8], uint8_t sectorNum)
+{
+  uint64_t value = 0;
+  for(uint8_t i=0; i<8; i++) value |= (uint64_t)image[sectorNum][i] << (8 * i);
+  return value;
+}
+
+//Sets value in a copy of start with nvmSet<>, checks it against the reference and the image builder
+template<class Field>
+static void checkField(const uint8_t start[][8], uint16_t value)
+{
+  uint8_t image[5][8];
+  memcpy(image, start, sizeof(image));
+  nvmSet<Field>(image, value);
+
+  CHECK_EQUAL(value & Field::mask, nvmGet<Field>(image));
+
+  //Only the bits of the field changed, in its sector only
+  for(uint8_t s=0; s<5; s++)
+  {
+    uint64_t expected = sectorValue(start, s);
+    if(s == Field::sector)
+    {
+      expected &= ~((uint64_t)Field::mask << Field::offset);
+      expected |= (uint64_t)(value & Field::mask) << Field::offset;
+    }
+    CHECK(sectorValue(image, s) == expected);
+  }
+
+  //The constexpr builder places the field at the same bits
+  STUSB4500_NvmImage built = { { sectorValue(start, 0), sectorValue(start, 1), sectorValue(start, 2),
+                                 sectorValue(start, 3), sectorValue(start, 4) } };
+  built = built.with<Field>(value);
+  CHECK_EQUAL(value & Field::mask, built.get<Field>());
+  uint8_t bytes[5][8];
+  built.toBytes(bytes);
+  CHECK(memcmp(bytes, image, sizeof(image)) == 0);
+}
+
+template<class Field>
+static void checkFieldValues(void)
+{
+  uint8_t defaults[5][8], zeros[5][8], ones[5][8];
+  STUSB4500_NvmImage::defaults().toBytes(defaults);
+  memset(zeros, 0x00, sizeof(zeros));
+  memset(ones, 0xFF, sizeof(ones));
+
+  const uint16_t values[] = { 0, 1, Field::mask, 0x5555, 0xAAAA, (uint16_t)(Field::mask >> 1) };
+  for(uint8_t i=0; i<sizeof(values)/sizeof(values[0]); i++)
+  {
+    checkField<Field>(defaults, values[i] & Field::mask);
+    checkField<Field>(zeros, values[i] & Field::mask);
+    checkField<Field>(ones, values[i] & Field::mask);
+  }
+
+  //Bits above the width are dropped, not written to the neighbours
+  checkField<Field>(zeros, 0xFFFF);
+}
+
+struct FieldBits {
+  uint8_t sector;
+  uint8_t offset;
+  uint8_t width;
+};
+
+#define FIELD_BITS(Field) { Field::sector, Field::offset, Field::width }
+
+static const FieldBits allFields[] = {
+  FIELD_BITS(NVM_GPIO_CFG), FIELD_BITS(NVM_USB_COMM_CAPABLE), FIELD_BITS(NVM_SNK_PDO_NUMB),
+  FIELD_BITS(NVM_SNK_UNCONS_POWER), FIELD_BITS(NVM_I_SNK_PDO1), FIELD_BITS(NVM_SHIFT_VBUS_HL1),
+  FIELD_BITS(NVM_I_SNK_PDO2), FIELD_BITS(NVM_SHIFT_VBUS_LL2), FIELD_BITS(NVM_SHIFT_VBUS_HL2),
+  FIELD_BITS(NVM_I_SNK_PDO3), FIELD_BITS(NVM_SHIFT_VBUS_LL3), FIELD_BITS(NVM_SHIFT_VBUS_HL3),
+  FIELD_BITS(NVM_V_SNK_PDO2), FIELD_BITS(NVM_V_SNK_PDO3), FIELD_BITS(NVM_I_SNK_PDO_FLEX),
+  FIELD_BITS(NVM_POWER_OK_CFG), FIELD_BITS(NVM_POWER_ONLY_ABOVE_5V), FIELD_BITS(NVM_REQ_SRC_CURRENT),
+};
+
+TEST(nvm_fields_round_trip_without_touching_the_other_bits)
+{
+  checkFieldValues<NVM_GPIO_CFG>();
+  checkFieldValues<NVM_USB_COMM_CAPABLE>();
+  checkFieldValues<NVM_SNK_PDO_NUMB>();
+  checkFieldValues<NVM_SNK_UNCONS_POWER>();
+  checkFieldValues<NVM_I_SNK_PDO1>();
+  checkFieldValues<NVM_SHIFT_VBUS_HL1>();
+  checkFieldValues<NVM_I_SNK_PDO2>();
+  checkFieldValues<NVM_SHIFT_VBUS_LL2>();
+  checkFieldValues<NVM_SHIFT_VBUS_HL2>();
+  checkFieldValues<NVM_I_SNK_PDO3>();
+  checkFieldValues<NVM_SHIFT_VBUS_LL3>();
+  checkFieldValues<NVM_SHIFT_VBUS_HL3>();
+  checkFieldValues<NVM_V_SNK_PDO2>();
+  checkFieldValues<NVM_V_SNK_PDO3>();
+  checkFieldValues<NVM_I_SNK_PDO_FLEX>();
+  checkFieldValues<NVM_POWER_OK_CFG>();
+  checkFieldValues<NVM_POWER_ONLY_ABOVE_5V>();
+  checkFieldValues<NVM_REQ_SRC_CURRENT>();
+
+  //No two descriptors share a bit
+  const uint8_t count = sizeof(allFields) / sizeof(allFields[0]);
+  uint64_t used[5] = { 0, 0, 0, 0, 0 };
+  for(uint8_t i=0; i<count; i++)
+  {
+    uint64_t bits = (((uint64_t)1 << allFields[i].width) - 1) << allFields[i].offset;
+    CHECK((used[allFields[i].sector] & bits) == 0);
+    used[allFields[i].sector] |= bits;
+  }
+}
+
+TEST(nvm_fields_read_the_factory_defaults)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  //The builder's defaults are the image of a new chip
+  uint8_t defaults[5][8], nvm[5][8];
+  STUSB4500_NvmImage::defaults().toBytes(defaults);
+  bench.chip.getNvm(nvm);
+  CHECK(memcmp(defaults, nvm, sizeof(nvm)) == 0);
+
+  //Documented factory values
+  CHECK_EQUAL(3, nvmGet<NVM_SNK_PDO_NUMB>(defaults));
+  CHECK_EQUAL(2, nvmGet<NVM_POWER_OK_CFG>(defaults));
+  CHECK_EQUAL(STUSB4500_NvmImage::defaults().get<NVM_V_SNK_PDO2>(), nvmGet<NVM_V_SNK_PDO2>(defaults));
+
+  //The accessors read the same fields from the local copy of the NVM
+  CHECK_EQUAL(nvmGet<NVM_SHIFT_VBUS_HL1>(defaults) + 5, bench.usb.getUpperVoltageLimit(1));
+  CHECK_EQUAL(nvmGet<NVM_SHIFT_VBUS_HL2>(defaults) + 5, bench.usb.getUpperVoltageLimit(2));
+  CHECK_EQUAL(nvmGet<NVM_SHIFT_VBUS_HL3>(defaults) + 5, bench.usb.getUpperVoltageLimit(3));
+  CHECK_EQUAL(nvmGet<NVM_SHIFT_VBUS_LL2>(defaults) + 5, bench.usb.getLowerVoltageLimit(2));
+  CHECK_EQUAL(nvmGet<NVM_SHIFT_VBUS_LL3>(defaults) + 5, bench.usb.getLowerVoltageLimit(3));
+  CHECK_EQUAL(nvmGet<NVM_I_SNK_PDO_FLEX>(defaults), (long)(bench.usb.getFlexCurrent() * 100 + 0.5));
+  CHECK_EQUAL(nvmGet<NVM_SNK_UNCONS_POWER>(defaults), bench.usb.getExternalPower());
+  CHECK_EQUAL(nvmGet<NVM_USB_COMM_CAPABLE>(defaults), bench.usb.getUsbCommCapable());
+  CHECK_EQUAL(nvmGet<NVM_POWER_OK_CFG>(defaults), bench.usb.getConfigOkGpio());
+  CHECK_EQUAL(nvmGet<NVM_GPIO_CFG>(defaults), bench.usb.getGpioCtrl());
+  CHECK_EQUAL(nvmGet<NVM_POWER_ONLY_ABOVE_5V>(defaults), bench.usb.getPowerAbove5vOnly());
+  CHECK_EQUAL(nvmGet<NVM_REQ_SRC_CURRENT>(defaults), bench.usb.getReqSrcCurrent());
+
+  //The volatile PDOs were loaded from the same fields
+  CHECK_EQUAL(nvmGet<NVM_SNK_PDO_NUMB>(defaults), bench.usb.getPdoNumber());
+  CHECK_EQUAL(nvmGet<NVM_V_SNK_PDO2>(defaults) * 50, (long)(bench.usb.getVoltage(2) * 1000 + 0.5));
+  CHECK_EQUAL(nvmGet<NVM_V_SNK_PDO3>(defaults) * 50, (long)(bench.usb.getVoltage(3) * 1000 + 0.5));
+  CHECK_EQUAL(nvmCurrentValue(nvmGet<NVM_I_SNK_PDO2>(defaults)) * 10, (long)(bench.usb.getCurrent(2) * 1000 + 0.5));
+}
+
+//The NVM parameters as the accessors return them
+struct NvmParameters {
+  uint8_t upper[3];
+  uint8_t lower[2];
+  uint16_t flex;
+  uint8_t flags[6];
+
+  void read(STUSB4500 &usb)
+  {
+    for(uint8_t i=0; i<3; i++) upper[i] = usb.getUpperVoltageLimit(i + 1);
+    for(uint8_t i=0; i<2; i++) lower[i] = usb.getLowerVoltageLimit(i + 2);
+    flex = usb.getFlexCurrent() * 100 + 0.5;
+    flags[0] = usb.getExternalPower();
+    flags[1] = usb.getUsbCommCapable();
+    flags[2] = usb.getConfigOkGpio();
+    flags[3] = usb.getGpioCtrl();
+    flags[4] = usb.getPowerAbove5vOnly();
+    flags[5] = usb.getReqSrcCurrent();
+  }
+
+  bool operator==(const NvmParameters &other) const
+  {
+    return memcmp(upper, other.upper, sizeof(upper)) == 0 && memcmp(lower, other.lower, sizeof(lower)) == 0 &&
+           flex == other.flex && memcmp(flags, other.flags, sizeof(flags)) == 0;
+  }
+};
+
+TEST(nvm_setters_leave_the_neighbouring_fields)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  NvmParameters before, after;
+  before.read(bench.usb);
+
+  //FLEX_I straddles two bytes, between PDO3's voltage and POWER_OK_CFG
+  bench.usb.setFlexCurrent(4.37);
+  after.read(bench.usb);
+  CHECK_EQUAL(437, after.flex);
+  before.flex = 437;
+  CHECK(before == after);
+
+  //Each VBUS limit shares its byte with a current code or another limit
+  bench.usb.setUpperVoltageLimit(2, 17);
+  bench.usb.setLowerVoltageLimit(3, 8);
+  after.read(bench.usb);
+  before.upper[1] = 17;
+  before.lower[1] = 8;
+  CHECK(before == after);
+
+  //POWER_OK_CFG, bits 5:6, next to the top of FLEX_I
+  bench.usb.setConfigOkGpio(3);
+  bench.usb.setPowerAbove5vOnly(!before.flags[4]);
+  bench.usb.setReqSrcCurrent(!before.flags[5]);
+  after.read(bench.usb);
+  before.flags[2] = 3;
+  before.flags[4] = !before.flags[4];
+  before.flags[5] = !before.flags[5];
+  CHECK(before == after);
+
+  //Only the sectors holding those fields are rewritten
+  CHECK_EQUAL(SECTOR_3 | SECTOR_4, bench.usb.getDirtySectors());
+}
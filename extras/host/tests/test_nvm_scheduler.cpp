@@ -0,0 +1,108 @@
+/*
+  STUSB4500_NvmScheduler with four emulated STUSB4500s at 0x28-0x2B on Wire.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_NvmScheduler.h"
+
+//Four boards on Wire, each with another pending configuration
+struct SchedulerBench {
+  EmulatedSTUSB4500 chips[4] = { EmulatedSTUSB4500(0x28), EmulatedSTUSB4500(0x29), EmulatedSTUSB4500(0x2A),
+                                 EmulatedSTUSB4500(0x2B) };
+  STUSB4500 boards[4];
+  STUSB4500_NvmScheduler scheduler;
+
+  SchedulerBench(uint8_t count = 4, uint32_t clock = 100000)
+  {
+    Wire.setClock(clock);
+    scheduler.begin();
+    for(uint8_t i=0; i<count; i++)
+    {
+      Wire.attach(chips[i]);
+      CHECK(boards[i].begin(0x28 + i, Wire));
+      boards[i].setVoltage(2, 9.0 + i);
+      boards[i].setCurrent(2, 2.0);
+      boards[i].setPdoNumber(2);
+      CHECK(scheduler.addDevice(boards[i]));
+    }
+  }
+
+  ~SchedulerBench(void)
+  {
+    for(uint8_t i=0; i<4; i++) Wire.detach(chips[i]);
+    Wire.setClock(100000);
+  }
+};
+
+//The chip loads the pending configuration from its NVM at power up
+static void checkWritten(SchedulerBench &bench, uint8_t index)
+{
+  bench.chips[index].powerCycle();
+  bench.boards[index].read();
+  CHECK_EQUAL(2, bench.boards[index].getPdoNumber());
+  CHECK_EQUAL(9000 + index * 1000, (long)(bench.boards[index].getVoltage(2) * 1000 + 0.5));
+  CHECK_EQUAL(2000, (long)(bench.boards[index].getCurrent(2) * 1000 + 0.5));
+}
+
+TEST(scheduler_writes_four_devices_in_about_the_time_of_one)
+{
+  //Reference: the same write on one device. At 400kHz, as on a programming fixture,
+  //the bus traffic of the other devices fits in the NVM busy times
+  uint32_t single;
+  {
+    SchedulerBench bench(1, 400000);
+    CHECK_EQUAL(0, bench.scheduler.write(NVM_JOB_VERIFY));
+    CHECK_EQUAL(NVM_JOB_PROGRAMMED, bench.scheduler.getResult(0));
+    single = bench.scheduler.getTotalTime();
+  }
+  CHECK(single > 0);
+
+  SchedulerBench bench(4, 400000);
+  CHECK_EQUAL(4, bench.scheduler.getDeviceCount());
+  CHECK_EQUAL(0, bench.scheduler.write(NVM_JOB_VERIFY));
+
+  uint32_t sum = 0;
+  for(uint8_t i=0; i<4; i++)
+  {
+    //Read back and compared by the job
+    CHECK_EQUAL(NVM_WRITE_OK, bench.scheduler.getWriteResult(i));
+    CHECK_EQUAL(NVM_JOB_PROGRAMMED, bench.scheduler.getResult(i));
+    sum += bench.scheduler.getDeviceTime(i);
+  }
+
+  //Side by side: close to one device, far from four in a row
+  uint32_t total = bench.scheduler.getTotalTime();
+  CHECK(total * 10 < single * 12);
+  CHECK(total * 2 < sum);
+
+  for(uint8_t i=0; i<4; i++) checkWritten(bench, i);
+}
+
+TEST(scheduler_skips_a_refused_device_and_writes_the_others)
+{
+  SchedulerBench bench;
+
+  //PDO3 below PDO2 with PDO3 selected is refused by the validation
+  bench.boards[1].setVoltage(3, 5.0);
+  bench.boards[1].setPdoNumber(3);
+  uint32_t erases = bench.chips[1].getNvmErases();
+
+  CHECK_EQUAL(1, bench.scheduler.write(NVM_JOB_COMPARE | NVM_JOB_VERIFY));
+  CHECK_EQUAL(NVM_WRITE_REFUSED, bench.scheduler.getWriteResult(1));
+  CHECK_EQUAL(NVM_JOB_IDLE, bench.scheduler.getResult(1));
+  CHECK_EQUAL(erases, bench.chips[1].getNvmErases());
+
+  for(uint8_t i=0; i<4; i++)
+  {
+    if(i == 1) continue;
+    CHECK_EQUAL(NVM_JOB_PROGRAMMED, bench.scheduler.getResult(i));
+    checkWritten(bench, i);
+  }
+
+  //Nothing left to write on the others: compared and skipped
+  bench.boards[1].setPdoNumber(2);
+  CHECK_EQUAL(0, bench.scheduler.write(NVM_JOB_COMPARE | NVM_JOB_VERIFY));
+  CHECK_EQUAL(NVM_JOB_PROGRAMMED, bench.scheduler.getResult(1));
+  CHECK_EQUAL(NVM_JOB_SKIPPED, bench.scheduler.getResult(0));
+  CHECK(!bench.scheduler.addDevice(bench.boards[0]));
+}
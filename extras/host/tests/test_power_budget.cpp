@@ -0,0 +1,134 @@
+/*
+  STUSB4500_PowerBudget: the contract voltage comes from the source PDO at the
+  object position of the RDO.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_Supervisor.h"
+#include "STUSB4500_PowerBudget.h"
+
+#define ALERT_PIN 2
+
+//Sink PDOs with the same current, so the current can't tell which one was used
+static void sinkPdos(STUSB4500 &usb)
+{
+  usb.setPdoNumber(3);
+  usb.setVoltage(2, 9.0);
+  usb.setCurrent(2, 2.0);
+  usb.setVoltage(3, 15.0);
+  usb.setCurrent(3, 2.0);
+}
+
+static uint8_t thresholdCalls;
+static uint32_t thresholdPower;
+static bool thresholdAbove;
+
+static void onThreshold(uint32_t power, bool above)
+{
+  thresholdCalls++;
+  thresholdPower = power;
+  thresholdAbove = above;
+}
+
+//Serves the ALERT pin until the contract is made and a little after
+static void supervise(HostBench &bench, STUSB4500_Supervisor &supervisor, STUSB4500_PowerBudget &budget)
+{
+  for(uint16_t ms=0; ms<1500 && !(bench.chip.hasContract() && ms > 1000); ms++)
+  {
+    if(supervisor.update()) budget.update(supervisor.getStatus());
+    delay(1);
+  }
+}
+
+TEST(budget_uses_the_source_pdo_at_the_rdo_position)
+{
+  HostBench bench;
+  hostSetPinReader(ALERT_PIN, EmulatedSTUSB4500::alertPin, &bench.chip);
+  CHECK(bench.usb.begin());
+  sinkPdos(bench.usb);
+
+  //15V is not offered: the contract is 9V at 2A, once matched to the 15V sink PDO by its current
+  bench.source.addFixedPdo(9000, 3000);
+
+  STUSB4500_Supervisor supervisor;
+  STUSB4500_PowerBudget budget;
+  CHECK(supervisor.begin(bench.usb, ALERT_PIN));
+  budget.begin(bench.usb);
+  CHECK_EQUAL(POWER_SOURCE_NONE, budget.getSource());
+
+  bench.chip.attach(bench.source);
+  supervise(bench, supervisor, budget);
+
+  CHECK(bench.chip.hasContract());
+  CHECK_EQUAL(9000, bench.chip.getVbus());
+  CHECK_EQUAL(2, budget.getSourcePdoCount());
+  CHECK_EQUAL(POWER_SOURCE_PD, budget.getSource());
+  CHECK_EQUAL(9000, budget.getVoltage());
+  CHECK_EQUAL(2000, budget.getCurrent());
+  CHECK_EQUAL(18000, budget.getPower());
+
+  //Detached: the capabilities belong to that source
+  bench.chip.detach();
+  supervise(bench, supervisor, budget);
+  CHECK_EQUAL(POWER_SOURCE_NONE, budget.getSource());
+  CHECK_EQUAL(0, budget.getSourcePdoCount());
+
+  supervisor.end();
+  hostSetPinReader(ALERT_PIN, NULL, NULL);
+}
+
+TEST(budget_reports_an_unknown_power_without_the_capabilities)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  sinkPdos(bench.usb);
+  bench.source.addFixedPdo(9000, 3000);
+  CHECK(bench.attach());
+  delay(100);
+
+  //Started after the contract: PS_RDY replaced the Source_Capabilities in the RX buffer
+  STUSB4500_PowerBudget budget;
+  budget.begin(bench.usb);
+  CHECK_EQUAL(0, budget.getSourcePdoCount());
+  CHECK_EQUAL(POWER_SOURCE_PD, budget.getSource());
+  CHECK(!budget.isKnown());
+  CHECK_EQUAL(2000, budget.getCurrent());
+  CHECK_EQUAL(0, budget.getVoltage());
+  CHECK_EQUAL(0, budget.getPower());
+
+  //Not a drop below the threshold: the 9V contract is still there
+  thresholdCalls = 0;
+  CHECK(budget.addThreshold(16000, onThreshold));
+  CHECK(!budget.refresh());
+  CHECK_EQUAL(0, thresholdCalls);
+
+  //Renegotiating brings new capabilities, seen if the status is read in time
+  STUSB4500_Status status;
+  bench.usb.softReset();
+  for(uint16_t ms=0; ms<1000 && budget.getSourcePdoCount() == 0; ms++)
+  {
+    delay(1);
+    bench.usb.readStatus(status);
+    budget.update(status);
+  }
+  CHECK(bench.waitContract());
+  delay(100);
+  budget.refresh();
+  CHECK(budget.isKnown());
+  CHECK_EQUAL(9000, budget.getVoltage());
+  CHECK_EQUAL(18000, budget.getPower());
+  CHECK_EQUAL(1, thresholdCalls);
+  CHECK_EQUAL(18000, thresholdPower);
+  CHECK(thresholdAbove);
+
+  //5V contracts are always known
+  bench.source.clearPdos();
+  bench.source.addFixedPdo(5000, 1500);
+  bench.chip.detach();
+  delay(100);
+  CHECK(bench.attach());
+  delay(100);
+  budget.begin(bench.usb);
+  CHECK(budget.isKnown());
+  CHECK_EQUAL(5000, budget.getVoltage());
+}
@@ -0,0 +1,120 @@
+/*
+  STUSB4500_SafeUpdate: updates interrupted by a brown-out of the STUSB4500.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_SafeUpdate.h"
+
+static constexpr STUSB4500_NvmImage oldImage = STUSB4500_NvmImage::defaults();
+
+//Changes two sectors: the PDO2 current (sector 3) and voltage (sector 4)
+static constexpr STUSB4500_NvmImage newImage = STUSB4500_NvmImage::defaults()
+  .current<2, 2000>().voltage<2, 9000>();
+
+static_assert(newImage.byte(4, 0) == 0x00 && newImage.byte(0, 5) == 0x45, "byte() is usable at compile time");
+
+static uint8_t sectorsMatching(const EmulatedSTUSB4500 &chip, const STUSB4500_NvmImage &image)
+{
+  uint8_t expected[5][8], nvm[5][8];
+  image.toBytes(expected);
+  chip.getNvm(nvm);
+  return ~nvmSectorDiff(nvm, expected) & 0x1F;
+}
+
+//Browns out once the first changed sector is erased and programmed
+static void interruptedUpdate(HostBench &bench, STUSB4500_SafeUpdate &safe)
+{
+  CHECK_EQUAL(SAFE_NVM_MATCH, safe.begin(bench.usb, oldImage));
+  bench.chip.failAfterNvmOperations(2);
+  CHECK_EQUAL(SAFE_UPDATE_BUS_ERROR, safe.update(newImage));
+  CHECK(bench.chip.brownedOut());
+  bench.chip.powerCycle();
+
+  //A mix of complete sectors, none of them blank
+  uint8_t oldSectors = sectorsMatching(bench.chip, oldImage);
+  uint8_t newSectors = sectorsMatching(bench.chip, newImage);
+  CHECK_EQUAL(0x1F, oldSectors | newSectors);
+  CHECK(newSectors & ~oldSectors);
+  CHECK(oldSectors & ~newSectors);
+}
+
+TEST(interrupted_update_is_partial_for_the_same_object)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  STUSB4500_SafeUpdate safe;
+  interruptedUpdate(bench, safe);
+
+  CHECK_EQUAL(SAFE_NVM_PARTIAL, safe.check());
+  CHECK_EQUAL(SAFE_UPDATE_OK, safe.update());
+  CHECK_EQUAL(0x1F, sectorsMatching(bench.chip, newImage));
+  CHECK_EQUAL(SAFE_NVM_MATCH, safe.check());
+}
+
+TEST(interrupted_update_is_restored_at_begin_with_the_previous_image)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  {
+    STUSB4500_SafeUpdate safe;
+    interruptedUpdate(bench, safe);
+  }
+
+  //After a reset of the MCU too, only the two images are known
+  STUSB4500_SafeUpdate unaware;
+  CHECK_EQUAL(SAFE_NVM_DIFFERENT, unaware.begin(bench.usb, newImage));
+  CHECK_EQUAL(0, unaware.getRestoreCount());
+
+  STUSB4500_SafeUpdate safe;
+  CHECK_EQUAL(SAFE_NVM_PARTIAL, safe.begin(bench.usb, newImage, oldImage));
+  CHECK_EQUAL(1, safe.getRestoreCount());
+  CHECK_EQUAL(0x1F, sectorsMatching(bench.chip, newImage));
+
+  //A complete previous configuration is still only DIFFERENT
+  STUSB4500_SafeUpdate downgrade;
+  CHECK_EQUAL(SAFE_NVM_DIFFERENT, downgrade.begin(bench.usb, oldImage, newImage));
+  CHECK_EQUAL(0, downgrade.getRestoreCount());
+}
+
+TEST(restore_count_adds_up_over_interrupted_updates)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  STUSB4500_SafeUpdate safe;
+  CHECK_EQUAL(0, safe.getRestoreCount());
+
+  //Interrupted on the way to the new image, restored by the next begin()
+  interruptedUpdate(bench, safe);
+  CHECK_EQUAL(SAFE_NVM_PARTIAL, safe.begin(bench.usb, newImage, oldImage));
+  CHECK_EQUAL(1, safe.getRestoreCount());
+  CHECK_EQUAL(0x1F, sectorsMatching(bench.chip, newImage));
+
+  //Interrupted again on the way back, the same object counts both restores
+  bench.chip.failAfterNvmOperations(2);
+  CHECK_EQUAL(SAFE_UPDATE_BUS_ERROR, safe.update(oldImage));
+  bench.chip.powerCycle();
+  CHECK_EQUAL(SAFE_NVM_PARTIAL, safe.begin(bench.usb, oldImage, newImage));
+  CHECK_EQUAL(2, safe.getRestoreCount());
+  CHECK_EQUAL(0x1F, sectorsMatching(bench.chip, oldImage));
+
+  //Nothing to restore: the count is kept until it is cleared
+  CHECK_EQUAL(SAFE_NVM_MATCH, safe.begin(bench.usb, oldImage));
+  CHECK_EQUAL(2, safe.getRestoreCount());
+  safe.clearRestoreCount();
+  CHECK_EQUAL(0, safe.getRestoreCount());
+}
+
+TEST(image_bytes_are_the_sectors_in_little_endian_order)
+{
+  uint8_t bytes[5][8];
+  newImage.toBytes(bytes);
+
+  for(uint8_t s=0; s<5; s++)
+  {
+    for(uint8_t b=0; b<8; b++)
+    {
+      CHECK_EQUAL((uint8_t)(newImage.sector[s] >> (8*b)), bytes[s][b]);
+      CHECK_EQUAL(bytes[s][b], newImage.byte(s, b));
+    }
+  }
+}
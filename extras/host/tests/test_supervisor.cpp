@@ -0,0 +1,82 @@
+/*
+  STUSB4500_Supervisor: bus errors of a wake up.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_Supervisor.h"
+
+TEST(wake_reports_the_read_error_and_keeps_the_last_status)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb));
+  bench.chip.attach(bench.source);
+  CHECK_EQUAL(0, supervisor.wake());
+  CHECK(supervisor.getEvents() & ALERT_CC_DETECTION_STATUS);
+
+  bench.chip.setPresent(false);
+  CHECK(supervisor.wake() != 0);
+  CHECK(supervisor.getEvents() & ALERT_CC_DETECTION_STATUS);
+  supervisor.alert();
+  CHECK(!supervisor.update());
+
+  bench.chip.setPresent(true);
+  bench.chip.failReads(1);
+  CHECK(supervisor.wake() != 0);
+  CHECK_EQUAL(4, supervisor.getWakeCount());
+
+  supervisor.end();
+}
+
+TEST(pending_changes_are_committed_while_supervised)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.setAutoCommit(100, 1000);
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb));
+  CHECK(bench.usb.isIdle());
+
+  bench.usb.setFlexCurrent(2.0);
+  uint32_t erases = bench.chip.getNvmErases();
+  CHECK(!bench.usb.update());
+  delay(150);
+  CHECK(!supervisor.update());
+  CHECK(bench.usb.update());
+  CHECK_EQUAL(1, bench.usb.getCommitCount());
+  CHECK(bench.chip.getNvmErases() > erases);
+
+  bench.chip.powerCycle();
+  bench.usb.read();
+  CHECK_EQUAL(200, (long)(bench.usb.getFlexCurrent() * 100 + 0.5));
+
+  supervisor.end();
+}
+
+TEST(reset_detection_runs_on_the_wake_ups)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  bench.usb.setResetDetection(100);
+  bench.usb.setVoltage(2, 9.0);
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb));
+
+  //Idle: update() no longer polls the chip
+  bench.chip.powerCycle();
+  uint32_t transactions = bench.chip.getTransactions();
+  delay(150);
+  CHECK(!bench.usb.update());
+  CHECK_EQUAL(transactions, bench.chip.getTransactions());
+
+  bench.chip.attach(bench.source);
+  CHECK_EQUAL(0, supervisor.wake());
+  CHECK_EQUAL(1, bench.usb.getResetCount());
+  CHECK_EQUAL(9000, (long)(bench.usb.getVoltage(2) * 1000));
+
+  supervisor.end();
+}
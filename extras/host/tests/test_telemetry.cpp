@@ -0,0 +1,111 @@
+/*
+  STUSB4500_Telemetry next to a Supervisor, and the telemetry decoder on a
+  corrupted stream.
+*/
+
+#include "host_test.h"
+#include "STUSB4500_Telemetry.h"
+#include "STUSB4500_Supervisor.h"
+
+TEST(telemetry_samples_leave_the_events_to_the_supervisor)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb));
+  STUSB4500_Telemetry telemetry;
+  telemetry.begin(bench.usb);
+
+  //The sample reads, and so clears, the attach transition before the wake up
+  CHECK(bench.attach());
+  uint8_t record[TELEMETRY_MAX_RECORD_LENGTH];
+  STUSB4500_TelemetryDecoder decoder;
+  uint8_t length = telemetry.sample(record);
+  for(uint8_t i=0; i<length; i++) decoder.push(record[i]);
+  CHECK_EQUAL(1, decoder.records());
+  CHECK(decoder.state().status()[PORT_STATUS_0 - ALERT_STATUS_1] & 0x01);
+  CHECK(!bench.chip.alertAsserted());
+
+  CHECK(supervisor.update());
+  CHECK(supervisor.getEvents() & ALERT_CC_DETECTION_STATUS);
+  CHECK(supervisor.getStatus().attachTransition());
+  CHECK(supervisor.getStatus().attached());
+
+  //Returned once
+  CHECK(!supervisor.update());
+  STUSB4500_Status status;
+  CHECK_EQUAL(0, bench.usb.readStatus(status));
+  CHECK(!status.attachTransition());
+
+  //Without a Supervisor, readStatus() gets the events a sample has seen
+  bench.chip.detach();
+  telemetry.sample(record);
+  CHECK_EQUAL(0, bench.usb.readStatus(status));
+  CHECK(status.attachTransition());
+  CHECK(!status.attached());
+
+  supervisor.end();
+}
+
+TEST(telemetry_samples_leave_the_hardware_faults_to_the_supervisor)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  CHECK(bench.attach());
+
+  STUSB4500_Supervisor supervisor;
+  CHECK(supervisor.begin(bench.usb));
+  STUSB4500_Telemetry telemetry;
+  telemetry.begin(bench.usb);
+  uint8_t record[TELEMETRY_MAX_RECORD_LENGTH];
+  telemetry.sample(record);
+
+  //A VPU overvoltage that came and went: only VPU_OVP_FAULT_TRANS is left
+  bench.chip.pokeRegister(CC_HW_FAULT_STATUS_0, 0x20);
+  CHECK(bench.chip.alertAsserted());
+  CHECK(telemetry.sample(record) > 0);
+  CHECK(!bench.chip.alertAsserted());
+
+  CHECK(supervisor.update());
+  CHECK(supervisor.getEvents() & ALERT_HW_FAULT_STATUS);
+  CHECK(supervisor.getStatus().hwFault());
+  CHECK(!supervisor.getStatus().attachTransition());
+
+  supervisor.end();
+}
+
+TEST(decoder_rescans_the_bytes_after_a_false_sync)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+  CHECK(bench.attach());
+
+  STUSB4500_Telemetry telemetry;
+  telemetry.begin(bench.usb);
+  uint8_t first[TELEMETRY_MAX_RECORD_LENGTH], second[TELEMETRY_MAX_RECORD_LENGTH];
+  uint8_t firstLength = telemetry.sample(first);
+  bench.usb.setVoltage(2, 9.0);
+  uint8_t secondLength = telemetry.sample(second);
+  CHECK(firstLength > 0 && secondLength > 0);
+
+  //A truncated record: its sync byte is followed by the start of a real record
+  uint8_t stream[2 + 2 * TELEMETRY_MAX_RECORD_LENGTH];
+  uint8_t length = 0;
+  stream[length++] = TELEMETRY_SYNC;
+  stream[length++] = 0x00;
+  memcpy(&stream[length], first, firstLength);
+  length += firstLength;
+  memcpy(&stream[length], second, secondLength);
+  length += secondLength;
+
+  STUSB4500_TelemetryDecoder decoder;
+  uint8_t decoded = 0;
+  for(uint8_t i=0; i<length; i++) decoded += decoder.push(stream[i]);
+
+  CHECK_EQUAL(2, decoded);
+  CHECK_EQUAL(2, decoder.records());
+  CHECK_EQUAL(1, decoder.crcErrors());
+  CHECK_EQUAL(0, decoder.lostRecords());
+  CHECK_EQUAL(9000, (long)((decoder.state().pdo(2) >> 10 & 0x3FF) * 50));
+}
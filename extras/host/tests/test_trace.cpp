@@ -0,0 +1,207 @@
+/*
+  STUSB4500_Trace: recording, the binary dump, and traceCompare().
+*/
+
+#include "host_test.h"
+#include "STUSB4500_Trace.h"
+
+#define DUMP_LENGTH 2048
+
+class DumpBuffer : public Print {
+  public:
+  uint8_t data[DUMP_LENGTH];
+  uint32_t length = 0;
+
+  size_t write(uint8_t c)
+  {
+    if(length == DUMP_LENGTH) return 0;
+    data[length++] = c;
+    return 1;
+  }
+  using Print::write;
+};
+
+//Records the PDO setters and a read back, as a sketch would
+static void tracedSetters(HostBench &bench, STUSB4500_Trace &trace, STUSB4500_TraceEntry *buffer,
+                          uint8_t entries, float voltage)
+{
+  CHECK(bench.usb.begin());
+  trace.begin(bench.usb, buffer, entries);
+  bench.usb.setVoltage(2, voltage);
+  bench.usb.setPdoNumber(2);
+  bench.usb.getPdoNumber();
+  trace.end();
+}
+
+TEST(trace_records_every_transaction_in_order)
+{
+  HostBench bench;
+  STUSB4500_Trace trace;
+  STUSB4500_TraceEntry buffer[16];
+
+  uint32_t transactions = bench.chip.getTransactions();
+  tracedSetters(bench, trace, buffer, 16, 9.0);
+  CHECK(trace.getCount() > 0);
+  CHECK_EQUAL(0, trace.getDropped());
+
+  //Stopped: the next transactions are not recorded
+  uint8_t count = trace.getCount();
+  bench.usb.getPdoNumber();
+  CHECK_EQUAL(count, trace.getCount());
+
+  //setVoltage(): read then write of PDO2, and the last one reads DPM_PDO_NUMB
+  const STUSB4500_TraceEntry *first = trace.getEntry(0);
+  CHECK(first->isRead());
+  CHECK_EQUAL(DPM_SNK_PDO1 + 4, first->reg);
+  CHECK_EQUAL(4, first->length);
+  CHECK_EQUAL(0, first->result());
+  const STUSB4500_TraceEntry *second = trace.getEntry(1);
+  CHECK(!second->isRead());
+  CHECK_EQUAL(DPM_SNK_PDO1 + 4, second->reg);
+  CHECK_EQUAL(180, (long)((second->data[1] >> 2 | (second->data[2] & 0x0F) << 6)));
+  const STUSB4500_TraceEntry *last = trace.getEntry(count - 1);
+  CHECK(last->isRead());
+  CHECK_EQUAL(DPM_PDO_NUMB, last->reg);
+  CHECK_EQUAL(2, last->data[0] & 0x07);
+  CHECK(trace.getEntry(count) == NULL);
+
+  for(uint8_t i=1; i<count; i++) CHECK(trace.getEntry(i)->time >= trace.getEntry(i-1)->time);
+  CHECK(bench.chip.getTransactions() - transactions > count);
+}
+
+TEST(trace_ring_keeps_the_latest_entries)
+{
+  HostBench bench;
+  STUSB4500_Trace full, ring;
+  STUSB4500_TraceEntry fullBuffer[32], ringBuffer[3];
+
+  CHECK(bench.usb.begin());
+  full.begin(bench.usb, fullBuffer, 32);
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.setPdoNumber(2);
+  bench.usb.getPdoNumber();
+  full.end();
+
+  ring.begin(bench.usb, ringBuffer, 3);
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.setPdoNumber(2);
+  bench.usb.getPdoNumber();
+  ring.end();
+
+  CHECK_EQUAL(3, ring.getCount());
+  CHECK_EQUAL(full.getCount() - 3, ring.getDropped());
+  for(uint8_t i=0; i<3; i++)
+  {
+    const STUSB4500_TraceEntry *a = full.getEntry(full.getCount() - 3 + i);
+    const STUSB4500_TraceEntry *b = ring.getEntry(i);
+    CHECK_EQUAL(a->flags, b->flags);
+    CHECK_EQUAL(a->reg, b->reg);
+    CHECK_EQUAL(a->length, b->length);
+  }
+
+  ring.clear();
+  CHECK_EQUAL(0, ring.getCount());
+  CHECK_EQUAL(0, ring.getDropped());
+}
+
+TEST(trace_dump_reads_back_with_the_reader)
+{
+  HostBench bench(0x29);
+  STUSB4500_Trace trace;
+  STUSB4500_TraceEntry buffer[4];
+
+  //Longer than the ring, with a 12 byte transfer among the last entries
+  CHECK(bench.usb.begin(0x29));
+  trace.begin(bench.usb, buffer, 4);
+  bench.usb.setVoltage(2, 9.0);
+  bench.usb.setPdoNumber(2);
+  STUSB4500_Config config;
+  bench.usb.readConfig(config);
+  trace.end();
+
+  DumpBuffer dump;
+  uint32_t length = trace.dump(dump);
+  CHECK_EQUAL(dump.length, length);
+
+  STUSB4500_TraceReader reader;
+  CHECK(reader.begin(dump.data, dump.length));
+  CHECK_EQUAL(0x29, reader.address());
+  CHECK_EQUAL(trace.getDropped(), reader.dropped());
+  CHECK_EQUAL(4, reader.count());
+
+  STUSB4500_TraceEntry entry;
+  for(uint8_t i=0; i<4; i++)
+  {
+    const STUSB4500_TraceEntry *recorded = trace.getEntry(i);
+    CHECK(reader.next(entry));
+    CHECK_EQUAL(recorded->time, entry.time);
+    CHECK_EQUAL(recorded->flags, entry.flags);
+    CHECK_EQUAL(recorded->reg, entry.reg);
+    CHECK_EQUAL(recorded->length, entry.length);
+    CHECK(memcmp(recorded->data, entry.data, entry.stored()) == 0);
+  }
+  CHECK(!reader.next(entry));
+  CHECK(trace.getEntry(2)->length == 12 && trace.getEntry(2)->stored() == TRACE_DATA_LENGTH);
+
+  //Truncated or foreign data
+  CHECK(reader.begin(dump.data, dump.length - 1));
+  for(uint8_t i=0; i<3; i++) CHECK(reader.next(entry));
+  CHECK(!reader.next(entry));
+  dump.data[0] = 0;
+  CHECK(!reader.begin(dump.data, dump.length));
+}
+
+TEST(trace_compare_finds_the_first_different_transaction)
+{
+  STUSB4500_TraceEntry bufferA[16], bufferB[16], bufferC[16];
+  STUSB4500_Trace traceA, traceB, traceC;
+  DumpBuffer dumpA, dumpB, dumpC;
+
+  {
+    HostBench bench;
+    tracedSetters(bench, traceA, bufferA, 16, 9.0);
+    traceA.dump(dumpA);
+  }
+  {
+    //Same transactions later on: timestamps differ, the sequence doesn't
+    HostBench bench;
+    delay(500);
+    tracedSetters(bench, traceB, bufferB, 16, 9.0);
+    traceB.dump(dumpB);
+  }
+  {
+    HostBench bench;
+    tracedSetters(bench, traceC, bufferC, 16, 12.0);
+    traceC.dump(dumpC);
+  }
+
+  STUSB4500_TraceDiff diff;
+  CHECK(traceCompare(dumpA.data, dumpA.length, dumpB.data, dumpB.length, diff));
+  CHECK_EQUAL(-1, diff.firstMismatch);
+  CHECK_EQUAL(diff.readsA, diff.readsB);
+  CHECK_EQUAL(diff.writesA, diff.writesB);
+  CHECK(diff.readsA > 0 && diff.writesA > 0);
+  CHECK_EQUAL(diff.durationA, diff.durationB);
+
+  //Another voltage: the write of PDO2 differs
+  CHECK(!traceCompare(dumpA.data, dumpA.length, dumpC.data, dumpC.length, diff));
+  CHECK_EQUAL(1, diff.firstMismatch);
+
+  //A missing entry at the end
+  CHECK(!traceCompare(dumpA.data, dumpA.length, dumpA.data, dumpA.length - TRACE_ENTRY_HEADER_LENGTH - 1, diff));
+  CHECK_EQUAL(traceA.getCount() - 1, diff.firstMismatch);
+}
+
+TEST(trace_that_was_never_started)
+{
+  STUSB4500_Trace trace;
+  trace.end();
+  CHECK_EQUAL(0, trace.getCount());
+  CHECK(trace.getEntry(0) == NULL);
+  trace.record(true, DPM_PDO_NUMB, NULL, 0, 0);
+  CHECK_EQUAL(0, trace.getCount());
+
+  DumpBuffer dump;
+  CHECK_EQUAL(TRACE_HEADER_LENGTH, trace.dump(dump));
+  CHECK_EQUAL(0, dump.data[2]);
+}
@@ -0,0 +1,89 @@
+/*
+  validate() and the checks write() does before programming the NVM.
+*/
+
+#include "host_test.h"
+
+//Writes a PDO register directly, bypassing the clamping done by setVoltage()/setCurrent()
+static void pokePdo(EmulatedSTUSB4500 &chip, uint8_t pdo, uint16_t millivolts, uint16_t milliamps)
+{
+  uint32_t value = ((uint32_t)(millivolts / 50) << 10) | (milliamps / 10);
+  for(uint8_t j=0; j<4; j++) chip.pokeRegister(DPM_SNK_PDO1 + (pdo-1)*4 + j, value >> (8*j));
+}
+
+static uint8_t countIssues(const STUSB4500_Validation &result, uint8_t pdo, uint8_t code)
+{
+  uint8_t count = 0;
+  for(uint8_t i=0; i<result.count; i++) if(result.pdo[i] == pdo && result.code[i] == code) count++;
+  return count;
+}
+
+TEST(order_is_checked_on_the_clamped_voltages)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  //22.5V is saved as 20V, 21V as 20V too: not out of order
+  pokePdo(bench.chip, 2, 22500, 1500);
+  pokePdo(bench.chip, 3, 21000, 1500);
+  bench.usb.setPdoNumber(3);
+
+  STUSB4500_Validation result;
+  bench.usb.validate(result);
+  CHECK_EQUAL(0, countIssues(result, 3, VALIDATION_PDO_ORDER));
+  CHECK_EQUAL(1, countIssues(result, 2, VALIDATION_VOLTAGE_CLAMPED));
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_VOLTAGE_CLAMPED));
+
+  //19V is below the 20V PDO2 will be saved with
+  pokePdo(bench.chip, 3, 19000, 1500);
+  bench.usb.validate(result);
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_PDO_ORDER));
+  CHECK(!result.ok());
+}
+
+TEST(every_issue_of_a_pdo_is_reported)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  //PDO3: out of order, overvoltage limit above 22V, current uses FLEX_I which is 0A
+  pokePdo(bench.chip, 2, 22500, 1500);
+  pokePdo(bench.chip, 3, 19000, 300);
+  bench.usb.setPdoNumber(3);
+  bench.usb.setFlexCurrent(0);
+  bench.usb.setUpperVoltageLimit(3, 20);
+
+  STUSB4500_Validation result;
+  bench.usb.validate(result);
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_PDO_ORDER));
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_OVLO_ABOVE_MAX));
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_CURRENT_USES_FLEX));
+  CHECK_EQUAL(1, countIssues(result, 3, VALIDATION_FLEX_CURRENT_ZERO));
+  CHECK_EQUAL(2, result.errors);
+}
+
+TEST(issues_beyond_the_list_are_still_counted)
+{
+  HostBench bench;
+  CHECK(bench.usb.begin());
+
+  //Four issues on PDO2 and PDO3, two on PDO1: more than VALIDATION_MAX_ISSUES
+  pokePdo(bench.chip, 1, 5000, 300);
+  pokePdo(bench.chip, 2, 22500, 300);
+  pokePdo(bench.chip, 3, 19000, 300);
+  bench.usb.setPdoNumber(3);
+  bench.usb.setFlexCurrent(0);
+  bench.usb.setUpperVoltageLimit(2, 20);
+  bench.usb.setUpperVoltageLimit(3, 20);
+
+  STUSB4500_Validation result;
+  bench.usb.validate(result);
+  CHECK_EQUAL(VALIDATION_MAX_ISSUES, result.count);
+  CHECK_EQUAL(10, result.errors + result.warnings);
+  CHECK_EQUAL(4, result.errors);
+
+  //Refused, the NVM is left alone
+  uint32_t erases = bench.chip.getNvmErases();
+  CHECK_EQUAL(NVM_WRITE_REFUSED, bench.usb.write());
+  CHECK_EQUAL(erases, bench.chip.getNvmErases());
+}
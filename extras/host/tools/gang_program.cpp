@@ -0,0 +1,204 @@
+/*
+  Gang programming of emulated STUSB4500s on several I2C buses, as on a
+  production fixture.
+
+    gang_program [-b buses] [-d boards] [-m matching] [-k kHz] [-s]
+
+  Every bus is a TwoWire (the first one is Wire) with boards at 0x28, 0x29...
+  Each bus has its own worker, an STUSB4500_GangProgrammer holding the boards of
+  that bus, and the workers are given turns from the same loop until all have
+  finished. Within a bus the NVM busy times of the boards overlap, and the
+  workers of the other buses run during them.
+
+  The buses share the simulated clock of the host core: bus transfers are
+  blocking, as with one controller driving several Wire ports, so the traffic
+  of all the buses adds up. The timings are an upper bound for a fixture with
+  one controller per bus.
+
+  -b number of buses, 1-4 (default 2).
+  -d boards per bus, 1-4 (default 4).
+  -m the first boards already hold the image and are skipped after the read (default 0).
+  -k bus speed in kHz (default 100).
+  -s programs one board at a time instead, for comparison.
+
+  Output: a table, then
+    BOARD,bus,address,result,ms
+  for each board and
+    GANG,boards,programmed,skipped,failed,total_ms,board_ms_sum,boards_per_minute
+
+  Exit status: 0 when every board holds the image after a power cycle, 1 when
+  one doesn't, 2 on a usage error.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "STUSB4500_GangProgrammer.h"
+#include "stusb4500_nvm_image.h"
+#include "emulated_stusb4500.h"
+
+#define MAX_BUSES           4
+#define MAX_BUS_BOARDS      4
+
+static constexpr STUSB4500_NvmImage image = STUSB4500_NvmImage::defaults()
+  .pdoNumber<3>().voltage<2, 9000>().current<2, 2000>().voltage<3, 15000>().current<3, 1500>();
+
+static const char *resultNames[] = { "idle", "running", "programmed", "skipped", "verify failed", "bus error",
+                                     "timeout" };
+
+//The boards of one bus and the gang programmer that serves them
+struct BusWorker {
+  TwoWire *wire;
+  EmulatedSTUSB4500 *chips[MAX_BUS_BOARDS];
+  STUSB4500 boards[MAX_BUS_BOARDS];
+  STUSB4500_GangProgrammer gang;
+};
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: gang_program [-b buses] [-d boards] [-m matching] [-k kHz] [-s]\n");
+}
+
+//The chip loads its NVM at power up: compare it with the image
+static bool holdsImage(EmulatedSTUSB4500 &chip)
+{
+  uint8_t expected[5][8], nvm[5][8];
+  image.toBytes(expected);
+  chip.powerCycle();
+  chip.getNvm(nvm);
+  return memcmp(expected, nvm, sizeof(nvm)) == 0;
+}
+
+int main(int argc, char **argv)
+{
+  int buses = 2, boards = 4, matching = 0, clock = 100;
+  bool sequential = false;
+  int option;
+
+  while((option = getopt(argc, argv, "b:d:m:k:s")) != -1)
+  {
+    if(option == 'b') buses = atoi(optarg);
+    else if(option == 'd') boards = atoi(optarg);
+    else if(option == 'm') matching = atoi(optarg);
+    else if(option == 'k') clock = atoi(optarg);
+    else if(option == 's') sequential = true;
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if(optind != argc || buses < 1 || buses > MAX_BUSES || boards < 1 || boards > MAX_BUS_BOARDS ||
+     matching < 0 || matching > buses * boards || clock < 10 || clock > 1000)
+  {
+    usage();
+    return 2;
+  }
+
+  static TwoWire ports[MAX_BUSES - 1];
+  static BusWorker workers[MAX_BUSES];
+  uint8_t matchingImage[5][8];
+  image.toBytes(matchingImage);
+
+  for(int b=0; b<buses; b++)
+  {
+    BusWorker &worker = workers[b];
+    worker.wire = b == 0 ? &Wire : &ports[b - 1];
+    worker.wire->setClock(clock * 1000UL);
+    worker.gang.begin(image, NVM_JOB_COMPARE | NVM_JOB_VERIFY);
+
+    for(int d=0; d<boards; d++)
+    {
+      worker.chips[d] = new EmulatedSTUSB4500(0x28 + d);
+      if(b * boards + d < matching)
+      {
+        worker.chips[d]->setNvm(matchingImage);
+        worker.chips[d]->powerCycle();
+      }
+      worker.wire->attach(*worker.chips[d]);
+
+      if(!worker.boards[d].begin(0x28 + d, *worker.wire) || !worker.gang.addBoard(worker.boards[d]))
+      {
+        fprintf(stderr, "board 0x%02X on bus %d does not answer\n", 0x28 + d, b);
+        return 1;
+      }
+    }
+  }
+
+  uint32_t startTime = millis();
+  if(sequential)
+  {
+    //One board at a time, each run to the end before the next one starts
+    for(int b=0; b<buses; b++)
+    {
+      for(int d=0; d<boards; d++)
+      {
+        workers[b].gang.start(d, matchingImage, NVM_JOB_COMPARE | NVM_JOB_VERIFY);
+        while(workers[b].gang.update());
+      }
+    }
+  }
+  else
+  {
+    for(int b=0; b<buses; b++) workers[b].gang.start();
+
+    //Each worker advances its boards until they all wait on the NVM, then the next bus is served
+    bool running = true;
+    while(running)
+    {
+      running = false;
+      for(int b=0; b<buses; b++) if(workers[b].gang.update()) running = true;
+    }
+  }
+  uint32_t total = millis() - startTime;
+
+  uint8_t programmed = 0, skipped = 0, failed = 0;
+  uint32_t boardSum = 0;
+  bool written = true;
+
+  printf("%-4s %-8s %-14s %8s\n", "bus", "address", "result", "time");
+  for(int b=0; b<buses; b++)
+  {
+    STUSB4500_GangProgrammer &gang = workers[b].gang;
+    programmed += gang.getProgrammedCount();
+    skipped += gang.getSkippedCount();
+    failed += gang.getFailedCount();
+
+    for(int d=0; d<boards; d++)
+    {
+      uint8_t result = gang.getResult(d);
+      boardSum += gang.getBoardTime(d);
+      printf("%-4d 0x%02X     %-14s %5u ms\n", b, 0x28 + d, resultNames[result], gang.getBoardTime(d));
+    }
+  }
+  for(int b=0; b<buses; b++)
+  {
+    for(int d=0; d<boards; d++)
+    {
+      printf("BOARD,%d,0x%02X,%u,%u\n", b, 0x28 + d, workers[b].gang.getResult(d), workers[b].gang.getBoardTime(d));
+      if(!holdsImage(*workers[b].chips[d])) written = false;
+    }
+  }
+
+  float throughput = total > 0 ? buses * boards * 60000.0 / total : 0;
+  printf("%d boards on %d buses at %dkHz%s: %u programmed, %u skipped, %u failed in %u ms "
+         "(sum of the board times %u ms), %.0f boards/min\n", buses * boards, buses, clock,
+         sequential ? ", one at a time" : "", programmed, skipped, failed, total, boardSum, throughput);
+  printf("GANG,%d,%u,%u,%u,%u,%u,%.0f\n", buses * boards, programmed, skipped, failed, total, boardSum, throughput);
+
+  for(int b=0; b<buses; b++)
+  {
+    for(int d=0; d<boards; d++)
+    {
+      workers[b].wire->detach(*workers[b].chips[d]);
+      delete workers[b].chips[d];
+    }
+  }
+
+  return written && failed == 0 ? 0 : 1;
+}
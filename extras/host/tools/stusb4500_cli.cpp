@@ -0,0 +1,157 @@
+/*
+  Command line client of the STUSB4500_CommandProtocol serial command protocol,
+  for a board running Example7-SerialCommands.
+
+    stusb4500_cli [-b baud] [-w ms] <port> [get] [name=value ...] [write] [reset]
+
+  The parameter names and units are those of the text mode (see
+  STUSB4500_CommandProtocol.h): voltages in mV, currents in mA. All the changes
+  are sent in one frame and applied together. "get" prints every parameter
+  afterwards, "write" saves them to the NVM and "reset" renegotiates.
+
+  -b sets the baud rate (115200 by default). -w waits after opening the port,
+  for boards that reset when the port opens (2000ms by default).
+
+  Exit status: 0 when the command succeeded, 1 when it was refused, 2 on a usage
+  or communication error.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "command_client.h"
+#include "serial_transport.h"
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: stusb4500_cli [-b baud] [-w ms] <port> [get] [name=value ...] [write] [reset]\n");
+  fprintf(stderr, "parameters:");
+  for(uint8_t i=0; i<COMMAND_PARAM_COUNT; i++) fprintf(stderr, " %s", commandParamText[i].name);
+  fprintf(stderr, "\n");
+}
+
+//Converts name=value into a parameter id and a value in protocol units
+static bool parseParam(char *text, uint8_t &id, uint16_t &value)
+{
+  char *number = strchr(text, '=');
+  if(number == NULL) return false;
+  *number++ = 0;
+
+  id = 0;
+  for(uint8_t i=0; i<COMMAND_PARAM_COUNT; i++)
+  {
+    if(strcasecmp(text, commandParamText[i].name) == 0) id = i + 1;
+  }
+  if(id == 0)
+  {
+    fprintf(stderr, "unknown parameter %s\n", text);
+    return false;
+  }
+
+  uint16_t minimum = 0, maximum = 0;
+  uint8_t scale = commandParamText[id-1].scale;
+  commandParamRange(id, minimum, maximum);
+
+  char *end = number;
+  long parsed = -1;
+  if(*number >= '0' && *number <= '9') parsed = strtol(number, &end, 10);
+  if(*end != 0 || parsed < 0 || parsed / scale < minimum || parsed / scale > maximum)
+  {
+    fprintf(stderr, "%s must be between %u and %u\n", text, minimum * scale, maximum * scale);
+    return false;
+  }
+
+  value = parsed / scale;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t baud = 115200;
+  uint32_t wait = 2000;
+  int option;
+
+  while((option = getopt(argc, argv, "b:w:")) != -1)
+  {
+    if(option == 'b') baud = strtoul(optarg, NULL, 10);
+    else if(option == 'w') wait = strtoul(optarg, NULL, 10);
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if(optind >= argc)
+  {
+    usage();
+    return 2;
+  }
+  const char *port = argv[optind++];
+
+  SerialTransport transport;
+  CommandClient client(transport);
+  uint8_t flags = 0;
+  uint8_t ids[COMMAND_MAX_PAYLOAD / 3];
+  uint8_t count = 0;
+
+  for(int i=optind; i<argc; i++)
+  {
+    uint8_t id;
+    uint16_t value;
+
+    if(strcasecmp(argv[i], "get") == 0)        flags |= COMMAND_FLAG_READ;
+    else if(strcasecmp(argv[i], "write") == 0) flags |= COMMAND_FLAG_WRITE;
+    else if(strcasecmp(argv[i], "reset") == 0) flags |= COMMAND_FLAG_SOFT_RESET;
+    else if(!parseParam(argv[i], id, value) || !client.set(id, value))
+    {
+      usage();
+      return 2;
+    }
+    else ids[count++] = id;
+  }
+
+  if(!transport.open(port, baud))
+  {
+    fprintf(stderr, "cannot open %s at %u baud\n", port, baud);
+    return 2;
+  }
+  usleep(wait * 1000);
+
+  CommandResult result;
+  uint8_t error = client.execute(flags, result);
+  if(error != CLIENT_OK)
+  {
+    fprintf(stderr, error == CLIENT_TIMEOUT ? "no response from the board\n" : "cannot send to the board\n");
+    return 2;
+  }
+
+  switch(result.status)
+  {
+    case COMMAND_OK:          printf("OK"); break;
+    case COMMAND_ERROR_FRAME: printf("ERR frame"); break;
+    case COMMAND_ERROR_PARAM:
+      printf("ERR parameter %s", result.applied < count ? commandParamText[ids[result.applied]-1].name : "?");
+      break;
+    case COMMAND_ERROR_WRITE: printf("ERR write refused"); break;
+    default:                  printf("ERR %u", result.status); break;
+  }
+  printf(" applied=%u", result.applied);
+  if(result.writeResult != COMMAND_NOT_WRITTEN) printf(" write=%u", result.writeResult);
+  printf(" apply_us=%u write_ms=%u\n", result.applyTime, result.writeTime);
+
+  if(result.hasValues)
+  {
+    for(uint8_t i=0; i<COMMAND_PARAM_COUNT; i++)
+    {
+      printf("%-9s %u\n", commandParamText[i].name, result.values[i] * commandParamText[i].scale);
+    }
+  }
+
+  return result.status == COMMAND_OK ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/*
+  Replays an I2C trace dumped by STUSB4500_Trace on the emulated STUSB4500 and
+  reports where the emulator diverges from the board the trace was taken on.
+
+    trace_replay [-s] [-o replayed.bin] <trace.bin>
+
+  Every entry is sent to a freshly powered EmulatedSTUSB4500 at the address of
+  the dump, at the time offset it was recorded at, so NVM busy polls see the same
+  timing. The replayed transactions are recorded in a second trace and the two
+  are compared with traceCompare(): direction, register, length and written data.
+  The data returned by the reads, which traceCompare() ignores, is compared too.
+  Writes longer than TRACE_DATA_LENGTH only have their first bytes in the dump,
+  the rest is filled with the current register values.
+
+  -s attaches a simulated charger (5V 3A, 9V 3A, 15V 3A) before the replay, for
+     traces taken with a source plugged in.
+  -o saves the replayed trace, in the same dump format.
+
+  Output: a summary, then
+    REPLAY,entries,reads,writes,first_mismatch,read_mismatches,first_read_mismatch,trace_us,replay_us
+  with -1 for no mismatch.
+
+  Exit status: 0 when the replay matches, 1 when it diverges, 2 on a usage or file error.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "STUSB4500_Trace.h"
+#include "emulated_stusb4500.h"
+#include "simulated_source.h"
+
+#define MAX_DUMP_LENGTH (TRACE_HEADER_LENGTH + 255UL * (TRACE_ENTRY_HEADER_LENGTH + TRACE_DATA_LENGTH))
+
+//Collects a dump in memory
+class DumpBuffer : public Print {
+  public:
+  uint8_t data[MAX_DUMP_LENGTH];
+  uint32_t length = 0;
+
+  size_t write(uint8_t c)
+  {
+    if(length == MAX_DUMP_LENGTH) return 0;
+    data[length++] = c;
+    return 1;
+  }
+  using Print::write;
+};
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: trace_replay [-s] [-o replayed.bin] <trace.bin>\n");
+}
+
+//Bus time of a transaction at 100kHz, counted as the host Wire does: 9 bits per byte, address bytes included
+static uint32_t busTime(const STUSB4500_TraceEntry &entry)
+{
+  uint32_t bytes = entry.isRead() ? 3 + entry.length : 2 + entry.length;
+  return bytes * 90;
+}
+
+//Same transactions as I2C_Write_USB_PD() and I2C_Read_USB_PD()
+static uint8_t replayEntry(uint8_t address, EmulatedSTUSB4500 &chip, const STUSB4500_TraceEntry &entry,
+                           uint8_t *data)
+{
+  Wire.beginTransmission(address);
+  Wire.write(entry.reg);
+
+  if(!entry.isRead())
+  {
+    memcpy(data, entry.data, entry.stored());
+    for(uint16_t i=entry.stored(); i<entry.length; i++) data[i] = chip.peekRegister(entry.reg + i);
+    Wire.write(data, entry.length);
+    return Wire.endTransmission();
+  }
+
+  uint8_t error = Wire.endTransmission();
+  uint8_t received = Wire.requestFrom(address, entry.length);
+  if(error == 0 && received < entry.length) error = 4;
+  for(uint16_t i=0; i<entry.length; i++) data[i] = Wire.read();
+  return error;
+}
+
+int main(int argc, char **argv)
+{
+  const char *output = NULL;
+  bool charger = false;
+  int option;
+
+  while((option = getopt(argc, argv, "so:")) != -1)
+  {
+    if(option == 's') charger = true;
+    else if(option == 'o') output = optarg;
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if(optind != argc - 1)
+  {
+    usage();
+    return 2;
+  }
+
+  static uint8_t dump[MAX_DUMP_LENGTH];
+  FILE *file = fopen(argv[optind], "rb");
+  if(file == NULL)
+  {
+    fprintf(stderr, "cannot open %s\n", argv[optind]);
+    return 2;
+  }
+  uint32_t dumpLength = fread(dump, 1, sizeof(dump), file);
+  fclose(file);
+
+  STUSB4500_TraceReader reader;
+  if(!reader.begin(dump, dumpLength) || reader.count() > 255)
+  {
+    fprintf(stderr, "%s is not a STUSB4500 trace\n", argv[optind]);
+    return 2;
+  }
+
+  EmulatedSTUSB4500 chip(reader.address());
+  SimulatedSource source;
+  Wire.attach(chip);
+  if(charger)
+  {
+    source.addFixedPdo(9000, 3000);
+    source.addFixedPdo(15000, 3000);
+    chip.attach(source);
+  }
+
+  //The STUSB4500 only gives the replayed dump its address: begin() on an empty bus sends nothing to the chip
+  static STUSB4500_TraceEntry entries[255];
+  TwoWire emptyBus;
+  STUSB4500 usb;
+  usb.begin(reader.address(), emptyBus);
+  STUSB4500_Trace replayed;
+  replayed.begin(usb, entries, 255);
+
+  STUSB4500_TraceEntry entry;
+  uint32_t firstTime = 0;
+  uint64_t startTime = 0;
+  int32_t index = 0;
+  int32_t firstReadMismatch = -1;
+  uint16_t readMismatches = 0;
+  uint8_t expected[TRACE_DATA_LENGTH];
+  uint8_t expectedLength = 0;
+  uint8_t got[TRACE_DATA_LENGTH];
+
+  while(reader.next(entry))
+  {
+    //Each transaction ends at the same offset from the first one as on the board
+    if(index == 0)
+    {
+      firstTime = entry.time;
+      startTime = hostMicros() + busTime(entry);
+    }
+    uint64_t end = startTime + (uint32_t)(entry.time - firstTime);
+    if(hostMicros() + busTime(entry) < end) hostAdvance(end - busTime(entry) - hostMicros());
+
+    uint8_t data[256];
+    uint8_t result = replayEntry(reader.address(), chip, entry, data);
+    replayed.record(entry.isRead(), entry.reg, data, entry.length, result);
+
+    if(entry.isRead() && result == 0 && entry.result() == 0 && memcmp(data, entry.data, entry.stored()) != 0)
+    {
+      if(readMismatches++ == 0)
+      {
+        firstReadMismatch = index;
+        expectedLength = entry.stored();
+        memcpy(expected, entry.data, expectedLength);
+        memcpy(got, data, expectedLength);
+      }
+    }
+    index++;
+  }
+
+  DumpBuffer replayDump;
+  replayed.dump(replayDump);
+
+  STUSB4500_TraceDiff diff;
+  bool same = traceCompare(dump, dumpLength, replayDump.data, replayDump.length, diff);
+
+  printf("trace:  %d entries, %u reads, %u writes, %u dropped before the dump, address 0x%02X, %d us\n",
+         index, diff.readsA, diff.writesA, reader.dropped(), reader.address(), diff.durationA);
+  printf("replay: %d us, %s\n", diff.durationB, same ? "same transactions" : "transactions differ");
+  if(!same)
+  {
+    STUSB4500_TraceReader first;
+    first.begin(dump, dumpLength);
+    for(int32_t i=0; i<=diff.firstMismatch && first.next(entry); i++) {}
+    const STUSB4500_TraceEntry *other = replayed.getEntry(diff.firstMismatch);
+    printf("  entry %d: %s 0x%02X length %u result %u", diff.firstMismatch, entry.isRead() ? "read" : "write",
+           entry.reg, entry.length, entry.result());
+    if(other != NULL) printf(", replayed result %u\n", other->result());
+    else printf(", not replayed\n");
+  }
+  if(readMismatches > 0)
+  {
+    printf("  %u reads returned other data, first at entry %d:", readMismatches, firstReadMismatch);
+    for(uint8_t i=0; i<expectedLength; i++) printf(" %02X/%02X", expected[i], got[i]);
+    printf(" (trace/emulator)\n");
+  }
+  printf("REPLAY,%d,%u,%u,%d,%u,%d,%d,%d\n", index, diff.readsA, diff.writesA, diff.firstMismatch,
+         readMismatches, firstReadMismatch, diff.durationA, diff.durationB);
+
+  if(output != NULL)
+  {
+    file = fopen(output, "wb");
+    if(file == NULL || fwrite(replayDump.data, 1, replayDump.length, file) != replayDump.length)
+    {
+      fprintf(stderr, "cannot write %s\n", output);
+      if(file != NULL) fclose(file);
+      return 2;
+    }
+    fclose(file);
+  }
+
+  Wire.detach(chip);
+  return same && readMismatches == 0 ? 0 : 1;
+}
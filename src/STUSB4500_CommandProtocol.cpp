@@ -0,0 +1,327 @@
+/*
+  Serial command protocol for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_CommandProtocol.h"
+
+#define STATE_SYNC        0
+#define STATE_SEQUENCE    1
+#define STATE_LENGTH      2
+#define STATE_PAYLOAD     3
+#define STATE_CRC         4
+#define STATE_DISCARD     5
+
+void STUSB4500_CommandProtocol::begin(STUSB4500 &device, Stream &port, bool textMode)
+{
+  _device = &device;
+  _port = &port;
+  _textMode = textMode;
+  _state = STATE_SYNC;
+  _lineLength = 0;
+  _commandCount = 0;
+  _errorCount = 0;
+}
+
+void STUSB4500_CommandProtocol::setTextMode(bool textMode)
+{
+  _textMode = textMode;
+  _lineLength = 0;
+}
+
+bool STUSB4500_CommandProtocol::update(void)
+{
+  bool handled = false;
+
+  while(_port->available() > 0)
+  {
+    if(receive(_port->read())) handled = true;
+  }
+
+  return handled;
+}
+
+uint32_t STUSB4500_CommandProtocol::getCommandCount(void)
+{
+  return _commandCount;
+}
+
+uint32_t STUSB4500_CommandProtocol::getErrorCount(void)
+{
+  return _errorCount;
+}
+
+bool STUSB4500_CommandProtocol::receive(uint8_t data)
+{
+  switch(_state)
+  {
+    case STATE_SYNC:
+      if(data == COMMAND_SYNC)
+      {
+        _header[0] = data;
+        _state = STATE_SEQUENCE;
+      }
+      else if(_textMode)
+      {
+        if(data == '\n' || data == '\r')
+        {
+          if(_lineLength == 0) break;
+          _line[_lineLength] = 0;
+          handleLine();
+          _lineLength = 0;
+          return true;
+        }
+        if(_lineLength < COMMAND_MAX_LINE - 1) _line[_lineLength++] = data;
+      }
+      break;
+
+    case STATE_SEQUENCE:
+      _header[1] = data;
+      _state = STATE_LENGTH;
+      break;
+
+    case STATE_LENGTH:
+      _header[2] = data;
+      _received = 0;
+      if(data > COMMAND_MAX_PAYLOAD)
+      {
+        //Too long for the buffer: skip the payload and the CRC, then answer like any bad frame
+        _received = data;
+        _state = STATE_DISCARD;
+      }
+      else _state = data == 0 ? STATE_CRC : STATE_PAYLOAD;
+      break;
+
+    case STATE_PAYLOAD:
+      _buffer[_received++] = data;
+      if(_received == _header[2]) _state = STATE_CRC;
+      break;
+
+    case STATE_CRC:
+    {
+      _state = STATE_SYNC;
+
+      uint8_t crc = telemetryCrc8(_header, COMMAND_HEADER_LENGTH);
+      crc = telemetryCrc8(_buffer, _header[2], crc);
+      if(crc != data)
+      {
+        uint8_t response[1] = { COMMAND_ERROR_FRAME };
+        sendFrame(_header[1], response, 1);
+        _errorCount++;
+        return false;
+      }
+
+      handleFrame();
+      return true;
+    }
+
+    case STATE_DISCARD:
+    {
+      if(_received > 0)
+      {
+        _received--;
+        break;
+      }
+      _state = STATE_SYNC;
+
+      uint8_t response[1] = { COMMAND_ERROR_FRAME };
+      sendFrame(_header[1], response, 1);
+      _errorCount++;
+      return false;
+    }
+  }
+
+  return false;
+}
+
+void STUSB4500_CommandProtocol::handleFrame(void)
+{
+  uint8_t length = _header[2];
+
+  if(length == 0 || (length - 1) % 3 != 0)
+  {
+    uint8_t response[1] = { COMMAND_ERROR_FRAME };
+    sendFrame(_header[1], response, 1);
+    _errorCount++;
+    return;
+  }
+
+  uint8_t response[COMMAND_MAX_PAYLOAD];
+  uint8_t responseLength = execute(&_buffer[1], (length - 1) / 3, _buffer[0], response);
+  sendFrame(_header[1], response, responseLength);
+}
+
+void STUSB4500_CommandProtocol::handleLine(void)
+{
+  uint8_t updates[COMMAND_MAX_PAYLOAD];
+  uint8_t count = 0;
+  uint8_t flags = 0;
+
+  char *token = strtok(_line, " \t");
+  if(token == NULL) return;
+
+  if(strcasecmp(token, "GET") == 0) flags = COMMAND_FLAG_READ;
+  else if(strcasecmp(token, "SET") != 0)
+  {
+    _port->println("ERR unknown command");
+    _errorCount++;
+    return;
+  }
+
+  while((token = strtok(NULL, " \t")) != NULL)
+  {
+    if(strcasecmp(token, "WRITE") == 0)      flags |= COMMAND_FLAG_WRITE;
+    else if(strcasecmp(token, "RESET") == 0) flags |= COMMAND_FLAG_SOFT_RESET;
+    else
+    {
+      char *value = strchr(token, '=');
+      uint8_t id = 0;
+      long number = -1;
+
+      if(value != NULL)
+      {
+        *value++ = 0;
+        for(uint8_t i=0; i<COMMAND_PARAM_COUNT; i++)
+        {
+          if(strcasecmp(token, commandParamText[i].name) == 0) id = i + 1;
+        }
+
+        //Digits only, so a sign or a typo can't wrap into a valid value
+        char *end = value;
+        if(*value >= '0' && *value <= '9') number = strtol(value, &end, 10);
+        if(number >= 0 && *end != 0) number = -1;
+      }
+
+      uint16_t minimum, maximum;
+      if(id == 0 || count >= COMMAND_MAX_PAYLOAD / 3 || number < 0 ||
+         !commandParamRange(id, minimum, maximum) || number / commandParamText[id-1].scale > maximum)
+      {
+        _port->print("ERR parameter ");
+        _port->println(token);
+        _errorCount++;
+        return;
+      }
+
+      number /= commandParamText[id-1].scale;
+      updates[count*3] = id;
+      updates[count*3+1] = number & 0xFF;
+      updates[count*3+2] = number >> 8;
+      count++;
+    }
+  }
+
+  uint8_t response[COMMAND_MAX_PAYLOAD];
+  uint8_t length = execute(updates, count, flags, response);
+
+  if(response[0] == COMMAND_ERROR_PARAM)
+  {
+    //A value below the minimum, e.g. pdos=0
+    _port->print("ERR parameter ");
+    _port->println(commandParamText[updates[response[1]*3]-1].name);
+    return;
+  }
+
+  if(response[0] == COMMAND_ERROR_WRITE) _port->print("ERR write refused");
+  else _port->print("OK");
+
+  _port->print(" applied=");
+  _port->print(response[1]);
+  if(response[2] != COMMAND_NOT_WRITTEN)
+  {
+    _port->print(" write=");
+    _port->print(response[2]);
+  }
+  _port->print(" apply_us=");
+  _port->print((uint32_t)response[3] | ((uint32_t)response[4]<<8) | ((uint32_t)response[5]<<16) | ((uint32_t)response[6]<<24));
+  _port->print(" write_ms=");
+  _port->print((uint32_t)response[7] | ((uint32_t)response[8]<<8) | ((uint32_t)response[9]<<16) | ((uint32_t)response[10]<<24));
+
+  for(uint8_t i=COMMAND_RESPONSE_LENGTH; i+2<length; i+=3)
+  {
+    _port->print(' ');
+    _port->print(commandParamText[response[i]-1].name);
+    _port->print('=');
+    _port->print((uint32_t)(response[i+1] | (response[i+2]<<8)) * commandParamText[response[i]-1].scale);
+  }
+  _port->println();
+}
+
+uint8_t STUSB4500_CommandProtocol::execute(const uint8_t *updates, uint8_t count, uint8_t flags, uint8_t *response)
+{
+  STUSB4500_Config config;
+  uint8_t status = COMMAND_OK;
+  uint8_t applied = 0;
+  uint8_t writeResult = COMMAND_NOT_WRITTEN;
+  uint32_t writeTime = 0;
+
+  _commandCount++;
+
+  //All the changes are staged in one configuration and applied in one pass
+  uint32_t startTime = micros();
+  if(_device->readConfig(config) != 0) status = COMMAND_ERROR_WRITE;
+
+  for(uint8_t i=0; i<count && status == COMMAND_OK; i++)
+  {
+    uint16_t value = updates[i*3+1] | (updates[i*3+2]<<8);
+    if(!commandSetParam(config, updates[i*3], value))
+    {
+      status = COMMAND_ERROR_PARAM;
+      break;
+    }
+    applied++;
+  }
+
+  if(status == COMMAND_OK && count > 0 && _device->writeConfig(config) != 0) status = COMMAND_ERROR_WRITE;
+  uint32_t applyTime = micros() - startTime;
+
+  if(status == COMMAND_OK && (flags & (COMMAND_FLAG_WRITE | COMMAND_FLAG_SOFT_RESET)))
+  {
+    startTime = millis();
+    if(flags & COMMAND_FLAG_WRITE)
+    {
+      writeResult = _device->write();
+      if(writeResult == NVM_WRITE_REFUSED || writeResult == NVM_WRITE_BUS_ERROR) status = COMMAND_ERROR_WRITE;
+    }
+    if(status == COMMAND_OK && (flags & COMMAND_FLAG_SOFT_RESET)) _device->softReset();
+    writeTime = millis() - startTime;
+  }
+
+  if(status != COMMAND_OK) _errorCount++;
+
+  response[0] = status;
+  response[1] = applied;
+  response[2] = writeResult;
+  for(uint8_t i=0; i<4; i++)
+  {
+    response[3+i] = (applyTime >> (8*i)) & 0xFF;
+    response[7+i] = (writeTime >> (8*i)) & 0xFF;
+  }
+  uint8_t length = COMMAND_RESPONSE_LENGTH;
+
+  if(flags & COMMAND_FLAG_READ)
+  {
+    _device->readConfig(config);
+    for(uint8_t id=1; id<=COMMAND_PARAM_COUNT; id++)
+    {
+      uint16_t value = 0;
+      commandGetParam(config, id, value);
+      response[length++] = id;
+      response[length++] = value & 0xFF;
+      response[length++] = value >> 8;
+    }
+  }
+
+  return length;
+}
+
+void STUSB4500_CommandProtocol::sendFrame(uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+  uint8_t frame[COMMAND_HEADER_LENGTH + COMMAND_MAX_PAYLOAD + 1];
+  uint8_t frameLength = commandFrame(frame, sequence, payload, length);
+
+  _port->write(frame, frameLength);
+}
@@ -0,0 +1,79 @@
+/*
+  Serial command protocol for the STUSB4500 Power Delivery Board.
+
+  Lets a PC configure the board over a serial port without rebuilding a sketch.
+  A single request frame carries a batch of parameter changes, which are applied
+  together with one readConfig()/writeConfig(), optionally followed by write()
+  and softReset(). A single response frame returns the result and the timings.
+  The binary frame format is described in stusb4500_command_format.h.
+
+  An optional text mode accepts the same commands typed in a serial monitor:
+    GET
+    SET v2=9000 i2=2000 pdos=2 [WRITE] [RESET]
+  Voltages are in mV and currents in mA. Parameter names: v1-v3, i1-i3, flex,
+  pdos, ovlo1-ovlo3, uvlo1-uvlo3, extpower, usbcomm, okgpio, gpioctrl, above5v,
+  reqsrc. A value outside the range of its parameter is answered with
+  "ERR parameter <name>" and nothing is applied. Binary frames are still
+  accepted in text mode.
+
+  extras/host/tools has a command line client for Linux.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_COMMAND_PROTOCOL_H
+#define STUSB4500_COMMAND_PROTOCOL_H
+
+#include "SparkFun_STUSB4500.h"
+#include "stusb4500_command_format.h"
+
+#define COMMAND_MAX_LINE            96
+
+class STUSB4500_CommandProtocol {
+  public:
+  /*
+    Starts handling commands for a STUSB4500 that has already been started with begin().
+	Parameter: device   - the STUSB4500 to configure.
+	           port     - where the commands come from and the responses go (e.g. Serial).
+	           textMode - also accept text commands.
+  */
+  void begin(STUSB4500 &device, Stream &port, bool textMode = false);
+
+  void setTextMode(bool textMode);
+
+  /*
+    Call from loop(). Reads the available bytes and runs any complete command.
+	Returns true if a command was handled.
+  */
+  bool update(void);
+
+  /*
+    Number of commands handled, and number of frames or lines rejected.
+  */
+  uint32_t getCommandCount(void);
+  uint32_t getErrorCount(void);
+
+  private:
+  STUSB4500 *_device;
+  Stream *_port;
+  bool _textMode;
+  uint8_t _state;
+  uint8_t _header[COMMAND_HEADER_LENGTH];
+  uint8_t _received;
+  uint8_t _buffer[COMMAND_MAX_PAYLOAD];
+  char _line[COMMAND_MAX_LINE];
+  uint8_t _lineLength;
+  uint32_t _commandCount;
+  uint32_t _errorCount;
+
+  bool receive(uint8_t data);
+  void handleFrame(void);
+  void handleLine(void);
+  uint8_t execute(const uint8_t *updates, uint8_t count, uint8_t flags, uint8_t *response);
+  void sendFrame(uint8_t sequence, const uint8_t *payload, uint8_t length);
+};
+
+#endif
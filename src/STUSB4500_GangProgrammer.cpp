@@ -0,0 +1,132 @@
+/*
+  Gang programming of several STUSB4500 Power Delivery Boards.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_GangProgrammer.h"
+
+void STUSB4500_GangProgrammer::begin(const STUSB4500_NvmImage &image, uint8_t options)
+{
+  _image = image;
+  _options = options;
+  _boardCount = 0;
+  _startTime = 0;
+  _endTime = 0;
+  _running = false;
+}
+
+bool STUSB4500_GangProgrammer::addBoard(STUSB4500 &device)
+{
+  if(_boardCount >= GANG_MAX_BOARDS) return false;
+
+  _jobs[_boardCount++].begin(device);
+  return true;
+}
+
+void STUSB4500_GangProgrammer::start(void)
+{
+  for(uint8_t i=0; i<_boardCount; i++) _jobs[i].start(_image, _options);
+
+  _startTime = millis();
+  _running = true;
+}
+
+void STUSB4500_GangProgrammer::start(uint8_t board, const uint8_t image[][8], uint8_t options)
+{
+  if(board >= _boardCount) return;
+
+  _jobs[board].start(image, options);
+
+  //The run starts with its first board
+  if(!_running) _startTime = millis();
+  _running = true;
+}
+
+bool STUSB4500_GangProgrammer::update(void)
+{
+  if(!_running) return false;
+
+  bool running = false;
+  for(uint8_t i=0; i<_boardCount; i++)
+  {
+    //Advance this board until its NVM controller is busy or a write has to settle, then move on
+    while(_jobs[i].step() && !_jobs[i].busy() && !_jobs[i].settling());
+    if(_jobs[i].running()) running = true;
+  }
+
+  if(!running)
+  {
+    _running = false;
+    _endTime = millis();
+  }
+  return running;
+}
+
+uint8_t STUSB4500_GangProgrammer::run(void)
+{
+  start();
+  while(update());
+
+  return getFailedCount();
+}
+
+uint8_t STUSB4500_GangProgrammer::getBoardCount(void)
+{
+  return _boardCount;
+}
+
+uint8_t STUSB4500_GangProgrammer::getResult(uint8_t board)
+{
+  if(board >= _boardCount) return NVM_JOB_IDLE;
+  return _jobs[board].getResult();
+}
+
+uint32_t STUSB4500_GangProgrammer::getBoardTime(uint8_t board)
+{
+  if(board >= _boardCount) return 0;
+  return _jobs[board].getDuration();
+}
+
+STUSB4500_NvmJob &STUSB4500_GangProgrammer::getJob(uint8_t board)
+{
+  return _jobs[board];
+}
+
+uint8_t STUSB4500_GangProgrammer::getProgrammedCount(void)
+{
+  uint8_t count = 0;
+  for(uint8_t i=0; i<_boardCount; i++) if(_jobs[i].getResult() == NVM_JOB_PROGRAMMED) count++;
+  return count;
+}
+
+uint8_t STUSB4500_GangProgrammer::getSkippedCount(void)
+{
+  uint8_t count = 0;
+  for(uint8_t i=0; i<_boardCount; i++) if(_jobs[i].getResult() == NVM_JOB_SKIPPED) count++;
+  return count;
+}
+
+uint8_t STUSB4500_GangProgrammer::getFailedCount(void)
+{
+  uint8_t count = 0;
+  for(uint8_t i=0; i<_boardCount; i++) if(_jobs[i].getResult() >= NVM_JOB_VERIFY_FAILED) count++;
+  return count;
+}
+
+uint32_t STUSB4500_GangProgrammer::getTotalTime(void)
+{
+  if(_running) return millis() - _startTime;
+  return _endTime - _startTime;
+}
+
+float STUSB4500_GangProgrammer::getThroughput(void)
+{
+  uint32_t total = getTotalTime();
+  if(total == 0) return 0;
+
+  return _boardCount * 60000.0 / total;
+}
@@ -0,0 +1,100 @@
+/*
+  Gang programming of several STUSB4500 Power Delivery Boards.
+
+  Programs the same NVM image into up to GANG_MAX_BOARDS boards, on any mix of
+  I2C ports and addresses. Each board runs an STUSB4500_NvmJob and all the jobs
+  are stepped from the same loop: a job is advanced until its NVM controller is
+  busy, or until it has to wait 1ms after a register write, then the next board
+  is served. The erase and program busy times and these pauses, which dominate a
+  write, overlap across every board instead of adding up.
+
+  Boards whose NVM already holds the image are read back and skipped. The time
+  taken by each board and the overall throughput are reported.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_GANG_PROGRAMMER_H
+#define STUSB4500_GANG_PROGRAMMER_H
+
+#include "STUSB4500_NvmJob.h"
+
+#define GANG_MAX_BOARDS             8
+
+class STUSB4500_GangProgrammer {
+  public:
+  /*
+    Sets the image to program and removes all the boards.
+	Parameter: image   - the NVM image, copied into each job.
+	           options - NVM_JOB_COMPARE and/or NVM_JOB_VERIFY.
+  */
+  void begin(const STUSB4500_NvmImage &image, uint8_t options = NVM_JOB_COMPARE | NVM_JOB_VERIFY);
+
+  /*
+    Adds a board that has already been started with begin().
+	Returns false if GANG_MAX_BOARDS boards were already added.
+  */
+  bool addBoard(STUSB4500 &device);
+
+  /*
+    Starts programming every board.
+  */
+  void start(void);
+
+  /*
+    Starts programming one board with its own image instead of the one given to
+	begin(). update() steps it with the other running boards.
+	Parameter: board   - index in the order the boards were added.
+	           image   - the NVM image as 5 x 8 bytes (e.g. the sectors staged by write()).
+	           options - NVM_JOB_COMPARE and/or NVM_JOB_VERIFY.
+  */
+  void start(uint8_t board, const uint8_t image[][8], uint8_t options);
+
+  /*
+    Gives each running board one turn. Returns true while any board is running.
+  */
+  bool update(void);
+
+  /*
+    Calls start() then update() until every board has finished.
+	Returns the number of boards that failed.
+  */
+  uint8_t run(void);
+
+  uint8_t getBoardCount(void);
+
+  /*
+    Result of a board (NVM_JOB_*) and the time it took in milliseconds.
+	Parameter: board - index in the order the boards were added.
+  */
+  uint8_t  getResult(uint8_t board);
+  uint32_t getBoardTime(uint8_t board);
+  STUSB4500_NvmJob &getJob(uint8_t board);
+
+  /*
+    Totals for the last run.
+  */
+  uint8_t  getProgrammedCount(void);
+  uint8_t  getSkippedCount(void);
+  uint8_t  getFailedCount(void);
+  uint32_t getTotalTime(void);
+
+  /*
+    Boards handled per minute over the last run.
+  */
+  float getThroughput(void);
+
+  private:
+  STUSB4500_NvmJob _jobs[GANG_MAX_BOARDS];
+  STUSB4500_NvmImage _image;
+  uint8_t _options;
+  uint8_t _boardCount;
+  uint32_t _startTime;
+  uint32_t _endTime;
+  bool _running;
+};
+
+#endif
@@ -0,0 +1,186 @@
+/*
+  PD negotiation timeline profiler for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_NegotiationProfiler.h"
+
+void STUSB4500_NegotiationProfiler::begin(STUSB4500 &device, uint16_t timeout)
+{
+  _device = &device;
+  _timeout = timeout;
+  _running = false;
+  _eventCount = 0;
+  for(uint8_t i=0; i<4; i++) _milestone[i] = PROFILER_NOT_REACHED;
+  clearStatistics();
+}
+
+void STUSB4500_NegotiationProfiler::start(bool reset)
+{
+  _eventCount = 0;
+  for(uint8_t i=0; i<4; i++) _milestone[i] = PROFILER_NOT_REACHED;
+
+  //Before a soft reset the policy engine is still in PE_SNK_READY from the previous
+  //contract, so milestones only count once it has been seen leaving that state.
+  _armed = !reset;
+
+  //The renegotiation starts with the soft reset, its bus time is part of the time to contract
+  _startTime = micros();
+  if(reset) _device->softReset();
+
+  _running = true;
+}
+
+bool STUSB4500_NegotiationProfiler::update(void)
+{
+  if(!_running) return false;
+
+  uint8_t Buffer[1];
+  _device->I2C_Read_USB_PD(PE_FSM, Buffer, 1);
+  uint32_t now = micros() - _startTime;
+
+  uint8_t state = Buffer[0];
+
+  //Log each state change
+  if(_eventCount == 0 || _eventState[_eventCount-1] != state)
+  {
+    if(_eventCount < PROFILER_MAX_EVENTS)
+    {
+      _eventState[_eventCount] = state;
+      _eventTime[_eventCount] = now;
+      _eventCount++;
+    }
+  }
+
+  if(!_armed)
+  {
+    if(state != PE_SNK_READY) _armed = true;
+  }
+  else if(state >= PE_SNK_EVALUATE_CAPABILITY && state <= PE_SNK_READY)
+  {
+    //A short state can be missed between two samples, in which case it gets
+    //the time of the first later state that was seen.
+    for(uint8_t i=0; i<=state-PE_SNK_EVALUATE_CAPABILITY; i++)
+    {
+      if(_milestone[i] == PROFILER_NOT_REACHED) _milestone[i] = now;
+    }
+
+    if(state == PE_SNK_READY)
+    {
+      finish();
+      return false;
+    }
+  }
+
+  if(now > (uint32_t)_timeout * 1000)
+  {
+    _running = false;
+    _timeouts++;
+    return false;
+  }
+
+  return true;
+}
+
+bool STUSB4500_NegotiationProfiler::run(bool reset)
+{
+  start(reset);
+  while(update());
+
+  return complete();
+}
+
+bool STUSB4500_NegotiationProfiler::running(void)
+{
+  return _running;
+}
+
+bool STUSB4500_NegotiationProfiler::complete(void)
+{
+  return _milestone[3] != PROFILER_NOT_REACHED;
+}
+
+uint32_t STUSB4500_NegotiationProfiler::getPhaseLatency(uint8_t phase)
+{
+  if(phase == PROFILER_PHASE_TOTAL) return _milestone[3];
+  if(phase > PROFILER_PHASE_PS_RDY) return PROFILER_NOT_REACHED;
+  if(_milestone[phase] == PROFILER_NOT_REACHED) return PROFILER_NOT_REACHED;
+
+  if(phase == 0) return _milestone[0];
+  return _milestone[phase] - _milestone[phase-1];
+}
+
+uint8_t STUSB4500_NegotiationProfiler::getEventCount(void)
+{
+  return _eventCount;
+}
+
+uint8_t STUSB4500_NegotiationProfiler::getEventState(uint8_t index)
+{
+  if(index >= _eventCount) return 0;
+  return _eventState[index];
+}
+
+uint32_t STUSB4500_NegotiationProfiler::getEventTime(uint8_t index)
+{
+  if(index >= _eventCount) return PROFILER_NOT_REACHED;
+  return _eventTime[index];
+}
+
+uint16_t STUSB4500_NegotiationProfiler::getRunCount(void)
+{
+  return _runs;
+}
+
+uint16_t STUSB4500_NegotiationProfiler::getTimeoutCount(void)
+{
+  return _timeouts;
+}
+
+uint32_t STUSB4500_NegotiationProfiler::getMinLatency(uint8_t phase)
+{
+  if(phase >= PROFILER_PHASES || _runs == 0) return PROFILER_NOT_REACHED;
+  return _min[phase];
+}
+
+uint32_t STUSB4500_NegotiationProfiler::getAvgLatency(uint8_t phase)
+{
+  if(phase >= PROFILER_PHASES || _runs == 0) return PROFILER_NOT_REACHED;
+  return _sum[phase] / _runs;
+}
+
+uint32_t STUSB4500_NegotiationProfiler::getMaxLatency(uint8_t phase)
+{
+  if(phase >= PROFILER_PHASES || _runs == 0) return PROFILER_NOT_REACHED;
+  return _max[phase];
+}
+
+void STUSB4500_NegotiationProfiler::clearStatistics(void)
+{
+  _runs = 0;
+  _timeouts = 0;
+  for(uint8_t i=0; i<PROFILER_PHASES; i++)
+  {
+    _min[i] = PROFILER_NOT_REACHED;
+    _max[i] = 0;
+    _sum[i] = 0;
+  }
+}
+
+void STUSB4500_NegotiationProfiler::finish(void)
+{
+  _running = false;
+  _runs++;
+
+  for(uint8_t i=0; i<PROFILER_PHASES; i++)
+  {
+    uint32_t latency = getPhaseLatency(i);
+    if(latency < _min[i]) _min[i] = latency;
+    if(latency > _max[i]) _max[i] = latency;
+    _sum[i] += latency;
+  }
+}
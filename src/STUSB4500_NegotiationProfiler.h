@@ -0,0 +1,112 @@
+/*
+  PD negotiation timeline profiler for the STUSB4500 Power Delivery Board.
+
+  Samples the policy engine state (PE_FSM register) after a soft reset or an
+  attach, and timestamps when each step of the negotiation is reached:
+    - Source_Capabilities received (PE_SNK_EVALUATE_CAPABILITY)
+    - Request sent                 (PE_SNK_SELECT_CAPABILITY)
+    - Accept received              (PE_SNK_TRANSITION_SINK)
+    - PS_RDY received              (PE_SNK_READY)
+  Latencies of completed runs are accumulated into min/avg/max statistics.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_NEGOTIATION_PROFILER_H
+#define STUSB4500_NEGOTIATION_PROFILER_H
+
+#include "SparkFun_STUSB4500.h"
+
+#define PROFILER_PHASE_SOURCE_CAPS  0  //Start to Source_Capabilities received
+#define PROFILER_PHASE_REQUEST      1  //Source_Capabilities to Request sent
+#define PROFILER_PHASE_ACCEPT       2  //Request to Accept received
+#define PROFILER_PHASE_PS_RDY       3  //Accept to PS_RDY received
+#define PROFILER_PHASE_TOTAL        4  //Start to PS_RDY (time to contract)
+#define PROFILER_PHASES             5
+
+#define PROFILER_MAX_EVENTS         16
+#define PROFILER_NOT_REACHED        0xFFFFFFFF
+
+class STUSB4500_NegotiationProfiler {
+  public:
+  /*
+    Attaches the profiler to a STUSB4500 that has already been started with begin().
+	Parameter: device  - the STUSB4500 to profile.
+	           timeout - a run that doesn't reach PS_RDY within this many
+	                     milliseconds is abandoned and not added to the statistics.
+  */
+  void begin(STUSB4500 &device, uint16_t timeout = 2000);
+
+  /*
+    Starts a new run.
+	Parameter: reset - true to issue softReset() and time the renegotiation,
+	                   including the softReset() call itself,
+	                   false to time an attach that was just detected.
+  */
+  void start(bool reset = true);
+
+  /*
+    Samples the policy engine state. Call as often as possible while running(),
+	or whenever the ALERT pin is asserted.
+	Returns true while the run is still in progress.
+  */
+  bool update(void);
+
+  /*
+    Calls update() until the run completes or times out.
+	Returns true if PS_RDY was reached.
+  */
+  bool run(bool reset = true);
+
+  bool running(void);
+  bool complete(void);
+
+  /*
+    Returns the duration of one phase of the last run in microseconds (see PROFILER_PHASE_*),
+	or PROFILER_NOT_REACHED if the run didn't get that far.
+  */
+  uint32_t getPhaseLatency(uint8_t phase);
+
+  /*
+    Policy engine states seen during the last run, in order, and when they were
+	first seen (microseconds from the start of the run).
+  */
+  uint8_t  getEventCount(void);
+  uint8_t  getEventState(uint8_t index);
+  uint32_t getEventTime(uint8_t index);
+
+  /*
+    Statistics of the phase latencies (microseconds) across all completed runs.
+  */
+  uint16_t getRunCount(void);
+  uint16_t getTimeoutCount(void);
+  uint32_t getMinLatency(uint8_t phase);
+  uint32_t getAvgLatency(uint8_t phase);
+  uint32_t getMaxLatency(uint8_t phase);
+  void     clearStatistics(void);
+
+  private:
+  STUSB4500 *_device;
+  uint16_t _timeout;
+  uint32_t _startTime;
+  bool _running;
+  bool _armed;
+
+  uint8_t  _eventCount;
+  uint8_t  _eventState[PROFILER_MAX_EVENTS];
+  uint32_t _eventTime[PROFILER_MAX_EVENTS];
+  uint32_t _milestone[4]; //Time each step was reached, from the start of the run
+
+  uint16_t _runs;
+  uint16_t _timeouts;
+  uint32_t _min[PROFILER_PHASES];
+  uint32_t _max[PROFILER_PHASES];
+  uint32_t _sum[PROFILER_PHASES];
+
+  void finish(void);
+};
+
+#endif
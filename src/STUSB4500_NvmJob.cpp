@@ -0,0 +1,334 @@
+/*
+  Non-blocking NVM programming for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_NvmJob.h"
+
+//Each phase is a list of single I2C transactions, the same sequences as
+//read(), CUST_EnterWriteMode(), CUST_WriteSector() and CUST_ExitTestMode()
+#define OP_SET            0  //Write value to reg
+#define OP_SET_SECTOR     1  //Write value | current sector to reg
+#define OP_SET_SER        2  //Write value | erase mask to reg
+#define OP_POLL           3  //Read FTP_CTRL_0 until FTP_CUST_REQ is cleared
+#define OP_READ_DATA      4  //Read RW_BUFFER into the current sector
+#define OP_WRITE_DATA     5  //Write the current sector to RW_BUFFER
+
+#define PHASE_READ_BEGIN  0
+#define PHASE_READ_SECTOR 1
+#define PHASE_READ_EXIT   2
+#define PHASE_ERASE       3
+#define PHASE_PROGRAM     4
+#define PHASE_EXIT        5
+#define PHASE_VERIFY      0x80 //Set on the read phases after programming
+
+#define PWR_RST           (FTP_CUST_PWR | FTP_CUST_RST_N)
+
+struct NvmJobOp {
+  uint8_t type;
+  uint8_t reg;
+  uint8_t value;
+};
+
+static const NvmJobOp readBegin[] = {
+  {OP_SET,        FTP_CUST_PASSWORD_REG, FTP_CUST_PASSWORD},
+  {OP_SET,        FTP_CTRL_0,            0},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST},
+};
+
+static const NvmJobOp readSector[] = {
+  {OP_SET,        FTP_CTRL_0,            PWR_RST},
+  {OP_SET,        FTP_CTRL_1,            READ & FTP_CUST_OPCODE},
+  {OP_SET_SECTOR, FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+  {OP_READ_DATA,  RW_BUFFER,             0},
+};
+
+static const NvmJobOp exitTestMode[] = {
+  {OP_SET,        FTP_CTRL_0,            FTP_CUST_RST_N},
+  {OP_SET,        FTP_CUST_PASSWORD_REG, 0},
+};
+
+static const NvmJobOp erase[] = {
+  {OP_SET,        FTP_CUST_PASSWORD_REG, FTP_CUST_PASSWORD},
+  {OP_SET,        RW_BUFFER,             0},
+  {OP_SET,        FTP_CTRL_0,            0},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST},
+  {OP_SET_SER,    FTP_CTRL_1,            WRITE_SER & FTP_CUST_OPCODE},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+  {OP_SET,        FTP_CTRL_1,            SOFT_PROG_SECTOR & FTP_CUST_OPCODE},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+  {OP_SET,        FTP_CTRL_1,            ERASE_SECTOR & FTP_CUST_OPCODE},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+};
+
+static const NvmJobOp program[] = {
+  {OP_WRITE_DATA, RW_BUFFER,             0},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST},
+  {OP_SET,        FTP_CTRL_1,            WRITE_PL & FTP_CUST_OPCODE},
+  {OP_SET,        FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+  {OP_SET,        FTP_CTRL_1,            PROG_SECTOR & FTP_CUST_OPCODE},
+  {OP_SET_SECTOR, FTP_CTRL_0,            PWR_RST | FTP_CUST_REQ},
+  {OP_POLL,       FTP_CTRL_0,            0},
+};
+
+static const NvmJobOp *const phaseOps[] = { readBegin, readSector, exitTestMode, erase, program, exitTestMode };
+static const uint8_t phaseLength[] = {
+  sizeof(readBegin)/sizeof(NvmJobOp), sizeof(readSector)/sizeof(NvmJobOp), sizeof(exitTestMode)/sizeof(NvmJobOp),
+  sizeof(erase)/sizeof(NvmJobOp), sizeof(program)/sizeof(NvmJobOp), sizeof(exitTestMode)/sizeof(NvmJobOp)
+};
+
+void STUSB4500_NvmJob::begin(STUSB4500 &device, uint16_t timeout)
+{
+  _device = &device;
+  _timeout = timeout;
+  _result = NVM_JOB_IDLE;
+  _busy = false;
+  _settling = false;
+  _eraseMask = 0;
+  _busyPolls = 0;
+  _startTime = 0;
+  _endTime = 0;
+}
+
+void STUSB4500_NvmJob::start(const STUSB4500_NvmImage &image, uint8_t options)
+{
+  uint8_t bytes[5][8];
+  image.toBytes(bytes);
+
+  start(bytes, options);
+}
+
+void STUSB4500_NvmJob::start(const uint8_t image[][8], uint8_t options)
+{
+  memcpy(_image, image, sizeof(_image));
+
+  _options = options;
+  _result = NVM_JOB_RUNNING;
+  _busy = false;
+  _busyPolls = 0;
+  _startTime = millis();
+
+  if(_options & NVM_JOB_COMPARE)
+  {
+    enterPhase(PHASE_READ_BEGIN);
+  }
+  else
+  {
+    _eraseMask = SECTOR_0 | SECTOR_1 | SECTOR_2 | SECTOR_3 | SECTOR_4;
+    enterPhase(PHASE_ERASE);
+  }
+}
+
+bool STUSB4500_NvmJob::step(void)
+{
+  if(_result != NVM_JOB_RUNNING) return false;
+
+  settle();
+
+  const NvmJobOp &op = phaseOps[_phase & ~PHASE_VERIFY][_op];
+  uint8_t Buffer[1];
+  uint8_t error = 0;
+
+  _busy = false;
+
+  switch(op.type)
+  {
+    case OP_SET:
+      Buffer[0] = op.value;
+      error = _device->I2C_Write_USB_PD(op.reg, Buffer, 1, false);
+      _settling = true;
+      break;
+
+    case OP_SET_SECTOR:
+      Buffer[0] = op.value | (_sector & FTP_CUST_SECT);
+      error = _device->I2C_Write_USB_PD(op.reg, Buffer, 1, false);
+      _settling = true;
+      break;
+
+    case OP_SET_SER:
+      Buffer[0] = op.value | ((_eraseMask << 3) & FTP_CUST_SER);
+      error = _device->I2C_Write_USB_PD(op.reg, Buffer, 1, false);
+      _settling = true;
+      break;
+
+    case OP_POLL:
+      error = _device->I2C_Read_USB_PD(op.reg, Buffer, 1);
+      if(error == 0 && (Buffer[0] & FTP_CUST_REQ))
+      {
+        _busy = true;
+        _busyPolls++;
+        if(millis() - _opStartTime > _timeout)
+        {
+          _device->CUST_ExitTestMode();
+          finish(NVM_JOB_TIMEOUT);
+          return false;
+        }
+        return true;
+      }
+      break;
+
+    case OP_READ_DATA:
+      error = _device->I2C_Read_USB_PD(op.reg, _readBack[_sector], 8);
+      break;
+
+    case OP_WRITE_DATA:
+      error = _device->I2C_Write_USB_PD(op.reg, _image[_sector], 8, false);
+      _settling = true;
+      break;
+  }
+  if(_settling) _writeTime = micros();
+
+  if(error != 0)
+  {
+    _device->CUST_ExitTestMode();
+    finish(NVM_JOB_BUS_ERROR);
+    return false;
+  }
+
+  _opStartTime = millis();
+  if(++_op >= phaseLength[_phase & ~PHASE_VERIFY]) nextPhase();
+
+  return _result == NVM_JOB_RUNNING;
+}
+
+bool STUSB4500_NvmJob::busy(void)
+{
+  return _busy;
+}
+
+bool STUSB4500_NvmJob::settling(void)
+{
+  return _settling && micros() - _writeTime < 1000;
+}
+
+bool STUSB4500_NvmJob::running(void)
+{
+  return _result == NVM_JOB_RUNNING;
+}
+
+uint8_t STUSB4500_NvmJob::getResult(void)
+{
+  return _result;
+}
+
+uint8_t STUSB4500_NvmJob::getProgrammedSectors(void)
+{
+  return _result == NVM_JOB_SKIPPED ? 0 : _eraseMask;
+}
+
+uint32_t STUSB4500_NvmJob::getDuration(void)
+{
+  if(_result == NVM_JOB_RUNNING) return millis() - _startTime;
+  return _endTime - _startTime;
+}
+
+uint16_t STUSB4500_NvmJob::getBusyPolls(void)
+{
+  return _busyPolls;
+}
+
+STUSB4500 *STUSB4500_NvmJob::getDevice(void)
+{
+  return _device;
+}
+
+void STUSB4500_NvmJob::enterPhase(uint8_t phase)
+{
+  _phase = phase;
+  _op = 0;
+  _opStartTime = millis();
+}
+
+void STUSB4500_NvmJob::nextPhase(void)
+{
+  bool verifying = _phase & PHASE_VERIFY;
+
+  switch(_phase & ~PHASE_VERIFY)
+  {
+    case PHASE_READ_BEGIN:
+      _sector = 0;
+      enterPhase(PHASE_READ_SECTOR | (_phase & PHASE_VERIFY));
+      break;
+
+    case PHASE_READ_SECTOR:
+      if(++_sector < 5) enterPhase(_phase);
+      else enterPhase(PHASE_READ_EXIT | (_phase & PHASE_VERIFY));
+      break;
+
+    case PHASE_READ_EXIT:
+    {
+      uint8_t mask = nvmSectorDiff(_readBack, _image);
+      if(verifying)
+      {
+        finish(mask == 0 ? NVM_JOB_PROGRAMMED : NVM_JOB_VERIFY_FAILED);
+      }
+      else if(mask == 0)
+      {
+        _eraseMask = 0;
+        finish(NVM_JOB_SKIPPED);
+      }
+      else
+      {
+        _eraseMask = mask;
+        enterPhase(PHASE_ERASE);
+      }
+      break;
+    }
+
+    case PHASE_ERASE:
+      _sector = nextSector(0);
+      enterPhase(PHASE_PROGRAM);
+      break;
+
+    case PHASE_PROGRAM:
+      _sector = nextSector(_sector + 1);
+      if(_sector < 5) enterPhase(PHASE_PROGRAM);
+      else enterPhase(PHASE_EXIT);
+      break;
+
+    case PHASE_EXIT:
+      if(_options & NVM_JOB_VERIFY) enterPhase(PHASE_READ_BEGIN | PHASE_VERIFY);
+      else finish(NVM_JOB_PROGRAMMED);
+      break;
+  }
+}
+
+void STUSB4500_NvmJob::finish(uint8_t result)
+{
+  settle();
+  _result = result;
+  _busy = false;
+  _endTime = millis();
+
+  //Keep the cached image in step with the NVM
+  if(result == NVM_JOB_PROGRAMMED || result == NVM_JOB_SKIPPED)
+  {
+    memcpy(_device->sector, _image, sizeof(_image));
+    _device->_dirtySectors = 0;
+  }
+}
+
+//Waits for what is left of the 1ms after the last register write
+void STUSB4500_NvmJob::settle(void)
+{
+  if(!_settling) return;
+
+  uint32_t elapsed = micros() - _writeTime;
+  if(elapsed < 1000) delayMicroseconds(1000 - elapsed);
+  _settling = false;
+}
+
+uint8_t STUSB4500_NvmJob::nextSector(uint8_t from)
+{
+  while(from < 5 && (_eraseMask & (1<<from)) == 0) from++;
+  return from;
+}
@@ -0,0 +1,135 @@
+/*
+  Non-blocking NVM programming for the STUSB4500 Power Delivery Board.
+
+  write() issues each NVM opcode and then waits for the controller to clear
+  FTP_CUST_REQ, so most of its time is spent with the bus idle. An
+  STUSB4500_NvmJob runs the same read / erase / program sequence one I2C
+  transaction per step() call. While the NVM controller is busy, step() makes a
+  single status read and returns with busy() set, so the caller can drive other
+  devices in the meantime. The 1ms pause write() makes after each register write
+  is only waited for, if still needed, at the next step(): the transactions of
+  the other devices usually cover it.
+
+  A job can read the NVM first and skip the programming when it already holds
+  the image, erases only the sectors that differ, and can read the result back
+  to verify it.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_NVM_JOB_H
+#define STUSB4500_NVM_JOB_H
+
+#include "SparkFun_STUSB4500.h"
+
+//Results returned by getResult()
+#define NVM_JOB_IDLE                0
+#define NVM_JOB_RUNNING             1
+#define NVM_JOB_PROGRAMMED          2
+#define NVM_JOB_SKIPPED             3  //The NVM already held the image
+#define NVM_JOB_VERIFY_FAILED       4
+#define NVM_JOB_BUS_ERROR           5
+#define NVM_JOB_TIMEOUT             6
+
+//Options for start()
+#define NVM_JOB_COMPARE             0x01  //Read the NVM first, skip if it matches and only erase changed sectors
+#define NVM_JOB_VERIFY              0x02  //Read the NVM back after programming
+
+class STUSB4500_NvmJob {
+  public:
+  /*
+    Prepares a job for a STUSB4500 that has already been started with begin().
+	Parameter: device  - the STUSB4500 to program.
+	           timeout - a single NVM operation that takes longer than this many
+	                     milliseconds fails the job.
+  */
+  void begin(STUSB4500 &device, uint16_t timeout = 2000);
+
+  /*
+    Starts programming an image. The image is copied.
+	Parameter: image   - the NVM image to program.
+	           options - NVM_JOB_COMPARE and/or NVM_JOB_VERIFY.
+  */
+  void start(const STUSB4500_NvmImage &image, uint8_t options = NVM_JOB_COMPARE | NVM_JOB_VERIFY);
+
+  /*
+    Same as above, with the image as 5 x 8 bytes (e.g. the sectors staged by write()).
+  */
+  void start(const uint8_t image[][8], uint8_t options = NVM_JOB_COMPARE | NVM_JOB_VERIFY);
+
+  /*
+    Makes one I2C transaction. Returns true while the job is still running.
+  */
+  bool step(void);
+
+  /*
+    True when the last step() found the NVM controller busy. Calling step() again
+	straight away only repeats the status read.
+  */
+  bool busy(void);
+
+  /*
+    True until 1ms has passed since the last register write. The next step()
+	waits for the rest of it, so a caller driving other devices serves them first.
+  */
+  bool settling(void);
+
+  /*
+    True while the job is running.
+  */
+  bool running(void);
+
+  /*
+    Returns NVM_JOB_*.
+  */
+  uint8_t getResult(void);
+
+  /*
+    Sectors that were erased and programmed, bit 0 = sector 0.
+  */
+  uint8_t getProgrammedSectors(void);
+
+  /*
+    Time from start() to the end of the job, in milliseconds. While running, the
+	time elapsed so far.
+  */
+  uint32_t getDuration(void);
+
+  /*
+    Number of status reads that found the NVM controller busy.
+  */
+  uint16_t getBusyPolls(void);
+
+  STUSB4500 *getDevice(void);
+
+  private:
+  STUSB4500 *_device;
+  uint8_t _image[5][8];
+  uint8_t _readBack[5][8];
+  uint8_t _options;
+  uint8_t _result;
+  uint8_t _phase;
+  uint8_t _op;
+  uint8_t _sector;
+  uint8_t _eraseMask;
+  bool _busy;
+  bool _settling;
+  uint16_t _timeout;
+  uint16_t _busyPolls;
+  uint32_t _startTime;
+  uint32_t _endTime;
+  uint32_t _opStartTime;
+  uint32_t _writeTime;      //micros() at the end of the last register write
+
+  void settle(void);
+
+  void enterPhase(uint8_t phase);
+  void nextPhase(void);
+  void finish(uint8_t result);
+  uint8_t nextSector(uint8_t from);
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+  Interleaved NVM writes for several STUSB4500s on the same I2C bus.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_NvmScheduler.h"
+
+void STUSB4500_NvmScheduler::begin(void)
+{
+  //Each device is started with its own staged sectors, the gang image is not used
+  _gang.begin(STUSB4500_NvmImage::defaults(), 0);
+  _startTime = 0;
+  _endTime = 0;
+  _running = false;
+}
+
+bool STUSB4500_NvmScheduler::addDevice(STUSB4500 &device)
+{
+  if(_gang.getBoardCount() >= NVM_SCHEDULER_MAX_DEVICES) return false;
+
+  _writeResult[_gang.getBoardCount()] = NVM_WRITE_OK;
+  return _gang.addBoard(device);
+}
+
+void STUSB4500_NvmScheduler::start(uint8_t options)
+{
+  _startTime = millis();
+
+  for(uint8_t i=0; i<_gang.getBoardCount(); i++)
+  {
+    STUSB4500_NvmJob &job = _gang.getJob(i);
+    STUSB4500 *device = job.getDevice();
+
+    //Same preparation as write(): copy the volatile PDOs into the NVM image
+    _writeResult[i] = device->stageWrite();
+
+    if(_writeResult[i] == NVM_WRITE_REFUSED || _writeResult[i] == NVM_WRITE_BUS_ERROR) job.begin(*device);
+    else _gang.start(i, device->sector, options);
+  }
+
+  _running = true;
+}
+
+bool STUSB4500_NvmScheduler::update(void)
+{
+  if(!_running) return false;
+
+  if(_gang.update()) return true;
+
+  _running = false;
+  _endTime = millis();
+  return false;
+}
+
+uint8_t STUSB4500_NvmScheduler::write(uint8_t options)
+{
+  start(options);
+  while(update());
+
+  uint8_t failed = 0;
+  for(uint8_t i=0; i<_gang.getBoardCount(); i++)
+  {
+    if(_writeResult[i] == NVM_WRITE_REFUSED || _writeResult[i] == NVM_WRITE_BUS_ERROR ||
+       _gang.getResult(i) >= NVM_JOB_VERIFY_FAILED) failed++;
+  }
+  return failed;
+}
+
+uint8_t STUSB4500_NvmScheduler::getDeviceCount(void)
+{
+  return _gang.getBoardCount();
+}
+
+uint8_t STUSB4500_NvmScheduler::getWriteResult(uint8_t device)
+{
+  if(device >= _gang.getBoardCount()) return NVM_WRITE_REFUSED;
+  return _writeResult[device];
+}
+
+uint8_t STUSB4500_NvmScheduler::getResult(uint8_t device)
+{
+  return _gang.getResult(device);
+}
+
+uint32_t STUSB4500_NvmScheduler::getDeviceTime(uint8_t device)
+{
+  return _gang.getBoardTime(device);
+}
+
+uint32_t STUSB4500_NvmScheduler::getTotalTime(void)
+{
+  if(_running) return millis() - _startTime;
+  return _endTime - _startTime;
+}
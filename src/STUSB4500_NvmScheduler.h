@@ -0,0 +1,83 @@
+/*
+  Interleaved NVM writes for several STUSB4500s on the same I2C bus.
+
+  Calling write() on each board in turn leaves the bus idle while every chip's
+  NVM controller erases and programs. STUSB4500_NvmScheduler commits the
+  pending configuration of all its devices at once: each device runs its write()
+  sequence as an STUSB4500_NvmJob of an STUSB4500_GangProgrammer, which advances
+  a device until its NVM controller is busy and then serves the next one. The
+  next opcode is sent to one device while the others still have FTP_CUST_REQ
+  set, so N devices take about as long as one, plus the extra bus traffic.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_NVM_SCHEDULER_H
+#define STUSB4500_NVM_SCHEDULER_H
+
+#include "STUSB4500_GangProgrammer.h"
+
+#define NVM_SCHEDULER_MAX_DEVICES   4  //Addresses 0x28-0x2B
+
+class STUSB4500_NvmScheduler {
+  public:
+  /*
+    Removes all the devices.
+  */
+  void begin(void);
+
+  /*
+    Adds a device that has already been started with begin().
+	Returns false if NVM_SCHEDULER_MAX_DEVICES devices were already added.
+  */
+  bool addDevice(STUSB4500 &device);
+
+  /*
+    Starts writing the pending configuration of every device, like write().
+	Devices whose configuration fails validation are not written.
+	Parameter: options - NVM_JOB_COMPARE and/or NVM_JOB_VERIFY. With no options
+	                     all five sectors are erased and programmed, as write() does.
+  */
+  void start(uint8_t options = 0);
+
+  /*
+    Gives each device that is still writing one turn, until its NVM controller is busy.
+	Returns true while any device is writing.
+  */
+  bool update(void);
+
+  /*
+    Calls start() then update() until every device has finished.
+	Returns the number of devices that were refused or failed.
+  */
+  uint8_t write(uint8_t options = 0);
+
+  uint8_t getDeviceCount(void);
+
+  /*
+    Result of the validation done before writing (NVM_WRITE_*), the result of
+	the programming (NVM_JOB_*, NVM_JOB_IDLE if it was refused) and the time it
+	took in milliseconds.
+	Parameter: device - index in the order the devices were added.
+  */
+  uint8_t  getWriteResult(uint8_t device);
+  uint8_t  getResult(uint8_t device);
+  uint32_t getDeviceTime(uint8_t device);
+
+  /*
+    Time taken by the last write for all the devices, in milliseconds.
+  */
+  uint32_t getTotalTime(void);
+
+  private:
+  STUSB4500_GangProgrammer _gang;
+  uint8_t _writeResult[NVM_SCHEDULER_MAX_DEVICES];
+  uint32_t _startTime;
+  uint32_t _endTime;
+  bool _running;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+  Available power tracking for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_PowerBudget.h"
+
+void STUSB4500_PowerBudget::begin(STUSB4500 &device)
+{
+  _device = &device;
+  _power = 0;
+  _voltage = 0;
+  _current = 0;
+  _source = POWER_SOURCE_NONE;
+  _known = true;
+  _thresholdPower = 0;
+  _ccStatus = 0;
+  _thresholdCount = 0;
+  _recomputeCount = 0;
+  _sourcePdoCount = 0;
+
+  refresh();
+}
+
+bool STUSB4500_PowerBudget::update(const STUSB4500_Status &status)
+{
+  if(status.messageReceived()) readCapabilities();
+
+  if((status.alertStatus() & POWER_BUDGET_EVENTS) == 0 && !status.attachTransition() &&
+     status.reg[CC_STATUS - ALERT_STATUS_1] == _ccStatus) return false;
+
+  return recompute(status);
+}
+
+bool STUSB4500_PowerBudget::refresh(void)
+{
+  STUSB4500_Status status;
+  _device->peekStatus(status);
+  readCapabilities();
+
+  return recompute(status);
+}
+
+uint32_t STUSB4500_PowerBudget::getPower(void)
+{
+  return _power;
+}
+
+uint16_t STUSB4500_PowerBudget::getVoltage(void)
+{
+  return _voltage;
+}
+
+uint16_t STUSB4500_PowerBudget::getCurrent(void)
+{
+  return _current;
+}
+
+bool STUSB4500_PowerBudget::isKnown(void)
+{
+  return _known;
+}
+
+uint8_t STUSB4500_PowerBudget::getSource(void)
+{
+  return _source;
+}
+
+bool STUSB4500_PowerBudget::addThreshold(uint32_t threshold, STUSB4500_PowerCallback callback)
+{
+  if(_thresholdCount >= POWER_BUDGET_MAX_THRESHOLDS) return false;
+
+  _threshold[_thresholdCount] = threshold;
+  _callback[_thresholdCount] = callback;
+  _thresholdCount++;
+  return true;
+}
+
+uint32_t STUSB4500_PowerBudget::getRecomputeCount(void)
+{
+  return _recomputeCount;
+}
+
+uint8_t STUSB4500_PowerBudget::getSourcePdoCount(void)
+{
+  return _sourcePdoCount;
+}
+
+void STUSB4500_PowerBudget::readCapabilities(void)
+{
+  //Later messages (Accept, PS_RDY, ...) replace the header, keep the PDOs seen last
+  uint8_t header[2];
+  if(_device->I2C_Read_USB_PD(RX_HEADER, header, 2) != 0) return;
+
+  uint8_t objects = (header[1]>>4) & 0x07;
+  if((header[0] & 0x1F) != PD_SOURCE_CAPABILITIES || objects == 0) return;
+
+  uint8_t Buffer[RX_MAX_DATA_OBJECTS * 4];
+  if(_device->I2C_Read_USB_PD(RX_DATA_OBJ, Buffer, objects * 4) != 0) return;
+
+  for(uint8_t i=0; i<objects; i++)
+  {
+    _sourcePdo[i] = (uint32_t)Buffer[i*4] | ((uint32_t)Buffer[i*4+1]<<8) |
+                    ((uint32_t)Buffer[i*4+2]<<16) | ((uint32_t)Buffer[i*4+3]<<24);
+  }
+  _sourcePdoCount = objects;
+}
+
+bool STUSB4500_PowerBudget::recompute(const STUSB4500_Status &status)
+{
+  uint32_t previous = _power;
+  bool wasKnown = _known;
+
+  _recomputeCount++;
+  _known = true;
+  _ccStatus = status.reg[CC_STATUS - ALERT_STATUS_1];
+
+  if(!status.attached())
+  {
+    //The next source sends its own capabilities
+    _sourcePdoCount = 0;
+    _source = POWER_SOURCE_NONE;
+    _voltage = 0;
+    _current = 0;
+  }
+  else
+  {
+    uint8_t Buffer[4];
+    uint32_t rdo = 0;
+    if(_device->I2C_Read_USB_PD(RDO_REG_STATUS, Buffer, 4) == 0)
+    {
+      rdo = (uint32_t)Buffer[0] | ((uint32_t)Buffer[1]<<8) | ((uint32_t)Buffer[2]<<16) | ((uint32_t)Buffer[3]<<24);
+    }
+    uint8_t position = (rdo>>28) & 0x07; //Object position, 0 if there is no contract
+
+    if(position != 0)
+    {
+      _source = POWER_SOURCE_PD;
+      _current = ((rdo>>10) & 0x3FF) * 10; //Operating current, 10mA units
+
+      //The position indexes the source's PDOs. The first one is always the 5V fixed supply,
+      //the others are only known from the Source_Capabilities (fixed supplies: bits 31:30 = 00).
+      if(position == 1) _voltage = 5000;
+      else if(position <= _sourcePdoCount && (_sourcePdo[position-1] >> 30) == 0)
+      {
+        _voltage = ((_sourcePdo[position-1]>>10) & 0x3FF) * 50;
+      }
+      else
+      {
+        _voltage = 0;
+        _known = false;
+      }
+    }
+    else
+    {
+      //Type-C advertisement seen on the active CC line: 1 = Default USB, 2 = 1.5A, 3 = 3.0A
+      uint8_t advertisement = status.cc1State() > status.cc2State() ? status.cc1State() : status.cc2State();
+
+      _source = POWER_SOURCE_TYPEC;
+      _voltage = 5000;
+      _current = advertisement == 3 ? 3000 : advertisement == 2 ? 1500 : advertisement == 1 ? 500 : 0;
+    }
+  }
+
+  _power = (uint32_t)_voltage * _current / 1000;
+
+  //An unknown voltage is not a power drop: wait until it is known again
+  if(!_known) return wasKnown || _power != previous;
+
+  for(uint8_t i=0; i<_thresholdCount; i++)
+  {
+    bool above = _power >= _threshold[i];
+    if(above != (_thresholdPower >= _threshold[i])) _callback[i](_power, above);
+  }
+  _thresholdPower = _power;
+
+  return _power != previous || !wasKnown;
+}
@@ -0,0 +1,119 @@
+/*
+  Available power tracking for the STUSB4500 Power Delivery Board.
+
+  Computes the power available from the source and keeps it cached:
+    - With a PD contract, from the RDO sent by the STUSB4500 (RDO_REG_STATUS):
+      the operating current it requested, and the voltage of the source PDO at
+      the object position of the RDO. The source PDOs are taken from the last
+      Source_Capabilities message in the RX buffer, which is read when a status
+      reports a received message. If they were not seen, e.g. when begin() is
+      called during a contract, the power is unknown (see isKnown()) except for
+      position 1 which is always 5V.
+    - Without PD, from the Type-C current advertised on CC (Default USB = 500mA,
+      1.5A or 3.0A) at 5V.
+    - Nothing attached, 0.
+  The value is only recomputed when a status snapshot reports an event that can
+  change the contract (attach/detach, CC change, PD message, hard reset, VBUS),
+  so it can be fed from STUSB4500_Supervisor at no extra bus cost when nothing
+  happens. Threshold callbacks are run from the same call, so loads can be shed
+  as soon as the event is handled. They are not run while the power is unknown.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_POWER_BUDGET_H
+#define STUSB4500_POWER_BUDGET_H
+
+#include "SparkFun_STUSB4500.h"
+
+#define POWER_SOURCE_NONE           0  //Nothing attached
+#define POWER_SOURCE_TYPEC          1  //Type-C current advertisement at 5V
+#define POWER_SOURCE_PD             2  //Negotiated PD contract
+
+#define POWER_BUDGET_MAX_THRESHOLDS 4
+
+//Alert events that can change the contract
+#define POWER_BUDGET_EVENTS         (ALERT_CC_DETECTION_STATUS | ALERT_PRT_STATUS | ALERT_HARD_RESET | \
+                                     ALERT_MONITORING_STATUS)
+
+/*
+  Called when the available power crosses a threshold.
+  Parameter: power - the new available power in milliwatts.
+             above - true if it rose to or above the threshold, false if it fell below.
+*/
+typedef void (*STUSB4500_PowerCallback)(uint32_t power, bool above);
+
+class STUSB4500_PowerBudget {
+  public:
+  /*
+    Attaches to a STUSB4500 that has already been started with begin() and
+	computes the available power.
+  */
+  void begin(STUSB4500 &device);
+
+  /*
+    Recomputes the available power if status reports a contract event, e.g. with
+	the status of STUSB4500_Supervisor after a wake up.
+	Returns true if the available power changed, or became known or unknown.
+  */
+  bool update(const STUSB4500_Status &status);
+
+  /*
+    Reads the status and recomputes the available power unconditionally.
+	Returns true if the available power changed, or became known or unknown.
+  */
+  bool refresh(void);
+
+  /*
+    Cached values: power in milliwatts, voltage in millivolts, current in milliamps,
+	and where they come from (POWER_SOURCE_*). With a PD contract whose voltage is
+	unknown (see above), isKnown() returns false and the voltage and the power are 0.
+  */
+  bool isKnown(void);
+  uint32_t getPower(void);
+  uint16_t getVoltage(void);
+  uint16_t getCurrent(void);
+  uint8_t  getSource(void);
+
+  /*
+    Calls callback each time the available power crosses threshold.
+	Parameter: threshold - in milliwatts.
+	Returns false if POWER_BUDGET_MAX_THRESHOLDS thresholds were already added.
+  */
+  bool addThreshold(uint32_t threshold, STUSB4500_PowerCallback callback);
+
+  /*
+    Number of times the contract was read and the power recomputed.
+  */
+  uint32_t getRecomputeCount(void);
+
+  /*
+    Source PDOs from the last Source_Capabilities message, 0 if none was seen since
+	the source was attached.
+  */
+  uint8_t getSourcePdoCount(void);
+
+  private:
+  STUSB4500 *_device;
+  uint32_t _power;
+  uint16_t _voltage;
+  uint16_t _current;
+  uint8_t _source;
+  bool _known;
+  uint32_t _thresholdPower; //Last known power, the thresholds are crossed from it
+  uint8_t _ccStatus;
+  uint8_t _thresholdCount;
+  uint32_t _threshold[POWER_BUDGET_MAX_THRESHOLDS];
+  STUSB4500_PowerCallback _callback[POWER_BUDGET_MAX_THRESHOLDS];
+  uint32_t _recomputeCount;
+  uint32_t _sourcePdo[RX_MAX_DATA_OBJECTS];
+  uint8_t _sourcePdoCount;
+
+  void readCapabilities(void);
+  bool recompute(const STUSB4500_Status &status);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+  Runtime PDO profiles for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_ProfileTable.h"
+
+void STUSB4500_ProfileTable::begin(STUSB4500 &device)
+{
+  _device = &device;
+  _profileCount = 0;
+  _activeProfile = -1;
+  _switchTime = 0;
+  _switchCount = 0;
+}
+
+int8_t STUSB4500_ProfileTable::addProfile(const STUSB4500_Config &config)
+{
+  if(_profileCount >= PROFILE_TABLE_MAX_PROFILES) return -1;
+
+  STUSB4500_Profile &profile = _profile[_profileCount];
+  if(_device->I2C_Read_USB_PD(DPM_SNK_PDO1, profile.pdo, 12) != 0) return -1;
+  config.encodePdos(profile.pdo);
+  profile.pdoNumber = config.pdoNumber > 3 ? 3 : config.pdoNumber;
+
+  return _profileCount++;
+}
+
+int8_t STUSB4500_ProfileTable::addProfile(float voltage, float current)
+{
+  STUSB4500_Config config;
+  if(_device->readConfig(config) != 0) return -1;
+
+  //Same limits as setVoltage() and setCurrent()
+  if(voltage < 5) voltage = 5;
+  else if(voltage > 20) voltage = 20;
+  if(current < 0) current = 0;
+  else if(current > 5) current = 5;
+
+  if(voltage == 5)
+  {
+    config.current[0] = current * 100 + 0.5;
+    config.pdoNumber = 1;
+  }
+  else
+  {
+    config.voltage[1] = voltage * 20 + 0.5;
+    config.current[1] = current * 100 + 0.5;
+    config.pdoNumber = 2;
+  }
+
+  return addProfile(config);
+}
+
+int8_t STUSB4500_ProfileTable::captureProfile(void)
+{
+  if(_profileCount >= PROFILE_TABLE_MAX_PROFILES) return -1;
+
+  STUSB4500_Profile &profile = _profile[_profileCount];
+  _device->I2C_Read_USB_PD(DPM_SNK_PDO1, profile.pdo, 12);
+  _device->I2C_Read_USB_PD(DPM_PDO_NUMB, &profile.pdoNumber, 1);
+
+  return _profileCount++;
+}
+
+bool STUSB4500_ProfileTable::switchProfile(uint8_t index, bool renegotiate)
+{
+  if(index >= _profileCount) return false;
+
+  uint32_t startTime = micros();
+
+  if(_device->writePdoRegisters(_profile[index].pdo, _profile[index].pdoNumber) != 0) return false;
+  if(renegotiate) _device->softReset();
+
+  _switchTime = micros() - startTime;
+  _switchCount++;
+  _activeProfile = index;
+  return true;
+}
+
+int8_t STUSB4500_ProfileTable::getActiveProfile(void)
+{
+  return _activeProfile;
+}
+
+uint8_t STUSB4500_ProfileTable::getProfileCount(void)
+{
+  return _profileCount;
+}
+
+const STUSB4500_Profile &STUSB4500_ProfileTable::getProfile(uint8_t index)
+{
+  return _profile[index];
+}
+
+uint32_t STUSB4500_ProfileTable::getSwitchTime(void)
+{
+  return _switchTime;
+}
+
+uint32_t STUSB4500_ProfileTable::getSwitchCount(void)
+{
+  return _switchCount;
+}
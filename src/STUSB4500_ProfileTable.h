@@ -0,0 +1,95 @@
+/*
+  Runtime PDO profiles for the STUSB4500 Power Delivery Board.
+
+  Keeps a small table of sink PDO configurations in RAM, each one stored as the
+  ready-to-write image of DPM_SNK_PDO1-3 (12 bytes) plus DPM_PDO_NUMB. All the
+  conversions and register reads are done once when a profile is added, so
+  switching between profiles (e.g. 5V idle, 9V normal, 15V boost) is one burst
+  write of the PDOs, one write of the PDO number and a soft reset, with no
+  floating point math and no reads.
+
+  The profiles only change the volatile registers, the NVM is not written.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_PROFILE_TABLE_H
+#define STUSB4500_PROFILE_TABLE_H
+
+#include "SparkFun_STUSB4500.h"
+
+#define PROFILE_TABLE_MAX_PROFILES  4
+
+struct STUSB4500_Profile {
+  uint8_t pdo[12];    //DPM_SNK_PDO1-3 (0x85-0x90)
+  uint8_t pdoNumber;  //DPM_PDO_NUMB
+};
+
+class STUSB4500_ProfileTable {
+  public:
+  /*
+    Attaches to a STUSB4500 that has already been started with begin(). The table is emptied.
+  */
+  void begin(STUSB4500 &device);
+
+  /*
+    Adds a profile with the PDO voltages, currents and number of config. The other
+	bits of the PDOs are taken from the volatile registers when the profile is added.
+	Returns the index of the profile, or -1 if the table is full or the PDO registers
+	could not be read.
+  */
+  int8_t addProfile(const STUSB4500_Config &config);
+
+  /*
+    Adds a profile requesting a single voltage: PDO2 set to voltage and current with a
+	PDO number of 2, or only PDO1 with current if voltage is 5V. PDO1 and PDO3 keep
+	their current values.
+	Parameter: voltage - 5 to 20V
+	           current - 0 to 5A
+	Returns the index of the profile, or -1 if the table is full or the PDO registers
+	could not be read.
+  */
+  int8_t addProfile(float voltage, float current);
+
+  /*
+    Adds a profile with the current content of the volatile PDO registers, e.g. after
+	setVoltage(), setCurrent() and setPdoNumber().
+	Returns the index of the profile, or -1 if the table is full or the PDO registers
+	could not be read.
+  */
+  int8_t captureProfile(void);
+
+  /*
+    Writes a profile to the volatile registers and, if renegotiate is true, sends a
+	soft reset so the source offers a new contract.
+	Returns false if index is not a profile or the write failed.
+  */
+  bool switchProfile(uint8_t index, bool renegotiate = true);
+
+  /*
+    Index of the last profile switched to, -1 if none.
+  */
+  int8_t getActiveProfile(void);
+
+  uint8_t getProfileCount(void);
+  const STUSB4500_Profile &getProfile(uint8_t index);
+
+  /*
+    Duration of the last switchProfile() in microseconds, and number of switches.
+  */
+  uint32_t getSwitchTime(void);
+  uint32_t getSwitchCount(void);
+
+  private:
+  STUSB4500 *_device;
+  STUSB4500_Profile _profile[PROFILE_TABLE_MAX_PROFILES];
+  uint8_t _profileCount;
+  int8_t _activeProfile;
+  uint32_t _switchTime;
+  uint32_t _switchCount;
+};
+
+#endif
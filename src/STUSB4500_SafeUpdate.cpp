@@ -0,0 +1,227 @@
+/*
+  Power-fail-safe NVM update for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_SafeUpdate.h"
+
+STUSB4500_SafeUpdate::STUSB4500_SafeUpdate(void)
+{
+  _device = NULL;
+  _changedSectors = 0;
+  _exposureWindow = 0;
+  _longestExposure = 0;
+  _restoreCount = 0;
+  _hasPrevious = false;
+}
+
+uint8_t STUSB4500_SafeUpdate::begin(STUSB4500 &device, const STUSB4500_NvmImage &image, bool restoreDifferent)
+{
+  _device = &device;
+  _image = image;
+  _hasPrevious = false;
+
+  return restore(restoreDifferent);
+}
+
+uint8_t STUSB4500_SafeUpdate::begin(STUSB4500 &device, const STUSB4500_NvmImage &image, const STUSB4500_NvmImage &previous,
+                                    bool restoreDifferent)
+{
+  _device = &device;
+  _image = image;
+  previous.toBytes(_previous);
+  _hasPrevious = true;
+
+  return restore(restoreDifferent);
+}
+
+uint8_t STUSB4500_SafeUpdate::restore(bool restoreDifferent)
+{
+  _changedSectors = 0;
+  _exposureWindow = 0;
+  _longestExposure = 0;
+
+  uint8_t state = check();
+
+  if(state == SAFE_NVM_PARTIAL || state == SAFE_NVM_BLANK || (state == SAFE_NVM_DIFFERENT && restoreDifferent))
+  {
+    uint8_t intended[5][8];
+    _image.toBytes(intended);
+
+    if(programSectors(intended, _changedSectors) == SAFE_UPDATE_OK)
+    {
+      _restoreCount++;
+      _hasPrevious = false;
+    }
+
+    //The volatile registers were loaded from the bad image at power up
+    _device->read();
+  }
+
+  return state;
+}
+
+uint8_t STUSB4500_SafeUpdate::check(void)
+{
+  uint8_t current[5][8];
+
+  if(_device->CUST_ReadSectors(current) != 0) return SAFE_NVM_BUS_ERROR;
+
+  return classify(current);
+}
+
+uint8_t STUSB4500_SafeUpdate::classify(const uint8_t current[][8])
+{
+  uint8_t intended[5][8];
+  _image.toBytes(intended);
+
+  _changedSectors = nvmSectorDiff(current, intended);
+
+  uint8_t blankSectors = 0;
+  for(uint8_t i=0; i<5; i++)
+  {
+    if(blank(current[i])) blankSectors |= (1<<i);
+  }
+
+  if(_changedSectors == 0) return SAFE_NVM_MATCH;
+  if(blankSectors == (SECTOR_0 | SECTOR_1 | SECTOR_2 | SECTOR_3 | SECTOR_4)) return SAFE_NVM_BLANK;
+  if(blankSectors & _changedSectors) return SAFE_NVM_PARTIAL;
+
+  //Interrupted between two sectors: the ones already programmed hold the intended
+  //image, the others still hold the previous one
+  if(_hasPrevious)
+  {
+    uint8_t updated = nvmSectorDiff(_previous, intended) & ~_changedSectors;
+    if(updated != 0 && (nvmSectorDiff(current, _previous) & _changedSectors) == 0) return SAFE_NVM_PARTIAL;
+  }
+
+  return SAFE_NVM_DIFFERENT;
+}
+
+uint8_t STUSB4500_SafeUpdate::update(void)
+{
+  _exposureWindow = 0;
+  _longestExposure = 0;
+
+  uint8_t current[5][8];
+  if(_device->CUST_ReadSectors(current) != 0) return SAFE_UPDATE_BUS_ERROR;
+
+  uint8_t state = classify(current);
+  if(state == SAFE_NVM_MATCH) return SAFE_UPDATE_OK;
+
+  //Resuming an interrupted update keeps the image it started from
+  if(state != SAFE_NVM_PARTIAL || !_hasPrevious)
+  {
+    memcpy(_previous, current, sizeof(current));
+    _hasPrevious = true;
+  }
+
+  uint8_t intended[5][8];
+  _image.toBytes(intended);
+
+  uint8_t result = programSectors(intended, _changedSectors);
+
+  if(result == SAFE_UPDATE_OK)
+  {
+    memcpy(_device->sector, intended, sizeof(intended));
+    _device->_dirtySectors = 0;
+    _hasPrevious = false;
+  }
+
+  return result;
+}
+
+uint8_t STUSB4500_SafeUpdate::update(const STUSB4500_NvmImage &image)
+{
+  _image = image;
+  return update();
+}
+
+void STUSB4500_SafeUpdate::setImage(const STUSB4500_NvmImage &image)
+{
+  _image = image;
+}
+
+const STUSB4500_NvmImage &STUSB4500_SafeUpdate::getImage(void)
+{
+  return _image;
+}
+
+uint8_t STUSB4500_SafeUpdate::getChangedSectors(void)
+{
+  return _changedSectors;
+}
+
+uint32_t STUSB4500_SafeUpdate::getExposureWindow(void)
+{
+  return _exposureWindow;
+}
+
+uint32_t STUSB4500_SafeUpdate::getLongestExposure(void)
+{
+  return _longestExposure;
+}
+
+uint16_t STUSB4500_SafeUpdate::getRestoreCount(void)
+{
+  return _restoreCount;
+}
+
+void STUSB4500_SafeUpdate::clearRestoreCount(void)
+{
+  _restoreCount = 0;
+}
+
+uint8_t STUSB4500_SafeUpdate::programSectors(const uint8_t image[][8], uint8_t mask)
+{
+  uint8_t data[8];
+
+  _exposureWindow = 0;
+  _longestExposure = 0;
+
+  for(uint8_t attempt=0; attempt<SAFE_UPDATE_RETRIES && mask != 0; attempt++)
+  {
+    for(uint8_t i=0; i<5; i++)
+    {
+      if((mask & (1<<i)) == 0) continue;
+
+      //Each sector is erased on its own and programmed straight away, polling the
+      //erase every millisecond rather than every 500ms as write() does.
+      memcpy(data, image[i], 8);
+      uint32_t start = millis();
+
+      if(_device->CUST_EnterWriteMode(1<<i, 1) != 0 || _device->CUST_WriteSector(i, data) != 0)
+      {
+        _device->CUST_ExitTestMode();
+        return SAFE_UPDATE_BUS_ERROR;
+      }
+
+      uint32_t window = millis() - start;
+      _exposureWindow += window;
+      if(window > _longestExposure) _longestExposure = window;
+    }
+    _device->CUST_ExitTestMode();
+
+    uint8_t readBack[5][8];
+    if(_device->CUST_ReadSectors(readBack) != 0) return SAFE_UPDATE_BUS_ERROR;
+    mask = nvmSectorDiff(readBack, image);
+  }
+
+  return mask == 0 ? SAFE_UPDATE_OK : SAFE_UPDATE_VERIFY_FAILED;
+}
+
+bool STUSB4500_SafeUpdate::blank(const uint8_t data[8])
+{
+  //Accept both erased states
+  bool zeros = true, ones = true;
+  for(uint8_t i=0; i<8; i++)
+  {
+    if(data[i] != 0x00) zeros = false;
+    if(data[i] != 0xFF) ones = false;
+  }
+  return zeros || ones;
+}
@@ -0,0 +1,125 @@
+/*
+  Power-fail-safe NVM update for the STUSB4500 Power Delivery Board.
+
+  write() erases all five sectors before programming any of them, so a brown-out
+  during the update leaves the NVM blank. STUSB4500_SafeUpdate keeps a copy of
+  the intended image and only touches the sectors that differ, erasing and
+  programming them one at a time. At most one sector is ever blank, and only for
+  the time it takes to erase and program it. Every update is read back and
+  verified.
+
+  At begin() the NVM is compared with the intended image. A blank or partly
+  written NVM (left by an interrupted update) is restored automatically. An
+  update interrupted between two sectors leaves no blank sector, only a mix of
+  old and new sectors: it is recognised when the previous image is known, either
+  given to begin() or remembered by update().
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_SAFE_UPDATE_H
+#define STUSB4500_SAFE_UPDATE_H
+
+#include "SparkFun_STUSB4500.h"
+
+//NVM state returned by check() and begin()
+#define SAFE_NVM_MATCH              0  //NVM holds the intended image
+#define SAFE_NVM_DIFFERENT          1  //NVM holds another valid configuration
+#define SAFE_NVM_PARTIAL            2  //Some sectors are blank or still hold the previous image, an update was interrupted
+#define SAFE_NVM_BLANK              3  //All sectors are blank
+#define SAFE_NVM_BUS_ERROR          4
+
+//Results returned by update()
+#define SAFE_UPDATE_OK              0
+#define SAFE_UPDATE_VERIFY_FAILED   1  //A sector still differs after SAFE_UPDATE_RETRIES attempts
+#define SAFE_UPDATE_BUS_ERROR       2
+
+#define SAFE_UPDATE_RETRIES         2
+
+class STUSB4500_SafeUpdate {
+  public:
+  STUSB4500_SafeUpdate(void);
+
+  /*
+    Attaches to a STUSB4500 that has already been started with begin(), checks its
+	NVM and restores the intended image if the NVM is blank or partly written.
+	Parameter: device           - the STUSB4500 to update.
+	           image            - the intended NVM image, kept by this object.
+	           restoreDifferent - also restore when the NVM holds a different but
+	                              complete configuration.
+	Returns the state found before any restore, see SAFE_NVM_*.
+  */
+  uint8_t begin(STUSB4500 &device, const STUSB4500_NvmImage &image, bool restoreDifferent = false);
+
+  /*
+    Same as above, for an update from a known image (e.g. the configuration of the
+	previous firmware release). An NVM holding some sectors of the intended image and
+	the others of the previous one is reported as SAFE_NVM_PARTIAL and restored.
+  */
+  uint8_t begin(STUSB4500 &device, const STUSB4500_NvmImage &image, const STUSB4500_NvmImage &previous,
+                bool restoreDifferent = false);
+
+  /*
+    Reads the NVM and compares it with the intended image. Returns SAFE_NVM_*.
+  */
+  uint8_t check(void);
+
+  /*
+    Programs the sectors that differ from the intended image, one at a time, then
+	verifies them. The NVM found before programming is kept as the previous image
+	until the update succeeds, so check() reports an interrupted update as
+	SAFE_NVM_PARTIAL. Returns SAFE_UPDATE_*.
+  */
+  uint8_t update(void);
+
+  /*
+    Replaces the intended image and programs it.
+  */
+  uint8_t update(const STUSB4500_NvmImage &image);
+
+  /*
+    Replaces the intended image without programming it.
+  */
+  void setImage(const STUSB4500_NvmImage &image);
+  const STUSB4500_NvmImage &getImage(void);
+
+  /*
+    Sectors found to differ by the last check() or update(), bit 0 = sector 0.
+  */
+  uint8_t getChangedSectors(void);
+
+  /*
+    Time the NVM was inconsistent during the last update (from entering write mode
+	for a sector to the end of its program, summed over the sectors), and the
+	longest single sector window, in milliseconds.
+  */
+  uint32_t getExposureWindow(void);
+  uint32_t getLongestExposure(void);
+
+  /*
+    Number of times begin() restored the image, over every begin() of this
+	object since it was created or the count was cleared.
+  */
+  uint16_t getRestoreCount(void);
+  void clearRestoreCount(void);
+
+  private:
+  STUSB4500 *_device;
+  STUSB4500_NvmImage _image;
+  uint8_t _changedSectors;
+  uint32_t _exposureWindow;
+  uint32_t _longestExposure;
+  uint16_t _restoreCount;
+  uint8_t _previous[5][8];
+  bool _hasPrevious;
+
+  uint8_t restore(bool restoreDifferent);
+  uint8_t classify(const uint8_t current[][8]);
+  uint8_t programSectors(const uint8_t image[][8], uint8_t mask);
+  static bool blank(const uint8_t data[8]);
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+  ALERT driven supervision of the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_Supervisor.h"
+
+bool STUSB4500_Supervisor::begin(STUSB4500 &device, int8_t alertPin, uint8_t events)
+{
+  _device = &device;
+  _alertPin = alertPin;
+  _pending = false;
+  memset(&_status, 0, sizeof(_status));
+
+  if(_alertPin >= 0) pinMode(_alertPin, INPUT_PULLUP);
+
+  uint8_t Buffer[1];
+  if(_device->I2C_Read_USB_PD(ALERT_STATUS_1_MASK, Buffer, 1) != 0) return false;
+  _previousMask = Buffer[0];
+
+  //A set bit masks the event
+  Buffer[0] = ~events;
+  if(_device->I2C_Write_USB_PD(ALERT_STATUS_1_MASK, Buffer, 1) != 0) return false;
+
+  uint8_t error = wake();
+
+  _wakeCount = 0;
+  _wakeTransactions = 0;
+  _wakeBytes = 0;
+
+  return error == 0;
+}
+
+void STUSB4500_Supervisor::end(void)
+{
+  uint8_t Buffer[1];
+  Buffer[0] = _previousMask;
+  _device->I2C_Write_USB_PD(ALERT_STATUS_1_MASK, Buffer, 1);
+
+  _device->setIdle(false);
+}
+
+void STUSB4500_Supervisor::alert(void)
+{
+  _pending = true;
+}
+
+bool STUSB4500_Supervisor::update(void)
+{
+  //Events read by peekStatus() no longer hold ALERT low
+  uint8_t peeked = _device->_statusEvents[ALERT_STATUS_1 - ALERT_STATUS_1] & ~_status.alertMask();
+
+  if(!_pending && peeked == 0 && (_alertPin < 0 || digitalRead(_alertPin) == HIGH)) return false;
+
+  return wake() == 0;
+}
+
+uint8_t STUSB4500_Supervisor::wake(void)
+{
+  uint32_t transactions = _device->getTransactionCount();
+  uint32_t bytes = _device->getByteCount();
+
+  _pending = false;
+
+  //Reading ALERT_STATUS_1 and the transition registers releases ALERT
+  STUSB4500_Status status;
+  uint8_t error = _device->readStatus(status);
+  if(error == 0) _status = status;
+
+  //The chip may have reset since the last wake up, e.g. on an attach after a brown-out
+  if(_device->_checkPeriod != 0) _device->checkVolatileState();
+  _device->setIdle(true);
+
+  _wakeCount++;
+  _wakeTransactions += _device->getTransactionCount() - transactions;
+  _wakeBytes += _device->getByteCount() - bytes;
+
+  return error;
+}
+
+const STUSB4500_Status &STUSB4500_Supervisor::getStatus(void)
+{
+  return _status;
+}
+
+uint8_t STUSB4500_Supervisor::getEvents(void)
+{
+  return _status.alertStatus() & ~_status.alertMask();
+}
+
+uint32_t STUSB4500_Supervisor::getWakeCount(void)
+{
+  return _wakeCount;
+}
+
+uint32_t STUSB4500_Supervisor::getWakeTransactions(void)
+{
+  return _wakeTransactions;
+}
+
+uint32_t STUSB4500_Supervisor::getWakeBytes(void)
+{
+  return _wakeBytes;
+}
+
+float STUSB4500_Supervisor::getBytesPerWake(void)
+{
+  if(_wakeCount == 0) return 0;
+
+  return (float)_wakeBytes / _wakeCount;
+}
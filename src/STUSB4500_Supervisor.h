@@ -0,0 +1,94 @@
+/*
+  ALERT driven supervision of the STUSB4500 Power Delivery Board.
+
+  Instead of waking up to poll the PD state, the STUSB4500 is configured so that
+  only the selected events (attach/detach, VBUS monitoring, PD messages, hard
+  reset, faults) assert its ALERT pin, and the library is put in its idle state
+  where it makes no I2C transactions. When ALERT is asserted, update() reads the
+  whole status window in a single burst, which also clears the alert, and the
+  library is idle again.
+
+  The number of wake ups and the bus traffic they cost are counted so the energy
+  spent on supervision can be budgeted.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_SUPERVISOR_H
+#define STUSB4500_SUPERVISOR_H
+
+#include "SparkFun_STUSB4500.h"
+
+//Attach/detach, VBUS, PD messages (contract changes), hard reset and faults
+#define SUPERVISOR_DEFAULT_EVENTS   (ALERT_CC_DETECTION_STATUS | ALERT_MONITORING_STATUS | ALERT_PRT_STATUS | \
+                                     ALERT_HARD_RESET | ALERT_HW_FAULT_STATUS)
+
+class STUSB4500_Supervisor {
+  public:
+  /*
+    Starts supervising a STUSB4500 that has already been started with begin().
+	Parameter: device   - the STUSB4500 to supervise.
+	           alertPin - pin connected to ALERT (active low), or -1 to only use alert().
+	           events   - ALERT_* events that assert ALERT, the others are masked.
+	Returns true on success. The status is read once to clear any pending alert.
+  */
+  bool begin(STUSB4500 &device, int8_t alertPin = -1, uint8_t events = SUPERVISOR_DEFAULT_EVENTS);
+
+  /*
+    Restores the previous alert mask and leaves the idle state.
+  */
+  void end(void);
+
+  /*
+    Marks an alert as pending. Safe to call from an interrupt attached to the ALERT pin.
+  */
+  void alert(void);
+
+  /*
+    Call from loop() or after waking up. If an alert is pending, or the ALERT pin is
+	low, reads the status in one burst. An event already read by peekStatus() (e.g. by
+	STUSB4500_Telemetry) no longer holds ALERT low, so it counts as pending too.
+	Otherwise makes no I2C transaction.
+	Returns true if the status was read. See wake() for the error of a failed read.
+  */
+  bool update(void);
+
+  /*
+    Reads the status in one burst, whether or not an alert is pending. When the reset
+	detection of the STUSB4500 is enabled (see STUSB4500::setResetDetection()), the
+	volatile PDOs are also checked.
+	Returns 0 on success, or the I2C error of STUSB4500::readStatus(). On an error the
+	status and events of the previous wake up are kept.
+  */
+  uint8_t wake(void);
+
+  /*
+    Status read by the last wake up, and the ALERT_* events it reported.
+  */
+  const STUSB4500_Status &getStatus(void);
+  uint8_t getEvents(void);
+
+  /*
+    Wake up statistics since begin(): number of wake ups, and the I2C transactions
+	and bytes they used (see STUSB4500::getByteCount()).
+  */
+  uint32_t getWakeCount(void);
+  uint32_t getWakeTransactions(void);
+  uint32_t getWakeBytes(void);
+  float    getBytesPerWake(void);
+
+  private:
+  STUSB4500 *_device;
+  STUSB4500_Status _status;
+  int8_t _alertPin;
+  uint8_t _previousMask;
+  volatile bool _pending;
+  uint32_t _wakeCount;
+  uint32_t _wakeTransactions;
+  uint32_t _wakeBytes;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+  Compact binary telemetry for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_Telemetry.h"
+
+void STUSB4500_Telemetry::begin(STUSB4500 &device, Print *output, uint16_t interval)
+{
+  _device = &device;
+  _output = output;
+  _interval = interval;
+  _lastSample = millis() - interval; //Sample on the first update()
+  _keyframeInterval = 50;
+  _sinceKeyframe = 0;
+  _sequence = 0;
+  _first = true;
+}
+
+void STUSB4500_Telemetry::setInterval(uint16_t interval)
+{
+  _interval = interval;
+}
+
+void STUSB4500_Telemetry::setKeyframeInterval(uint8_t records)
+{
+  _keyframeInterval = records;
+}
+
+uint8_t STUSB4500_Telemetry::update(void)
+{
+  if(_device->_idle) return 0;
+  if(millis() - _lastSample < _interval) return 0;
+  _lastSample += _interval;
+
+  //Don't try to catch up on missed samples
+  if(millis() - _lastSample >= _interval) _lastSample = millis();
+
+  uint8_t record[TELEMETRY_MAX_RECORD_LENGTH];
+  uint8_t length = sample(record);
+
+  if(length != 0 && _output != NULL) _output->write(record, length);
+
+  return length;
+}
+
+uint8_t STUSB4500_Telemetry::sample(uint8_t *record)
+{
+  uint8_t state[TELEMETRY_STATE_LENGTH];
+  uint32_t timestamp = millis();
+
+  //PDO1-3 (0x85-0x90) and the RDO (0x91-0x94) are contiguous: one burst
+  uint8_t pdoBlock[16];
+  _device->I2C_Read_USB_PD(DPM_SNK_PDO1, pdoBlock, 16);
+  memcpy(&state[0], &pdoBlock[0], 12);
+  memcpy(&state[13], &pdoBlock[12], 4);
+
+  _device->I2C_Read_USB_PD(DPM_PDO_NUMB, &state[12], 1);
+
+  //Peek: the events are left to the Supervisor or the sketch
+  STUSB4500_Status status;
+  _device->peekStatus(status);
+  memcpy(&state[17], status.reg, STATUS_WINDOW_LENGTH);
+
+  //Work out which fields changed since the last record
+  uint8_t mask = 0;
+  uint8_t offset = 0;
+  for(uint8_t i=0; i<6; i++)
+  {
+    if(memcmp(&state[offset], &_last[offset], telemetryFieldLength[i]) != 0) mask |= (1<<i);
+    offset += telemetryFieldLength[i];
+  }
+
+  bool keyframe = _first || (_keyframeInterval != 0 && _sinceKeyframe >= _keyframeInterval);
+  if(keyframe) mask = TELEMETRY_FIELD_ALL;
+
+  if(mask == 0) return 0;
+
+  _first = false;
+  _sinceKeyframe = keyframe ? 1 : _sinceKeyframe + 1;
+  memcpy(_last, state, TELEMETRY_STATE_LENGTH);
+
+  record[0] = TELEMETRY_SYNC;
+  record[1] = _sequence++;
+  record[2] = timestamp & 0xFF;
+  record[3] = (timestamp>>8) & 0xFF;
+  record[4] = (timestamp>>16) & 0xFF;
+  record[5] = (timestamp>>24) & 0xFF;
+  record[6] = mask;
+
+  uint8_t length = TELEMETRY_HEADER_LENGTH;
+  offset = 0;
+  for(uint8_t i=0; i<6; i++)
+  {
+    if(mask & (1<<i))
+    {
+      memcpy(&record[length], &state[offset], telemetryFieldLength[i]);
+      length += telemetryFieldLength[i];
+    }
+    offset += telemetryFieldLength[i];
+  }
+
+  record[length] = telemetryCrc8(record, length);
+
+  return length + 1;
+}
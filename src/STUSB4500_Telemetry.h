@@ -0,0 +1,72 @@
+/*
+  Compact binary telemetry for the STUSB4500 Power Delivery Board.
+
+  Samples the sink PDOs, DPM_PDO_NUMB, the negotiated contract (RDO) and the
+  status registers at a fixed rate, and emits a record containing only the
+  fields that changed. See stusb4500_telemetry_format.h for the record layout
+  and a decoder that can be used on the receiving side. The status registers are
+  read with STUSB4500::peekStatus(), so sampling does not take the events away
+  from readStatus() or STUSB4500_Supervisor.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_TELEMETRY_H
+#define STUSB4500_TELEMETRY_H
+
+#include "SparkFun_STUSB4500.h"
+#include "stusb4500_telemetry_format.h"
+
+class STUSB4500_Telemetry {
+  public:
+  /*
+    Attaches the telemetry encoder to a STUSB4500 that has already been started with begin().
+	Parameter: device   - the STUSB4500 to sample.
+	           output   - where update() sends the records (e.g. Serial). Pass NULL to only
+	                      use sample() with your own buffer.
+	           interval - sample period in milliseconds.
+  */
+  void begin(STUSB4500 &device, Print *output = NULL, uint16_t interval = 100);
+
+  /*
+    Sets the sample period in milliseconds.
+  */
+  void setInterval(uint16_t interval);
+
+  /*
+    Sets how often a full record (keyframe) is sent so a receiver that joins late or
+	drops a record can resynchronize. Parameter: records - a keyframe is sent every
+	n records, 0 sends a keyframe only for the first record.
+  */
+  void setKeyframeInterval(uint8_t records);
+
+  /*
+    Call from loop(). Samples the STUSB4500 when the sample period has elapsed and
+	writes the record to the output. Does nothing while the STUSB4500 is idle.
+	Returns the number of bytes written, 0 if nothing was due or nothing changed.
+  */
+  uint8_t update(void);
+
+  /*
+    Samples the STUSB4500 now and encodes a record into the buffer.
+	Parameter: record - buffer of at least TELEMETRY_MAX_RECORD_LENGTH bytes.
+	Returns the length of the record, 0 if no field changed.
+  */
+  uint8_t sample(uint8_t *record);
+
+  private:
+  STUSB4500 *_device;
+  Print *_output;
+  uint16_t _interval;
+  uint32_t _lastSample;
+  uint8_t _keyframeInterval;
+  uint8_t _sinceKeyframe;
+  uint8_t _sequence;
+  bool _first;
+  uint8_t _last[TELEMETRY_STATE_LENGTH];
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+  I2C trace recorder for the STUSB4500 Power Delivery Board.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "STUSB4500_Trace.h"
+
+STUSB4500_Trace::STUSB4500_Trace(void)
+{
+  _device = NULL;
+  _buffer = NULL;
+  _entries = 0;
+  clear();
+}
+
+void STUSB4500_Trace::begin(STUSB4500 &device, STUSB4500_TraceEntry *buffer, uint8_t entries)
+{
+  _device = &device;
+  _buffer = buffer;
+  _entries = entries;
+  clear();
+
+  _device->_trace = this;
+}
+
+void STUSB4500_Trace::end(void)
+{
+  if(_device != NULL && _device->_trace == this) _device->_trace = NULL;
+}
+
+void STUSB4500_Trace::clear(void)
+{
+  _head = 0;
+  _count = 0;
+  _dropped = 0;
+}
+
+uint8_t STUSB4500_Trace::getCount(void)
+{
+  return _count;
+}
+
+uint32_t STUSB4500_Trace::getDropped(void)
+{
+  return _dropped;
+}
+
+const STUSB4500_TraceEntry *STUSB4500_Trace::getEntry(uint8_t index)
+{
+  if(index >= _count) return NULL;
+
+  //The oldest entry is _count entries behind the head
+  uint16_t position = (uint16_t)_head + _entries - _count + index;
+  return &_buffer[position % _entries];
+}
+
+uint32_t STUSB4500_Trace::dump(Print &output)
+{
+  uint8_t header[TRACE_HEADER_LENGTH];
+
+  header[0] = TRACE_MAGIC;
+  header[1] = TRACE_VERSION;
+  header[2] = _device != NULL ? _device->_deviceAddress : 0;
+  header[3] = _dropped & 0xFF;
+  header[4] = (_dropped>>8) & 0xFF;
+  header[5] = (_dropped>>16) & 0xFF;
+  header[6] = (_dropped>>24) & 0xFF;
+  header[7] = _count;
+  header[8] = 0;
+
+  uint32_t length = output.write(header, TRACE_HEADER_LENGTH);
+
+  for(uint8_t i=0; i<_count; i++)
+  {
+    const STUSB4500_TraceEntry *entry = getEntry(i);
+    uint8_t data[TRACE_ENTRY_HEADER_LENGTH];
+
+    data[0] = entry->time & 0xFF;
+    data[1] = (entry->time>>8) & 0xFF;
+    data[2] = (entry->time>>16) & 0xFF;
+    data[3] = (entry->time>>24) & 0xFF;
+    data[4] = entry->flags;
+    data[5] = entry->reg;
+    data[6] = entry->length;
+
+    length += output.write(data, TRACE_ENTRY_HEADER_LENGTH);
+    length += output.write(entry->data, entry->stored());
+  }
+
+  return length;
+}
+
+void STUSB4500_Trace::record(bool read, uint8_t reg, const uint8_t *data, uint16_t length, uint8_t result)
+{
+  if(_entries == 0) return;
+
+  STUSB4500_TraceEntry *entry = &_buffer[_head];
+
+  entry->time = micros();
+  entry->flags = (read ? TRACE_READ : 0) | (result & TRACE_RESULT);
+  entry->reg = reg;
+  entry->length = length > 0xFF ? 0xFF : length;
+  memcpy(entry->data, data, entry->stored());
+
+  _head = (_head + 1) % _entries;
+  if(_count < _entries) _count++;
+  else _dropped++;
+}
@@ -0,0 +1,75 @@
+/*
+  I2C trace recorder for the STUSB4500 Power Delivery Board.
+
+  Once attached, every transaction made by the library (direction, register,
+  data, result and a timestamp) is saved to a fixed-size ring buffer supplied by
+  the sketch. When the buffer is full the oldest entries are overwritten.
+  The trace can be dumped in a compact binary form, see stusb4500_trace_format.h.
+
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_TRACE_H
+#define STUSB4500_TRACE_H
+
+#include "SparkFun_STUSB4500.h"
+#include "stusb4500_trace_format.h"
+
+class STUSB4500_Trace {
+  public:
+  STUSB4500_Trace(void);
+
+  /*
+    Starts recording the transactions of a STUSB4500.
+	Parameter: device  - the STUSB4500 to trace.
+	           buffer  - storage for the ring buffer (16 bytes per entry on most boards).
+	           entries - number of entries in buffer.
+  */
+  void begin(STUSB4500 &device, STUSB4500_TraceEntry *buffer, uint8_t entries);
+
+  /*
+    Stops recording. The entries recorded so far are kept.
+  */
+  void end(void);
+
+  /*
+    Discards all the entries.
+  */
+  void clear(void);
+
+  /*
+    Number of entries in the buffer, and number of entries overwritten since the last clear().
+  */
+  uint8_t  getCount(void);
+  uint32_t getDropped(void);
+
+  /*
+    Returns an entry, 0 being the oldest one. Returns NULL if index >= getCount().
+  */
+  const STUSB4500_TraceEntry *getEntry(uint8_t index);
+
+  /*
+    Writes the trace in the binary dump format to output (e.g. Serial). The address
+	in the header is 0 if begin() was never called.
+	Returns the number of bytes written.
+  */
+  uint32_t dump(Print &output);
+
+  /*
+    Called by the library for every transaction.
+  */
+  void record(bool read, uint8_t reg, const uint8_t *data, uint16_t length, uint8_t result);
+
+  private:
+  STUSB4500 *_device;
+  STUSB4500_TraceEntry *_buffer;
+  uint8_t _entries;
+  uint8_t _head;
+  uint8_t _count;
+  uint32_t _dropped;
+};
+
+#endif
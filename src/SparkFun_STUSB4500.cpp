@@ -19,26 +19,59 @@
 */
 
 #include "SparkFun_STUSB4500.h"
+#include "STUSB4500_Trace.h"
+
+//Parts of the volatile PDO shadow that hold a value written by the library
+#define SHADOW_PDO(pdo)             (1 << ((pdo)-1))
+#define SHADOW_PDO_NUMB             0x08
 
 uint8_t sector[5][8];
 uint8_t readSectors = 0;
 
+//Bits of the status window cleared by a read: ALERT_STATUS_1 and the transition bits,
+//the same bits as attachTransition(), vbusTransition(), hwFault() and PRT_STATUS
+static const uint8_t statusEventBits[STATUS_WINDOW_LENGTH] = {
+  0xFF, 0x00, 0x01, 0x00, 0x0E, 0x00, 0x00, 0xF0, 0x00, 0x00, 0x00, 0x15
+};
+
+STUSB4500::STUSB4500(void)
+{
+  _trace = NULL;
+  _dirtySectors = 0;
+  _validateWrites = true;
+  _idle = false;
+  _quietPeriod = 0;
+  _maxLatency = 0;
+  _pendingChanges = 0;
+  _commitCount = 0;
+  _commitsSaved = 0;
+  _refusedCommits = 0;
+  _shadowValid = 0;
+  _checkPeriod = 0;
+  _checkCount = 0;
+  _resetCount = 0;
+  _recoveryTime = 0;
+  memset(_statusEvents, 0, sizeof(_statusEvents));
+}
+
 uint8_t STUSB4500::begin(uint8_t deviceAddress, TwoWire &wirePort)
 {
   readSectors = 0;
   _deviceAddress = deviceAddress; //If provided, store the I2C address from user
   _i2cPort = &wirePort; //Grab which port the user wants us to use
+  clearBusStatistics();
 
   _i2cPort->beginTransmission(_deviceAddress);
 
   uint8_t error = _i2cPort->endTransmission();
+  _transactionCount++;
+  _byteCount++;
 
   if(error == 0)
   {
 	if(readSectors == 0)
     {
       read();
-	  readSectors = 1;
     }
 	return true; //Device online!
   }
@@ -47,183 +80,189 @@ uint8_t STUSB4500::begin(uint8_t deviceAddress, TwoWire &wirePort)
 
 void STUSB4500::read(void)
 {
-  uint8_t Buffer[1];
-  readSectors = 1;
-  //Read Current Parameters
-  //-Enter Read Mode
-  //-Read Sector[x][-]
-  //---------------------------------
-  //Enter Read Mode
-  Buffer[0]=FTP_CUST_PASSWORD;  /* Set Password 0x95->0x47*/
-  I2C_Write_USB_PD(FTP_CUST_PASSWORD_REG,Buffer,1);
-
-  Buffer[0]= 0; /* NVM internal controller reset 0x96->0x00*/
-  I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1);
-  
-  Buffer[0]= FTP_CUST_PWR | FTP_CUST_RST_N; /* Set PWR and RST_N bits 0x96->0xC0*/
-  I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1);
+  uint8_t image[5][8];
 
-  //--- End of CUST_EnterReadMode
-
-  for(uint8_t i=0;i<5;i++)
-  {
-    Buffer[0]= FTP_CUST_PWR | FTP_CUST_RST_N; /* Set PWR and RST_N bits 0x96->0xC0*/
-    I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1);
-
-    Buffer[0]= (READ & FTP_CUST_OPCODE);  /* Set Read Sectors Opcode 0x97->0x00*/
-    I2C_Write_USB_PD(FTP_CTRL_1,Buffer,1);
-
-    Buffer[0]= (i & FTP_CUST_SECT) |FTP_CUST_PWR |FTP_CUST_RST_N | FTP_CUST_REQ;
-    I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1);  /* Load Read Sectors Opcode */
-
-    do 
-    {
-      I2C_Read_USB_PD(FTP_CTRL_0,Buffer,1); /* Wait for execution */
-    }
-    while(Buffer[0] & FTP_CUST_REQ); //The FTP_CUST_REQ is cleared by NVM controller when the operation is finished.
-
-    I2C_Read_USB_PD(RW_BUFFER,&sector[i][0],8);
-  }
-  
-  CUST_ExitTestMode();
+  //Read Current Parameters, and keep the local copy if the bus fails
+  if(CUST_ReadSectors(image) != 0) return;
+  memcpy(sector, image, sizeof(image));
+  readSectors = 1;
+  _dirtySectors = 0;
 
   // NVM settings get loaded into the volatile registers after a hard reset or power cycle.
   // Below we will copy over some of the saved NVM settings to the I2C registers
   uint8_t currentValue;
 
   //PDO Number
-  setPdoNumber((sector[3][2] & 0x06)>>1);
+  setPdoNumber(nvmGet<NVM_SNK_PDO_NUMB>(sector));
 
 
   //PDO1 - fixed at 5V and is unable to change
   setVoltage(1,5.0);
 
-  currentValue = (sector[3][2]&0xF0) >> 4;
+  currentValue = nvmGet<NVM_I_SNK_PDO1>(sector);
   if(currentValue == 0)      setCurrent(1,0);
   else if(currentValue < 11) setCurrent(1,currentValue * 0.25 + 0.25);
   else                       setCurrent(1,currentValue * 0.50 - 2.50);
 
   //PDO2
-  setVoltage(2,((sector[4][1]<<2) + (sector[4][0]>>6))/20.0);
+  setVoltage(2,nvmGet<NVM_V_SNK_PDO2>(sector)/20.0);
 
-  currentValue = (sector[3][4]&0x0F);
+  currentValue = nvmGet<NVM_I_SNK_PDO2>(sector);
   if(currentValue == 0)      setCurrent(2,0);
   else if(currentValue < 11) setCurrent(2,currentValue * 0.25 + 0.25);
   else                       setCurrent(2,currentValue * 0.50 - 2.50);
 
   //PDO3
-  setVoltage(3,(((sector[4][3]&0x03)<<8) + sector[4][2])/20.0);
+  setVoltage(3,nvmGet<NVM_V_SNK_PDO3>(sector)/20.0);
 
-  currentValue = (sector[3][5]&0xF0) >> 4;
+  currentValue = nvmGet<NVM_I_SNK_PDO3>(sector);
   if(currentValue == 0)      setCurrent(3,0);
   else if(currentValue < 11) setCurrent(3,currentValue * 0.25 + 0.25);
   else                       setCurrent(3,currentValue * 0.50 - 2.50);
 }
 
-void STUSB4500::write(uint8_t defaultVals)
+uint8_t STUSB4500::write(uint8_t defaultVals)
 {
   if(defaultVals == 0)
   {
-  	uint8_t nvmCurrent[] = { 0, 0, 0};
-  	float voltage[] = { 0, 0, 0};
+    uint8_t result = stageWrite();
+    if(result == NVM_WRITE_REFUSED || result == NVM_WRITE_BUS_ERROR) return result;
+
+	CUST_EnterWriteMode(SECTOR_0 | SECTOR_1  | SECTOR_2 | SECTOR_3  | SECTOR_4 );
+    CUST_WriteSector(0,&sector[0][0]);
+    CUST_WriteSector(1,&sector[1][0]);
+    CUST_WriteSector(2,&sector[2][0]);
+    CUST_WriteSector(3,&sector[3][0]);
+    CUST_WriteSector(4,&sector[4][0]);
+    CUST_ExitTestMode();
+    _dirtySectors = 0;
+
+    return result;
+  }
+  else
+  {
+    writeImage(STUSB4500_NvmImage::defaults());
+    return NVM_WRITE_OK;
+  }
+}
 
-  	uint32_t digitalVoltage=0;
+uint8_t STUSB4500::stageWrite(void)
+{
+  uint8_t nvmCurrent[] = { 0, 0, 0};
+  float voltage[] = { 0, 0, 0};
 
-  	//Load current values into NVM
-  	for(byte i=0; i<3; i++)
-  	{
-  	  uint32_t pdoData = readPDO(i+1);
-  	  float current = (pdoData&0x3FF)*0.01; //The current is the first 10-bits of the 32-bit PDO register (10mA resolution)
+  uint32_t digitalVoltage=0;
+  uint8_t result = NVM_WRITE_OK;
 
-  	  if(current > 5.0) current = 5.0; //Constrain current value to 5A max
+  // Read the three PDOs and the highest priority PDO number from memory
+  uint8_t pdoRegisters[12];
+  uint8_t Buffer[1];
 
-  	  /*Convert current from float to 4-bit value
-       -current from 0.5-3.0A is set in 0.25A steps
-       -current from 3.0-5.0A is set in 0.50A steps
-      */
-  	  if(current < 0.5)     nvmCurrent[i] = 0;
-  	  else if(current <= 3) nvmCurrent[i] = (4*current)-1;
-  	  else                  nvmCurrent[i] = (2*current)+5;
+  //The local copy holds the sectors write() saves: it must come from the chip
+  if(!readSectors) return NVM_WRITE_BUS_ERROR;
 
+  //Failed reads leave 0xFF bytes, which would be saved as 20V and 5A
+  if(I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12) != 0) return NVM_WRITE_BUS_ERROR;
+  if(I2C_Read_USB_PD(DPM_PDO_NUMB, Buffer,1) != 0) return NVM_WRITE_BUS_ERROR;
 
-  	  digitalVoltage = (pdoData>>10)&0x3FF; //The voltage is bits 10:19 of the 32-bit PDO register
-  	  voltage[i] = digitalVoltage/20.0; //Voltage has 50mV resolution
+  // Check the configuration before anything is erased
+  if(_validateWrites)
+  {
+    STUSB4500_Validation validation;
+    checkConfig(pdoRegisters, Buffer[0], validation);
 
-  	  // Make sure the minimum voltage is between 5-20V
-  	  if(voltage[i] < 5.0)       voltage[i] = 5.0;
-  	  else if(voltage[i] > 20.0) voltage[i] = 20.0;
-  	}
+    if(validation.errors != 0) return NVM_WRITE_REFUSED;
+    if(validation.warnings != 0) result = NVM_WRITE_WARNINGS;
+  }
 
-  	// load current for PDO1 (sector 3, byte 2, bits 4:7)
-    sector[3][2] &= 0x0F;             //clear bits 4:7
-    sector[3][2] |= (nvmCurrent[0]<<4);    //load new amperage for PDO1
+  //Load current values into NVM
+  for(byte i=0; i<3; i++)
+  {
+    uint32_t pdoData = (uint32_t)pdoRegisters[i*4] | ((uint32_t)pdoRegisters[i*4+1]<<8) |
+                       ((uint32_t)pdoRegisters[i*4+2]<<16) | ((uint32_t)pdoRegisters[i*4+3]<<24);
 
-    // load current for PDO2 (sector 3, byte 4, bits 0:3)
-    sector[3][4] &= 0xF0;             //clear bits 0:3
-    sector[3][4] |= nvmCurrent[1];     //load new amperage for PDO2
+    nvmCurrent[i] = nvmCurrentFromPdo(pdoData);
 
-    // load current for PDO3 (sector 3, byte 5, bits 4:7)
-    sector[3][5] &= 0x0F;           //clear bits 4:7
-    sector[3][5] |= (nvmCurrent[2]<<4);  //set amperage for PDO3
 
-    // The voltage for PDO1 is 5V and cannot be changed
+    digitalVoltage = (pdoData>>10)&0x3FF; //The voltage is bits 10:19 of the 32-bit PDO register
+    voltage[i] = digitalVoltage/20.0; //Voltage has 50mV resolution
 
-    // PDO2
-	// Load voltage (10-bit)
-	// -bit 9:2 - sector 4, byte 1, bits 0:7
-	// -bit 0:1 - sector 4, byte 0, bits 6:7	
-	digitalVoltage = voltage[1] * 20;          //convert votlage to 10-bit value
-	sector[4][0] &= 0x3F;                        //clear bits 6:7
-	sector[4][0] |= ((digitalVoltage&0x03)<<6);  //load voltage bits 0:1 into bits 6:7
-	sector[4][1] = (digitalVoltage>>2);          //load bits 2:9
+    // Make sure the minimum voltage is between 5-20V
+    if(voltage[i] < 5.0)       voltage[i] = 5.0;
+    else if(voltage[i] > 20.0) voltage[i] = 20.0;
+  }
 
-    // PDO3
-    // Load voltage (10-bit)
-    // -bit 8:9 - sector 4, byte 3, bits 0:1
-    // -bit 0:7 - sector 4, byte 2, bits 0:7
-    digitalVoltage = voltage[2] * 20;   //convert voltage to 10-bit value
-    sector[4][2] = 0xFF & digitalVoltage; //load bits 0:7
-    sector[4][3] &= 0xFC;                 //clear bits 0:1
-    sector[4][3] |= (digitalVoltage>>8);  //load bits 8:9
+  // load current for PDO1-3
+  set<NVM_I_SNK_PDO1>(nvmCurrent[0]);
+  set<NVM_I_SNK_PDO2>(nvmCurrent[1]);
+  set<NVM_I_SNK_PDO3>(nvmCurrent[2]);
 
-    
-    // Load highest priority PDO number from memory
-    uint8_t Buffer[1];
-    I2C_Read_USB_PD(DPM_PDO_NUMB, Buffer,1);
-  
-    //load PDO number (sector 3, byte 2, bits 2:3) for NVM saving
-    sector[3][2] &= 0xF9;
-    sector[3][2] |= (Buffer[0]<<1);
+  // The voltage for PDO1 is 5V and cannot be changed
 
+  // PDO2 and PDO3 voltage (10-bit, 50mV resolution)
+  digitalVoltage = voltage[1] * 20;          //convert voltage to 10-bit value
+  set<NVM_V_SNK_PDO2>(digitalVoltage);
 
-	CUST_EnterWriteMode(SECTOR_0 | SECTOR_1  | SECTOR_2 | SECTOR_3  | SECTOR_4 );
-    CUST_WriteSector(0,&sector[0][0]);
-    CUST_WriteSector(1,&sector[1][0]);
-    CUST_WriteSector(2,&sector[2][0]);
-    CUST_WriteSector(3,&sector[3][0]);
-    CUST_WriteSector(4,&sector[4][0]);
-    CUST_ExitTestMode();
+  digitalVoltage = voltage[2] * 20;          //convert voltage to 10-bit value
+  set<NVM_V_SNK_PDO3>(digitalVoltage);
+
+
+  //load PDO number for NVM saving
+  set<NVM_SNK_PDO_NUMB>(Buffer[0]);
+
+  return result;
+}
+
+//Counts an issue, and saves it if there is room left in the list
+static void addIssue(STUSB4500_Validation &result, uint8_t pdo_numb, uint8_t code)
+{
+  if(code & VALIDATION_ERROR) result.errors++;
+  else result.warnings++;
+
+  if(result.count < VALIDATION_MAX_ISSUES)
+  {
+    result.code[result.count] = code;
+    result.pdo[result.count] = pdo_numb;
+    result.count++;
   }
-  else
+}
+
+uint8_t STUSB4500::validate(STUSB4500_Validation &result)
+{
+  uint8_t pdoRegisters[12];
+  uint8_t pdoNumber;
+
+  if(I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12) != 0 ||
+     I2C_Read_USB_PD(DPM_PDO_NUMB, &pdoNumber, 1) != 0)
   {
-	uint8_t default_sector[5][8] = 
-    {
-      {0x00,0x00,0xB0,0xAA,0x00,0x45,0x00,0x00},
-      {0x10,0x40,0x9C,0x1C,0xFF,0x01,0x3C,0xDF},
-      {0x02,0x40,0x0F,0x00,0x32,0x00,0xFC,0xF1},
-      {0x00,0x19,0x56,0xAF,0xF5,0x35,0x5F,0x00},
-      {0x00,0x4B,0x90,0x21,0x43,0x00,0x40,0xFB}
-    };
-  
-	CUST_EnterWriteMode(SECTOR_0 | SECTOR_1  | SECTOR_2 | SECTOR_3  | SECTOR_4 );
-    CUST_WriteSector(0,&default_sector[0][0]);
-    CUST_WriteSector(1,&default_sector[1][0]);
-    CUST_WriteSector(2,&default_sector[2][0]);
-    CUST_WriteSector(3,&default_sector[3][0]);
-    CUST_WriteSector(4,&default_sector[4][0]);
-    CUST_ExitTestMode();
+    memset(&result, 0, sizeof(result));
+    addIssue(result, 0, VALIDATION_BUS_ERROR);
+    return result.errors;
   }
-  
+
+  checkConfig(pdoRegisters, pdoNumber, result);
+
+  return result.errors;
+}
+
+void STUSB4500::setWriteValidation(bool enable)
+{
+  _validateWrites = enable;
+}
+
+void STUSB4500::writeImage(const STUSB4500_NvmImage &image)
+{
+  image.toBytes(sector);
+  readSectors = 1;
+
+  CUST_EnterWriteMode(SECTOR_0 | SECTOR_1  | SECTOR_2 | SECTOR_3  | SECTOR_4 );
+  CUST_WriteSector(0,&sector[0][0]);
+  CUST_WriteSector(1,&sector[1][0]);
+  CUST_WriteSector(2,&sector[2][0]);
+  CUST_WriteSector(3,&sector[3][0]);
+  CUST_WriteSector(4,&sector[4][0]);
+  CUST_ExitTestMode();
+  _dirtySectors = 0;
 }
 
 float STUSB4500::getVoltage(uint8_t pdo_numb)
@@ -254,11 +293,11 @@ uint8_t STUSB4500::getLowerVoltageLimit(uint8_t pdo_numb)
   }
   else if(pdo_numb == 2) //PDO2
   {
-	return (sector[3][4]>>4) + 5;
+	return get<NVM_SHIFT_VBUS_LL2>() + 5;
   }
   else //PDO3
   {
-	return (sector[3][6] & 0x0F) + 5;
+	return get<NVM_SHIFT_VBUS_LL3>() + 5;
   }
 }
 
@@ -266,21 +305,21 @@ uint8_t STUSB4500::getUpperVoltageLimit(uint8_t pdo_numb)
 {
   if(pdo_numb == 1) //PDO1
   {
-	return (sector[3][3]>>4) + 5;
+	return get<NVM_SHIFT_VBUS_HL1>() + 5;
   }
   else if(pdo_numb == 2) //PDO2
   {
-	return (sector[3][5] & 0x0F) + 5;
+	return get<NVM_SHIFT_VBUS_HL2>() + 5;
   }
   else //PDO3
   {
-	return (sector[3][6]>>4) + 5;
+	return get<NVM_SHIFT_VBUS_HL3>() + 5;
   }
 }
 
 float STUSB4500::getFlexCurrent(void)
 {
-  uint16_t digitalValue = ((sector[4][4]&0x0F)<<6) + ((sector[4][3]&0xFC)>>2);
+  uint16_t digitalValue = get<NVM_I_SNK_PDO_FLEX>();
   return digitalValue / 100.0;
 }
 
@@ -294,32 +333,32 @@ uint8_t STUSB4500::getPdoNumber(void)
 
 uint8_t STUSB4500::getExternalPower(void)
 {
-  return (sector[3][2]&0x08)>>3;
+  return get<NVM_SNK_UNCONS_POWER>();
 }
 
 uint8_t STUSB4500::getUsbCommCapable(void)
 {
-  return (sector[3][2]&0x01);
+  return get<NVM_USB_COMM_CAPABLE>();
 }
 
 uint8_t STUSB4500::getConfigOkGpio(void)
 {
-  return (sector[4][4]&0x60)>>5;
+  return get<NVM_POWER_OK_CFG>();
 }
 
 uint8_t STUSB4500::getGpioCtrl(void)
 {
-  return (sector[1][0]&0x30)>>4;
+  return get<NVM_GPIO_CFG>();
 }
 
 uint8_t STUSB4500::getPowerAbove5vOnly(void)
 {
-  return (sector[4][6]&0x08)>>3;
+  return get<NVM_POWER_ONLY_ABOVE_5V>();
 }
 
 uint8_t STUSB4500::getReqSrcCurrent(void)
 {
-  return (sector[4][6]&0x10)>>4;
+  return get<NVM_REQ_SRC_CURRENT>();
 }
 
 void STUSB4500::setVoltage(uint8_t pdo_numb, float voltage)
@@ -370,15 +409,11 @@ void STUSB4500::setLowerVoltageLimit(uint8_t pdo_numb, uint8_t value)
 
   if(pdo_numb == 2) //UVLO2
   {
-    //load UVLO (sector 3, byte 4, bits 4:7)
-    sector[3][4] &= 0x0F;             //clear bits 4:7
-    sector[3][4] |= (value-5)<<4;  //load new UVLO value
+    set<NVM_SHIFT_VBUS_LL2>(value-5);
   }
   else if(pdo_numb == 3) //UVLO3
   {
-    //load UVLO (sector 3, byte 6, bits 0:3)
-    sector[3][6] &= 0xF0;
-    sector[3][6] |= (value-5);
+    set<NVM_SHIFT_VBUS_LL3>(value-5);
   }
 }
 
@@ -390,21 +425,15 @@ void STUSB4500::setUpperVoltageLimit(uint8_t pdo_numb, uint8_t value)
 
   if(pdo_numb == 1) //OVLO1
   {
-    //load OVLO (sector 3, byte 3, bits 4:7)
-    sector[3][3] &= 0x0F;             //clear bits 4:7
-    sector[3][3] |= (value-5)<<4;  //load new OVLO value
+    set<NVM_SHIFT_VBUS_HL1>(value-5);
   }
   else if(pdo_numb == 2) //OVLO2
   {
-    //load OVLO (sector 3, byte 5, bits 0:3)
-    sector[3][5] &= 0xF0;             //clear bits 0:3
-    sector[3][5] |= (value-5);     //load new OVLO value
+    set<NVM_SHIFT_VBUS_HL2>(value-5);
   }
   else if(pdo_numb == 3) //OVLO3
   {
-    //load OVLO (sector 3, byte 6, bits 4:7)
-    sector[3][6] &= 0x0F;
-    sector[3][6] |= ((value-5)<<4);
+    set<NVM_SHIFT_VBUS_HL3>(value-5);
   }
 }
 
@@ -416,11 +445,7 @@ void STUSB4500::setFlexCurrent(float value)
   
   uint16_t flex_val = value*100;
 
-  sector[4][3] &= 0x03;                 //clear bits 2:6
-  sector[4][3] |= ((flex_val&0x3F)<<2); //set bits 2:6
-  
-  sector[4][4] &= 0xF0;                 //clear bits 0:3
-  sector[4][4] |= ((flex_val&0x3C0)>>6);//set bits 0:3
+  set<NVM_I_SNK_PDO_FLEX>(flex_val);
 }
 
 void STUSB4500::setPdoNumber(uint8_t value)
@@ -431,24 +456,23 @@ void STUSB4500::setPdoNumber(uint8_t value)
   //load PDO number to volatile memory
   Buffer[0] = value;
   I2C_Write_USB_PD(DPM_PDO_NUMB, Buffer,1);
+
+  _pdoNumberShadow = value;
+  _shadowValid |= SHADOW_PDO_NUMB;
 }
 
 void STUSB4500::setExternalPower(uint8_t value)
 {
   if(value != 0) value = 1;
   
-  //load SNK_UNCONS_POWER (sector 3, byte 2, bit 3)
-  sector[3][2] &= 0xF7; //clear bit 3
-  sector[3][2] |= (value)<<3;
+  set<NVM_SNK_UNCONS_POWER>(value);
 }
 
 void STUSB4500::setUsbCommCapable(uint8_t value)
 {
   if(value != 0) value = 1;
   
-  //load USB_COMM_CAPABLE (sector 3, byte 2, bit 0)
-  sector[3][2] &= 0xFE; //clear bit 0
-  sector[3][2] |= (value);
+  set<NVM_USB_COMM_CAPABLE>(value);
 }
 
 void STUSB4500::setConfigOkGpio(uint8_t value)
@@ -456,36 +480,28 @@ void STUSB4500::setConfigOkGpio(uint8_t value)
   if(value < 2) value = 0;
   else if(value > 3) value = 3;
   
-  //load POWER_OK_CFG (sector 4, byte 4, bits 5:6)
-  sector[4][4] &= 0x9F; //clear bit 3
-  sector[4][4] |= value<<5;
+  set<NVM_POWER_OK_CFG>(value);
 }
 
 void STUSB4500::setGpioCtrl(uint8_t value)
 {
   if(value > 3) value = 3;
   
-  //load GPIO_CFG (sector 1, byte 0, bits 4:5)
-  sector[1][0] &= 0xCF; //clear bits 4:5
-  sector[1][0] |= value<<4;
+  set<NVM_GPIO_CFG>(value);
 }
 
 void STUSB4500::setPowerAbove5vOnly(uint8_t value)
 {
   if(value != 0) value = 1;
   
-  //load POWER_ONLY_ABOVE_5V (sector 4, byte 6, bit 3)
-  sector[4][6] &= 0xF7; //clear bit 3
-  sector[4][6] |= (value<<3); //set bit 3
+  set<NVM_POWER_ONLY_ABOVE_5V>(value);
 }
 
 void STUSB4500::setReqSrcCurrent(uint8_t value)
 {
   if(value != 0) value = 1;
   
-  //load REQ_SRC_CURRENT (sector 4, byte 6, bit 4)
-  sector[4][6] &= 0xEF; //clear bit 4
-  sector[4][6] |= (value<<4); //set bit 4
+  set<NVM_REQ_SRC_CURRENT>(value);
 }
 
 void STUSB4500::softReset( void )
@@ -500,6 +516,236 @@ void STUSB4500::softReset( void )
   I2C_Write_USB_PD(PD_COMMAND_CTRL, Buffer,1);
 }
 
+uint8_t STUSB4500::readStatus(STUSB4500_Status &status)
+{
+  uint8_t error = peekStatus(status);
+
+  //Handed over to the caller
+  if(error == 0) memset(_statusEvents, 0, sizeof(_statusEvents));
+
+  return error;
+}
+
+uint8_t STUSB4500::peekStatus(STUSB4500_Status &status)
+{
+  uint32_t startTime = micros();
+
+  //The status registers are contiguous, read them all in one transaction
+  uint8_t error = I2C_Read_USB_PD(ALERT_STATUS_1, status.reg, STATUS_WINDOW_LENGTH);
+
+  status.readTime = micros() - startTime;
+
+  if(error != 0) return error;
+
+  //The read cleared the events: keep them for the next readStatus()
+  for(uint8_t i=0; i<STATUS_WINDOW_LENGTH; i++)
+  {
+    _statusEvents[i] |= status.reg[i] & statusEventBits[i];
+    status.reg[i] |= _statusEvents[i];
+  }
+
+  return 0;
+}
+
+uint32_t STUSB4500::getTransactionCount(void)
+{
+  return _transactionCount;
+}
+
+uint32_t STUSB4500::getByteCount(void)
+{
+  return _byteCount;
+}
+
+void STUSB4500::clearBusStatistics(void)
+{
+  _transactionCount = 0;
+  _byteCount = 0;
+}
+
+void STUSB4500::setIdle(bool idle)
+{
+  _idle = idle;
+}
+
+bool STUSB4500::isIdle(void)
+{
+  return _idle;
+}
+
+void STUSB4500::setAutoCommit(uint16_t quietPeriod, uint16_t maxLatency)
+{
+  _quietPeriod = quietPeriod;
+  _maxLatency = maxLatency;
+}
+
+bool STUSB4500::update(void)
+{
+  //Changes already saved or discarded by write(), read(), writeImage(), ...
+  if(_dirtySectors == 0) _pendingChanges = 0;
+
+  //Only the polling is suspended while idle, pending changes are still saved
+  bool recovered = false;
+  if(!_idle && _checkPeriod != 0 && millis() - _lastCheck >= _checkPeriod) recovered = checkVolatileState();
+
+  return commitChanges() || recovered;
+}
+
+bool STUSB4500::commitChanges(void)
+{
+  if(_quietPeriod == 0 || _pendingChanges == 0) return false;
+
+  uint32_t now = millis();
+  if(now - _lastChange < _quietPeriod && now - _firstChange < _maxLatency) return false;
+
+  uint16_t changes = _pendingChanges;
+  uint8_t result = write();
+  if(result == NVM_WRITE_REFUSED || result == NVM_WRITE_BUS_ERROR)
+  {
+    _refusedCommits++;
+    _pendingChanges = 0;
+    return false;
+  }
+
+  _pendingChanges = 0;
+  _commitCount++;
+  _commitsSaved += changes - 1;
+  return true;
+}
+
+void STUSB4500::setResetDetection(uint16_t period)
+{
+  _checkPeriod = period;
+  _lastCheck = millis();
+}
+
+uint32_t STUSB4500::getCheckCount(void)
+{
+  return _checkCount;
+}
+
+uint32_t STUSB4500::getResetCount(void)
+{
+  return _resetCount;
+}
+
+uint32_t STUSB4500::getRecoveryTime(void)
+{
+  return _recoveryTime;
+}
+
+bool STUSB4500::checkVolatileState(void)
+{
+  uint8_t pdoRegisters[12];
+  uint8_t pdoNumber;
+  bool match = true;
+
+  _lastCheck = millis();
+  _checkCount++;
+
+  if(I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12) != 0) return false;
+  if(I2C_Read_USB_PD(DPM_PDO_NUMB, &pdoNumber, 1) != 0) return false;
+
+  //Compare the parts written by the library, and merge them with what the chip holds
+  for(uint8_t pdo=1; pdo<=3; pdo++)
+  {
+    if((_shadowValid & SHADOW_PDO(pdo)) == 0) continue;
+    if(memcmp(&pdoRegisters[(pdo-1)*4], &_pdoShadow[(pdo-1)*4], 4) != 0) match = false;
+    memcpy(&pdoRegisters[(pdo-1)*4], &_pdoShadow[(pdo-1)*4], 4);
+  }
+  if(_shadowValid & SHADOW_PDO_NUMB)
+  {
+    if((pdoNumber & 0x07) != _pdoNumberShadow) match = false;
+    pdoNumber = _pdoNumberShadow;
+  }
+
+  if(match) return false;
+
+  //The chip was reset and reloaded its volatile registers from the NVM
+  uint32_t startTime = micros();
+  writePdoRegisters(pdoRegisters, pdoNumber);
+  softReset();
+  _recoveryTime = micros() - startTime;
+  _resetCount++;
+
+  //Keep the values as the chip holds them, so bits it doesn't store can't trigger
+  //another recovery on the next check
+  if(I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12) == 0)
+  {
+    for(uint8_t pdo=1; pdo<=3; pdo++)
+    {
+      if(_shadowValid & SHADOW_PDO(pdo)) memcpy(&_pdoShadow[(pdo-1)*4], &pdoRegisters[(pdo-1)*4], 4);
+    }
+  }
+
+  return true;
+}
+
+uint32_t STUSB4500::getCommitCount(void)
+{
+  return _commitCount;
+}
+
+uint32_t STUSB4500::getCommitsSaved(void)
+{
+  return _commitsSaved;
+}
+
+uint32_t STUSB4500::getRefusedCommits(void)
+{
+  return _refusedCommits;
+}
+
+void STUSB4500::markChanged(void)
+{
+  uint32_t now = millis();
+
+  if(_pendingChanges == 0) _firstChange = now;
+  if(_pendingChanges < 0xFFFF) _pendingChanges++;
+  _lastChange = now;
+}
+
+uint8_t STUSB4500::getDirtySectors(void)
+{
+  return _dirtySectors;
+}
+
+uint8_t STUSB4500::readConfig(STUSB4500_Config &config)
+{
+  uint8_t pdoRegisters[12];
+  uint8_t pdoNumber;
+
+  config.decode(sector);
+
+  uint8_t error = I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12);
+  if(error == 0) error = I2C_Read_USB_PD(DPM_PDO_NUMB, &pdoNumber, 1);
+  if(error != 0) return error;
+
+  config.decodePdos(pdoRegisters, pdoNumber);
+  return 0;
+}
+
+uint8_t STUSB4500::writeConfig(const STUSB4500_Config &config)
+{
+  uint8_t previous[5][8];
+  uint8_t pdoRegisters[12];
+  uint8_t pdoNumber = config.pdoNumber > 3 ? 3 : config.pdoNumber;
+
+  //Keep the PDO bits the library doesn't manage, and update all three PDOs at once
+  uint8_t error = I2C_Read_USB_PD(DPM_SNK_PDO1, pdoRegisters, 12);
+  if(error != 0) return error;
+
+  memcpy(previous, sector, sizeof(previous));
+  config.encode(sector);
+  uint8_t changed = nvmSectorDiff(previous, sector);
+  _dirtySectors |= changed;
+  if(changed) markChanged();
+
+  config.encodePdos(pdoRegisters);
+  writePdoRegisters(pdoRegisters, pdoNumber);
+  return 0;
+}
+
 uint32_t STUSB4500::readPDO(uint8_t pdo_numb)
 {
   uint32_t pdoData=0;
@@ -519,6 +765,64 @@ uint32_t STUSB4500::readPDO(uint8_t pdo_numb)
   return pdoData;
 }
 
+uint8_t STUSB4500::nvmCurrentFromPdo(uint32_t pdoData)
+{
+  float current = (pdoData&0x3FF)*0.01; //The current is the first 10-bits of the 32-bit PDO register (10mA resolution)
+
+  if(current > 5.0) current = 5.0; //Constrain current value to 5A max
+
+  /*Convert current from float to 4-bit value
+   -current from 0.5-3.0A is set in 0.25A steps
+   -current from 3.0-5.0A is set in 0.50A steps
+  */
+  if(current < 0.5)     return 0;
+  else if(current <= 3) return (4*current)-1;
+  else                  return (2*current)+5;
+}
+
+void STUSB4500::checkConfig(const uint8_t pdoRegisters[12], uint8_t pdoNumber, STUSB4500_Validation &result)
+{
+  uint16_t voltage[3]; //50mV units, as they will be saved
+  uint8_t codes[3];
+
+  memset(&result, 0, sizeof(result));
+
+  pdoNumber &= 0x07;
+  if(pdoNumber < 1) pdoNumber = 1;
+  else if(pdoNumber > 3) pdoNumber = 3;
+
+  uint16_t flexCurrent = get<NVM_I_SNK_PDO_FLEX>();
+
+  for(uint8_t i=0; i<3; i++)
+  {
+    uint8_t pdo_numb = i+1;
+    uint32_t pdoData = (uint32_t)pdoRegisters[i*4] | ((uint32_t)pdoRegisters[i*4+1]<<8) |
+                       ((uint32_t)pdoRegisters[i*4+2]<<16);
+    uint16_t current = pdoData & 0x3FF;   //10mA units
+    uint16_t requested = (pdoData>>10) & 0x3FF;   //50mV units
+    codes[i] = nvmCurrentFromPdo(pdoData);
+
+    //PDO1 is always saved as 5V, the others are clamped to 5-20V
+    voltage[i] = pdo_numb == 1 ? 100 : requested < 100 ? 100 : requested > 400 ? 400 : requested;
+    if(pdo_numb != 1 && voltage[i] != requested) addIssue(result, pdo_numb, VALIDATION_VOLTAGE_CLAMPED);
+
+    if(current > 500)                                 addIssue(result, pdo_numb, VALIDATION_CURRENT_CLAMPED);
+    else if(current != 0 && current < 50)             addIssue(result, pdo_numb, VALIDATION_CURRENT_USES_FLEX);
+    else if(current != nvmCurrentValue(codes[i]))     addIssue(result, pdo_numb, VALIDATION_CURRENT_ROUNDED);
+
+    //The remaining checks only matter for the PDOs the sink will use
+    if(pdo_numb <= pdoNumber)
+    {
+      if(codes[i] == 0 && flexCurrent == 0) addIssue(result, pdo_numb, VALIDATION_FLEX_CURRENT_ZERO);
+
+      //Saved voltage plus the overvoltage margin, in 50mV units
+      if((uint32_t)voltage[i] * (100 + getUpperVoltageLimit(pdo_numb)) > 440UL * 100) addIssue(result, pdo_numb, VALIDATION_OVLO_ABOVE_MAX);
+    }
+
+    if(pdo_numb == 3 && pdoNumber == 3 && voltage[2] < voltage[1]) addIssue(result, pdo_numb, VALIDATION_PDO_ORDER);
+  }
+}
+
 void STUSB4500::writePDO(uint8_t pdo_numb, uint32_t pdoData)
 {
   uint8_t Buffer[4];
@@ -529,9 +833,32 @@ void STUSB4500::writePDO(uint8_t pdo_numb, uint32_t pdoData)
   Buffer[3] = (pdoData>>24)& 0xFF;
 
   I2C_Write_USB_PD(0x85 + ((pdo_numb-1)*4), Buffer, 4);
+
+  memcpy(&_pdoShadow[(pdo_numb-1)*4], Buffer, 4);
+  _shadowValid |= SHADOW_PDO(pdo_numb);
+}
+
+uint8_t STUSB4500::writePdoRegisters(const uint8_t pdoRegisters[12], uint8_t pdoNumber)
+{
+  uint8_t Buffer[12];
+
+  //DPM_SNK_PDO1-3 (0x85-0x90) in one burst, DPM_PDO_NUMB (0x70) is not contiguous
+  memcpy(Buffer, pdoRegisters, 12);
+  uint8_t error = I2C_Write_USB_PD(DPM_SNK_PDO1, Buffer, 12);
+  if(error != 0) return error;
+  memcpy(_pdoShadow, pdoRegisters, 12);
+  _shadowValid |= SHADOW_PDO(1) | SHADOW_PDO(2) | SHADOW_PDO(3);
+
+  Buffer[0] = pdoNumber;
+  error = I2C_Write_USB_PD(DPM_PDO_NUMB, Buffer, 1);
+  if(error != 0) return error;
+  _pdoNumberShadow = pdoNumber;
+  _shadowValid |= SHADOW_PDO_NUMB;
+
+  return 0;
 }
 
-uint8_t STUSB4500::CUST_EnterWriteMode(unsigned char ErasedSector)
+uint8_t STUSB4500::CUST_EnterWriteMode(unsigned char ErasedSector, uint16_t pollDelay)
 {
   uint8_t Buffer[1];
   
@@ -562,7 +889,7 @@ uint8_t STUSB4500::CUST_EnterWriteMode(unsigned char ErasedSector)
   
   do 
   {
-      delay(500);
+      delay(pollDelay);
       if ( I2C_Read_USB_PD(FTP_CTRL_0,Buffer,1) != 0 )return -1; /* Wait for execution */
   }
   while(Buffer[0] & FTP_CUST_REQ); 
@@ -594,6 +921,49 @@ uint8_t STUSB4500::CUST_EnterWriteMode(unsigned char ErasedSector)
   return 0;
 }
 
+uint8_t STUSB4500::CUST_ReadSectors(uint8_t image[][8])
+{
+  uint8_t Buffer[1];
+
+  //-Enter Read Mode
+  //-Read Sector[x][-]
+  //---------------------------------
+  //Enter Read Mode
+  Buffer[0]=FTP_CUST_PASSWORD;  /* Set Password 0x95->0x47*/
+  if ( I2C_Write_USB_PD(FTP_CUST_PASSWORD_REG,Buffer,1) != 0 )return -1;
+
+  //The password is set: leave the test mode on every error below
+  Buffer[0]= 0; /* NVM internal controller reset 0x96->0x00*/
+  if ( I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; }
+  
+  Buffer[0]= FTP_CUST_PWR | FTP_CUST_RST_N; /* Set PWR and RST_N bits 0x96->0xC0*/
+  if ( I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; }
+
+  //--- End of CUST_EnterReadMode
+
+  for(uint8_t i=0;i<5;i++)
+  {
+    Buffer[0]= FTP_CUST_PWR | FTP_CUST_RST_N; /* Set PWR and RST_N bits 0x96->0xC0*/
+    if ( I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; }
+
+    Buffer[0]= (READ & FTP_CUST_OPCODE);  /* Set Read Sectors Opcode 0x97->0x00*/
+    if ( I2C_Write_USB_PD(FTP_CTRL_1,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; }
+
+    Buffer[0]= (i & FTP_CUST_SECT) |FTP_CUST_PWR |FTP_CUST_RST_N | FTP_CUST_REQ;
+    if ( I2C_Write_USB_PD(FTP_CTRL_0,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; } /* Load Read Sectors Opcode */
+
+    do 
+    {
+      if ( I2C_Read_USB_PD(FTP_CTRL_0,Buffer,1) != 0 ) { CUST_ExitTestMode(); return -1; } /* Wait for execution */
+    }
+    while(Buffer[0] & FTP_CUST_REQ); //The FTP_CUST_REQ is cleared by NVM controller when the operation is finished.
+
+    if ( I2C_Read_USB_PD(RW_BUFFER,&image[i][0],8) != 0 ) { CUST_ExitTestMode(); return -1; }
+  }
+  
+  return CUST_ExitTestMode();
+}
+
 uint8_t STUSB4500::CUST_ExitTestMode(void)
 {
   uint8_t Buffer[2];
@@ -648,7 +1018,7 @@ uint8_t STUSB4500::CUST_WriteSector(char SectorNum, unsigned char *SectorData)
   return 0;
 }
 
-uint8_t STUSB4500::I2C_Write_USB_PD(uint16_t Register ,uint8_t *DataW ,uint16_t Length)
+uint8_t STUSB4500::I2C_Write_USB_PD(uint16_t Register ,uint8_t *DataW ,uint16_t Length, bool settle)
 {
   uint8_t error=0;
   _i2cPort->beginTransmission(_deviceAddress);
@@ -658,7 +1028,10 @@ uint8_t STUSB4500::I2C_Write_USB_PD(uint16_t Register ,uint8_t *DataW ,uint16_t
     _i2cPort->write(*(DataW+i));
   }
   error = _i2cPort->endTransmission();
-  delay(1);
+  _transactionCount++;
+  _byteCount += 2 + Length; //Address, register, data
+  if(_trace != NULL) _trace->record(false, Register, DataW, Length, error);
+  if(settle) delay(1);
 
   return error;  
 }
@@ -667,14 +1040,18 @@ uint8_t STUSB4500::I2C_Read_USB_PD(uint16_t Register ,uint8_t *DataR ,uint16_t L
 {   
   _i2cPort->beginTransmission(_deviceAddress);
   _i2cPort->write(Register);
-  _i2cPort->endTransmission();
-  _i2cPort->requestFrom(_deviceAddress,Length);
+  uint8_t error = _i2cPort->endTransmission();
+  uint8_t received = _i2cPort->requestFrom(_deviceAddress,Length);
+  if(error == 0 && received < Length) error = 4; //NACK or short read, the missing bytes read as 0xFF
+  _transactionCount += 2;
+  _byteCount += 3 + Length; //Address, register, then address, data
   uint8_t tempData[Length];
   for(uint16_t i=0;i<Length;i++)
   {
     tempData[i] = _i2cPort->read();
   }
   memcpy(DataR,tempData,Length);
+  if(_trace != NULL) _trace->record(true, Register, DataR, Length, error);
   
-  return 0;
+  return error;
 }
@@ -29,10 +29,95 @@
 
 #include <Wire.h>
 #include "stusb4500_register_map.h"
+#include "stusb4500_nvm_fields.h"
+#include "stusb4500_config.h"
+#include "stusb4500_nvm_image.h"
 
+/*
+  Snapshot of the STUSB4500 status registers, ALERT_STATUS_1 (0x0B) through
+  PRT_STATUS (0x16), as returned by STUSB4500::readStatus(). The raw register
+  bytes are kept in reg[] in address order and decoded by the accessors below.
+  Note: the transition registers (PORT_STATUS_0, TYPEC_MONITORING_STATUS_0, PRT_STATUS,
+  etc.) are cleared by the read, so a snapshot reflects the events since the last
+  readStatus().
+*/
+struct STUSB4500_Status {
+  uint8_t  reg[STATUS_WINDOW_LENGTH];
+  uint32_t readTime; //Duration of the I2C burst in microseconds
+
+  uint8_t alertStatus(void) const       { return reg[ALERT_STATUS_1 - ALERT_STATUS_1]; }
+  uint8_t alertMask(void) const         { return reg[ALERT_STATUS_1_MASK - ALERT_STATUS_1]; }
+
+  // PORT_STATUS_0 / PORT_STATUS_1
+  bool    attachTransition(void) const  { return reg[PORT_STATUS_0 - ALERT_STATUS_1] & 0x01; }
+  bool    attached(void) const          { return reg[PORT_STATUS_1 - ALERT_STATUS_1] & 0x01; }
+  uint8_t attachMode(void) const        { return (reg[PORT_STATUS_1 - ALERT_STATUS_1] & 0xE0) >> 5; }
+
+  // TYPEC_MONITORING_STATUS_0 / TYPEC_MONITORING_STATUS_1
+  bool    vbusTransition(void) const    { return reg[TYPEC_MONITORING_STATUS_0 - ALERT_STATUS_1] & 0x0E; }
+  bool    vbusLow(void) const           { return reg[TYPEC_MONITORING_STATUS_0 - ALERT_STATUS_1] & 0x10; }
+  bool    vbusHigh(void) const          { return reg[TYPEC_MONITORING_STATUS_0 - ALERT_STATUS_1] & 0x20; }
+  bool    vbusValid(void) const         { return reg[TYPEC_MONITORING_STATUS_1 - ALERT_STATUS_1] & 0x02; }
+  bool    vbusSafe0V(void) const        { return reg[TYPEC_MONITORING_STATUS_1 - ALERT_STATUS_1] & 0x04; }
+  bool    vbusReady(void) const         { return reg[TYPEC_MONITORING_STATUS_1 - ALERT_STATUS_1] & 0x08; }
+
+  // CC_STATUS
+  uint8_t cc1State(void) const          { return reg[CC_STATUS - ALERT_STATUS_1] & 0x03; }
+  uint8_t cc2State(void) const          { return (reg[CC_STATUS - ALERT_STATUS_1] & 0x0C) >> 2; }
+  bool    connectResult(void) const     { return reg[CC_STATUS - ALERT_STATUS_1] & 0x10; }
+  bool    lookingForConnection(void) const { return reg[CC_STATUS - ALERT_STATUS_1] & 0x20; }
+
+  // CC_HW_FAULT_STATUS_0 / CC_HW_FAULT_STATUS_1
+  bool    hwFault(void) const           { return (reg[CC_HW_FAULT_STATUS_0 - ALERT_STATUS_1] & 0xF0) ||
+                                                 (reg[CC_HW_FAULT_STATUS_1 - ALERT_STATUS_1] & 0x80); }
+
+  // PD_TYPEC_STATUS / TYPEC_STATUS / PRT_STATUS
+  uint8_t pdTypecHandCheck(void) const  { return reg[PD_TYPEC_STATUS - ALERT_STATUS_1] & 0x0F; }
+  uint8_t typecFsmState(void) const     { return reg[TYPEC_STATUS - ALERT_STATUS_1] & 0x1F; }
+  bool    ccReversed(void) const        { return reg[TYPEC_STATUS - ALERT_STATUS_1] & 0x80; }
+  bool    hardResetReceived(void) const { return reg[PRT_STATUS - ALERT_STATUS_1] & 0x01; }
+  bool    messageReceived(void) const   { return reg[PRT_STATUS - ALERT_STATUS_1] & 0x04; }
+};
+
+/*
+  Problems found by STUSB4500::validate() in the pending configuration.
+  Codes with VALIDATION_ERROR set make write() refuse to program the NVM,
+  the others are warnings about values that will be clamped or rounded.
+*/
+#define VALIDATION_ERROR             0x80
+#define VALIDATION_VOLTAGE_CLAMPED   0x01  //PDO voltage outside 5-20V, will be clamped
+#define VALIDATION_CURRENT_CLAMPED   0x02  //PDO current above 5A, will be clamped
+#define VALIDATION_CURRENT_ROUNDED   0x03  //PDO current not a valid NVM step, will be rounded down
+#define VALIDATION_CURRENT_USES_FLEX 0x04  //PDO current below 0.5A, will be saved as "use FLEX_I"
+#define VALIDATION_OVLO_ABOVE_MAX    0x05  //Voltage + OVLO margin above 22V (20V PDO with the default 10%)
+#define VALIDATION_PDO_ORDER         (VALIDATION_ERROR | 0x06) //PDO3 voltage lower than PDO2, once both are clamped
+#define VALIDATION_FLEX_CURRENT_ZERO (VALIDATION_ERROR | 0x07) //PDO uses FLEX_I but FLEX_I is 0A
+#define VALIDATION_BUS_ERROR         (VALIDATION_ERROR | 0x08) //The PDO registers could not be read (pdo is 0)
+
+#define VALIDATION_MAX_ISSUES        8
+
+struct STUSB4500_Validation {
+  uint8_t errors;
+  uint8_t warnings;
+  uint8_t count;                       //Issues saved below (at most VALIDATION_MAX_ISSUES)
+  uint8_t code[VALIDATION_MAX_ISSUES]; //VALIDATION_* code
+  uint8_t pdo[VALIDATION_MAX_ISSUES];  //PDO the issue applies to (1-3)
+
+  bool ok(void) const { return errors == 0; }
+};
+
+//Return values of write()
+#define NVM_WRITE_OK           0
+#define NVM_WRITE_WARNINGS     1  //Written, but some values were clamped or rounded
+#define NVM_WRITE_REFUSED      2  //Not written, the configuration has errors
+#define NVM_WRITE_BUS_ERROR    3  //Not written, the PDO registers could not be read
+
+class STUSB4500_Trace;
 
 class STUSB4500 {
   public:
+  STUSB4500(void);
+
   /*
     Initializes the I2C bus. If the device ID is configured for a address other than the default
 	it should be intialized here. Valid IDs are 0x28 (default), 0x29, 0x2A, and 0x2B. If another
@@ -42,14 +127,42 @@ class STUSB4500 {
   
   /*
     Reads the NVM memory from the STUSB4500
+	If an I2C transaction fails, the local copy of the NVM is left unchanged, and the
+	STUSB4500 is taken out of the NVM test mode.
   */
   void read(void);
   
   /*
     Write NVM settings to the STUSB4500. Optional: Passing a 255 value to the function will write
 	the default NVM values to the STUSB4500.
+	The configuration is checked with validate() before anything is erased. Returns
+	NVM_WRITE_OK, NVM_WRITE_WARNINGS if values were clamped or rounded,
+	NVM_WRITE_REFUSED if the configuration has errors, or NVM_WRITE_BUS_ERROR if the
+	PDO registers could not be read or no read() of the NVM has succeeded yet. The NVM
+	is left untouched in the last two cases.
   */
-  void write(uint8_t defaultVals = 0);
+  uint8_t write(uint8_t defaultVals = 0);
+
+  /*
+    Checks the configuration write() would program (the local copy of the NVM and the
+	volatile PDO registers) without touching the NVM.
+	Parameter: result - list of the problems found, see VALIDATION_*. If the PDO
+	                    registers could not be read it holds VALIDATION_BUS_ERROR only.
+	Returns the number of errors.
+  */
+  uint8_t validate(STUSB4500_Validation &result);
+
+  /*
+    Enables or disables the check done by write() (enabled by default).
+  */
+  void setWriteValidation(bool enable);
+
+  /*
+    Programs a complete NVM image, typically built at compile time with
+	STUSB4500_NvmImage (see stusb4500_nvm_image.h), and updates the local copy of the NVM.
+	Unlike write(), the volatile PDO registers are not used.
+  */
+  void writeImage(const STUSB4500_NvmImage &image);
   
   /*
     Returns the voltage stored for the three power data objects (PDO).
@@ -369,23 +482,202 @@ class STUSB4500 {
   */
   void softReset( void );
 
-  
+  /*
+    Reads the attach, CC, monitoring and PD protocol status registers (0x0B to 0x16)
+	in a single I2C burst.
+	Parameter: status - the snapshot to fill, see STUSB4500_Status for the decoded fields.
+	Returns 0 on success, or the I2C error: the endTransmission() error of setting the
+	register address, or 4 if the STUSB4500 sent fewer bytes than requested. On an error
+	the content of status.reg is not valid. The duration of the burst is saved in
+	status.readTime.
+	The events seen by peekStatus() since the last readStatus() are included.
+  */
+  uint8_t readStatus(STUSB4500_Status &status);
+
+  /*
+    Same as readStatus() but leaves the events to the next readStatus(), for
+	observers such as STUSB4500_Telemetry that must not consume them. The registers
+	are still cleared by the read, which releases ALERT: the events are kept by the
+	library until readStatus() returns them.
+  */
+  uint8_t peekStatus(STUSB4500_Status &status);
+
+  /*
+    Bus usage counters, useful to measure the cost of the library functions.
+	getTransactionCount() - number of I2C transactions (START to STOP). A register
+	                        read counts as two: setting the register address, then the read.
+	getByteCount()        - number of bytes clocked on the bus, including the address
+	                        and register bytes. At a bus speed of f Hz one byte takes
+	                        about 9/f seconds.
+  */
+  uint32_t getTransactionCount(void);
+  uint32_t getByteCount(void);
+  void clearBusStatistics(void);
+
+  /*
+    Puts the library in an idle state. While idle, the periodic helpers (e.g.
+	STUSB4500_Telemetry::update() and the reset detection of update()) make no I2C
+	transactions. Functions called directly, and the deferred auto-commit of pending
+	changes, still access the bus. See STUSB4500_Supervisor for ALERT driven wake ups.
+  */
+  void setIdle(bool idle);
+  bool isIdle(void);
+
+  /*
+    Enables the deferred auto-commit. Changes to the local copy of the NVM (setFlexCurrent(),
+	setUpperVoltageLimit(), set<F>(), writeConfig(), ...) are accumulated and saved with a
+	single write() from update(), instead of one NVM erase/program cycle per change.
+	Parameter: quietPeriod - time in ms without any change before the changes are saved.
+	                         0 disables the auto-commit (default).
+	           maxLatency  - time in ms after the first unsaved change after which the changes
+	                         are saved even if more keep coming.
+	Note: the changes are also saved while the library is idle (see setIdle()).
+	If write() refuses the configuration, it is not retried until the next change.
+  */
+  void setAutoCommit(uint16_t quietPeriod, uint16_t maxLatency = 5000);
+
+  /*
+    Call from loop() when the auto-commit or the reset detection is enabled. Runs the
+	deferred write() and the volatile state check when they are due. While the library is
+	idle only the deferred write() runs, STUSB4500_Supervisor::wake() does the check.
+	Returns true if the NVM was written or the volatile PDOs were re-applied.
+  */
+  bool update(void);
+
+  /*
+    Auto-commit counters.
+	getCommitCount()   - number of NVM writes done by update().
+	getCommitsSaved()  - number of NVM writes avoided by saving several changes at once.
+	getRefusedCommits() - number of deferred writes refused by write().
+  */
+  uint32_t getCommitCount(void);
+  uint32_t getCommitsSaved(void);
+  uint32_t getRefusedCommits(void);
+
+  /*
+    Enables the detection of STUSB4500 resets. The PDO voltages, currents and number set
+	with setVoltage(), setCurrent(), setPdoNumber() or writeConfig() only live in volatile
+	registers, which are reloaded from the NVM when the chip resets or browns out. update()
+	reads the PDO registers (two register reads, 13 data bytes) every period and compares them
+	with the values the library wrote. On a mismatch the values are written back in one
+	burst and a soft reset renegotiates the contract. While a STUSB4500_Supervisor keeps the
+	library idle, the check runs on each of its wake ups instead.
+	Parameter: period - time in ms between two checks. 0 disables the detection (default).
+  */
+  void setResetDetection(uint16_t period);
+
+  /*
+    Reset detection counters.
+	getCheckCount()   - number of checks done by update().
+	getResetCount()   - number of resets detected and recovered.
+	getRecoveryTime() - duration of the last recovery in microseconds, from the detection
+	                    to the renegotiation request.
+  */
+  uint32_t getCheckCount(void);
+  uint32_t getResetCount(void);
+  uint32_t getRecoveryTime(void);
+
+  /*
+    Generic access to an NVM parameter of the local copy of the NVM, using one of the
+	field descriptors from stusb4500_nvm_fields.h. The value is the raw field value.
+	E.g. usb.get<NVM_GPIO_CFG>(), usb.set<NVM_I_SNK_PDO_FLEX>(150)
+	Note: write() needs to be called to save the changes to the NVM.
+  */
+  template<class Field> uint16_t get(void)
+  {
+    return nvmGet<Field>(sector);
+  }
+
+  template<class Field> void set(uint16_t value)
+  {
+    nvmSet<Field>(sector, value);
+    _dirtySectors |= (1<<Field::sector);
+    markChanged();
+  }
+
+  /*
+    Returns the sectors of the local copy of the NVM that were modified since the last
+	read() or write(). Bit 0 is sector 0, the same format as the SECTOR_x values.
+  */
+  uint8_t getDirtySectors(void);
+
+  /*
+    Reads every parameter into a STUSB4500_Config in one pass. NVM parameters come from
+	the local copy of the NVM, the PDO voltages, currents and number from the volatile
+	registers (one burst read of the three PDOs plus DPM_PDO_NUMB).
+	Returns 0 on success, or the I2C error of reading the PDO registers. On an error
+	the PDO fields of config are left unchanged.
+  */
+  uint8_t readConfig(STUSB4500_Config &config);
+
+  /*
+    Applies every parameter of a STUSB4500_Config in one pass: NVM parameters to the local
+	copy of the NVM, PDO voltages, currents and number to the volatile registers (one burst
+	write of the three PDOs plus DPM_PDO_NUMB).
+	Note: write() needs to be called to save the NVM parameters, and softReset() to
+	renegotiate with the new PDOs.
+	Returns 0 on success, or the I2C error of reading the PDO registers, in which case
+	nothing is changed.
+  */
+  uint8_t writeConfig(const STUSB4500_Config &config);
+
+
   private:
+  friend class STUSB4500_Telemetry;
+  friend class STUSB4500_NegotiationProfiler;
+  friend class STUSB4500_Trace;
+  friend class STUSB4500_SafeUpdate;
+  friend class STUSB4500_NvmJob;
+  friend class STUSB4500_NvmScheduler;
+  friend class STUSB4500_Supervisor;
+  friend class STUSB4500_PowerBudget;
+  friend class STUSB4500_ProfileTable;
   
   uint8_t sector[5][8];
   bool readSectors;
+  uint8_t _dirtySectors;
+  bool _validateWrites;
+  bool _idle;
+  uint16_t _quietPeriod;
+  uint16_t _maxLatency;
+  uint16_t _pendingChanges;
+  uint32_t _firstChange;
+  uint32_t _lastChange;
+  uint32_t _commitCount;
+  uint32_t _commitsSaved;
+  uint32_t _refusedCommits;
+  uint8_t _pdoShadow[12];    //Last values written to DPM_SNK_PDO1-3
+  uint8_t _pdoNumberShadow;  //Last value written to DPM_PDO_NUMB
+  uint8_t _shadowValid;
+  uint16_t _checkPeriod;
+  uint32_t _lastCheck;
+  uint32_t _checkCount;
+  uint32_t _resetCount;
+  uint32_t _recoveryTime;
+  uint8_t _statusEvents[STATUS_WINDOW_LENGTH]; //Events read by peekStatus(), not yet returned by readStatus()
 
   //I-squared-C Class
   TwoWire *_i2cPort; //The generic connection to user's chosen I2C hardware
   //Variables
   uint8_t _deviceAddress;
+  uint32_t _transactionCount;
+  uint32_t _byteCount;
+  STUSB4500_Trace *_trace; //Optional transaction recorder, see STUSB4500_Trace.h
   
   uint32_t readPDO(uint8_t pdo_numb);
+  uint8_t stageWrite(void);
+  void markChanged(void);
+  bool commitChanges(void);
+  bool checkVolatileState(void);
+  void checkConfig(const uint8_t pdoRegisters[12], uint8_t pdoNumber, STUSB4500_Validation &result);
+  static uint8_t nvmCurrentFromPdo(uint32_t pdoData);
   void writePDO(uint8_t pdo_numb, uint32_t pdoData);
-  uint8_t CUST_EnterWriteMode(unsigned char ErasedSector);
+  uint8_t writePdoRegisters(const uint8_t pdoRegisters[12], uint8_t pdoNumber);
+  uint8_t CUST_EnterWriteMode(unsigned char ErasedSector, uint16_t pollDelay = 500);
+  uint8_t CUST_ReadSectors(uint8_t image[][8]);
   uint8_t CUST_ExitTestMode(void);
   uint8_t CUST_WriteSector(char SectorNum, unsigned char *SectorData);
-  uint8_t I2C_Write_USB_PD(uint16_t Register ,uint8_t *DataW ,uint16_t Length);
+  uint8_t I2C_Write_USB_PD(uint16_t Register ,uint8_t *DataW ,uint16_t Length, bool settle = true); //settle: wait 1ms after the write
   uint8_t I2C_Read_USB_PD(uint16_t Register ,uint8_t *DataR ,uint16_t Length);
 };
 
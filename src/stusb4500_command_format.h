@@ -0,0 +1,178 @@
+/*
+  Frame format of the STUSB4500_CommandProtocol serial command protocol.
+
+  This header has no Arduino dependencies so the same definitions can be
+  compiled into a host-side (PC) client.
+
+  Frame layout (multi-byte values are little-endian):
+    byte  0     - COMMAND_SYNC
+    byte  1     - sequence number, echoed in the response
+    byte  2     - payload length (at most COMMAND_MAX_PAYLOAD)
+    bytes 3-... - payload
+    last byte   - CRC-8 (polynomial 0x07) of every byte before it
+
+  Request payload:
+    byte  0     - COMMAND_FLAG_* bits
+    then, for each parameter to change, 3 bytes: COMMAND_PARAM_* id, value (16-bit)
+  The parameters are applied together as one staged update, then the NVM is
+  written and/or the STUSB4500 soft reset if requested. If any id is unknown,
+  or any value is outside the range given by commandParamRange(), nothing is
+  applied.
+
+  Response payload:
+    byte  0     - COMMAND_OK or COMMAND_ERROR_*
+    byte  1     - number of parameters applied, or index of the rejected one
+    byte  2     - result of write() (NVM_WRITE_*), COMMAND_NOT_WRITTEN if not requested
+    bytes 3-6   - time to apply the parameters in microseconds
+    bytes 7-10  - time taken by write() and softReset() in milliseconds
+    then, with COMMAND_FLAG_READ, 3 bytes per parameter (id, value) for every parameter
+
+  Values use the units of STUSB4500_Config: 50mV for voltages, 10mA for currents,
+  percent for the voltage limits.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_COMMAND_FORMAT_H
+#define STUSB4500_COMMAND_FORMAT_H
+
+#include <stdint.h>
+#include "stusb4500_config.h"
+#include "stusb4500_telemetry_format.h"
+
+#define COMMAND_SYNC                0xC5
+#define COMMAND_HEADER_LENGTH       3
+#define COMMAND_MAX_PAYLOAD         96
+#define COMMAND_RESPONSE_LENGTH     11    //Response payload without the parameters
+
+#define COMMAND_FLAG_WRITE          0x01  //Save to the NVM with write()
+#define COMMAND_FLAG_SOFT_RESET     0x02  //Renegotiate with softReset()
+#define COMMAND_FLAG_READ           0x04  //Return every parameter in the response
+
+#define COMMAND_OK                  0
+#define COMMAND_ERROR_FRAME         1     //Bad CRC or length
+#define COMMAND_ERROR_PARAM         2     //Unknown parameter id or value out of range
+#define COMMAND_ERROR_WRITE         3     //write() refused the configuration or failed to read it
+#define COMMAND_NOT_WRITTEN         0xFF
+
+#define COMMAND_PARAM_VOLTAGE1      0x01  //PDO1-3 voltage, 50mV
+#define COMMAND_PARAM_VOLTAGE2      0x02
+#define COMMAND_PARAM_VOLTAGE3      0x03
+#define COMMAND_PARAM_CURRENT1      0x04  //PDO1-3 current, 10mA
+#define COMMAND_PARAM_CURRENT2      0x05
+#define COMMAND_PARAM_CURRENT3      0x06
+#define COMMAND_PARAM_FLEX_CURRENT  0x07  //10mA
+#define COMMAND_PARAM_PDO_NUMBER    0x08
+#define COMMAND_PARAM_UPPER_LIMIT1  0x09  //PDO1-3 OVLO, percent
+#define COMMAND_PARAM_UPPER_LIMIT2  0x0A
+#define COMMAND_PARAM_UPPER_LIMIT3  0x0B
+#define COMMAND_PARAM_LOWER_LIMIT1  0x0C  //PDO1-3 UVLO, percent
+#define COMMAND_PARAM_LOWER_LIMIT2  0x0D
+#define COMMAND_PARAM_LOWER_LIMIT3  0x0E
+#define COMMAND_PARAM_EXTERNAL_POWER    0x0F
+#define COMMAND_PARAM_USB_COMM_CAPABLE  0x10
+#define COMMAND_PARAM_CONFIG_OK_GPIO    0x11
+#define COMMAND_PARAM_GPIO_CTRL         0x12
+#define COMMAND_PARAM_POWER_ABOVE_5V    0x13
+#define COMMAND_PARAM_REQ_SRC_CURRENT   0x14
+#define COMMAND_PARAM_COUNT         0x14
+
+/*
+  Text names of the parameters, in COMMAND_PARAM_* order, and the unit of the text
+  value (mV or mA) in the protocol's units. Used by the text mode and the PC client.
+*/
+struct CommandParamText {
+  char name[9];
+  uint8_t scale;
+};
+
+static const CommandParamText commandParamText[COMMAND_PARAM_COUNT] = {
+  {"v1", 50}, {"v2", 50}, {"v3", 50},
+  {"i1", 10}, {"i2", 10}, {"i3", 10},
+  {"flex", 10}, {"pdos", 1},
+  {"ovlo1", 1}, {"ovlo2", 1}, {"ovlo3", 1},
+  {"uvlo1", 1}, {"uvlo2", 1}, {"uvlo3", 1},
+  {"extpower", 1}, {"usbcomm", 1}, {"okgpio", 1}, {"gpioctrl", 1}, {"above5v", 1}, {"reqsrc", 1},
+};
+
+/*
+  Valid values of a parameter, in the units of STUSB4500_Config. PDO1 is fixed at
+  5V and has no UVLO. Returns false for an unknown id.
+*/
+inline bool commandParamRange(uint8_t id, uint16_t &minimum, uint16_t &maximum)
+{
+  if(id == COMMAND_PARAM_VOLTAGE1)                                           { minimum = 100; maximum = 100; }
+  else if(id >= COMMAND_PARAM_VOLTAGE2 && id <= COMMAND_PARAM_VOLTAGE3)      { minimum = 100; maximum = 400; }
+  else if(id >= COMMAND_PARAM_CURRENT1 && id <= COMMAND_PARAM_FLEX_CURRENT)  { minimum = 0;   maximum = 500; }
+  else if(id == COMMAND_PARAM_PDO_NUMBER)                                    { minimum = 1;   maximum = 3; }
+  else if(id == COMMAND_PARAM_LOWER_LIMIT1)                                  { minimum = 0;   maximum = 0; }
+  else if(id >= COMMAND_PARAM_UPPER_LIMIT1 && id <= COMMAND_PARAM_LOWER_LIMIT3) { minimum = 5; maximum = 20; }
+  else if(id == COMMAND_PARAM_CONFIG_OK_GPIO || id == COMMAND_PARAM_GPIO_CTRL) { minimum = 0;  maximum = 3; }
+  else if(id >= COMMAND_PARAM_EXTERNAL_POWER && id <= COMMAND_PARAM_COUNT)   { minimum = 0;   maximum = 1; }
+  else return false;
+
+  return true;
+}
+
+/*
+  Sets or gets a parameter of a configuration by id. commandSetParam() returns false
+  for an unknown id or a value out of range, commandGetParam() for an unknown id.
+*/
+inline bool commandSetParam(STUSB4500_Config &config, uint8_t id, uint16_t value)
+{
+  uint16_t minimum, maximum;
+  if(!commandParamRange(id, minimum, maximum) || value < minimum || value > maximum) return false;
+
+  if(id >= COMMAND_PARAM_VOLTAGE1 && id <= COMMAND_PARAM_VOLTAGE3)           config.voltage[id - COMMAND_PARAM_VOLTAGE1] = value;
+  else if(id >= COMMAND_PARAM_CURRENT1 && id <= COMMAND_PARAM_CURRENT3)      config.current[id - COMMAND_PARAM_CURRENT1] = value;
+  else if(id == COMMAND_PARAM_FLEX_CURRENT)                                  config.flexCurrent = value;
+  else if(id == COMMAND_PARAM_PDO_NUMBER)                                    config.pdoNumber = value;
+  else if(id >= COMMAND_PARAM_UPPER_LIMIT1 && id <= COMMAND_PARAM_UPPER_LIMIT3) config.upperVoltageLimit[id - COMMAND_PARAM_UPPER_LIMIT1] = value;
+  else if(id >= COMMAND_PARAM_LOWER_LIMIT1 && id <= COMMAND_PARAM_LOWER_LIMIT3) config.lowerVoltageLimit[id - COMMAND_PARAM_LOWER_LIMIT1] = value;
+  else if(id == COMMAND_PARAM_EXTERNAL_POWER)                                config.externalPower = value;
+  else if(id == COMMAND_PARAM_USB_COMM_CAPABLE)                              config.usbCommCapable = value;
+  else if(id == COMMAND_PARAM_CONFIG_OK_GPIO)                                config.configOkGpio = value;
+  else if(id == COMMAND_PARAM_GPIO_CTRL)                                     config.gpioCtrl = value;
+  else if(id == COMMAND_PARAM_POWER_ABOVE_5V)                                config.powerAbove5vOnly = value;
+  else if(id == COMMAND_PARAM_REQ_SRC_CURRENT)                               config.reqSrcCurrent = value;
+  else return false;
+
+  return true;
+}
+
+inline bool commandGetParam(const STUSB4500_Config &config, uint8_t id, uint16_t &value)
+{
+  if(id >= COMMAND_PARAM_VOLTAGE1 && id <= COMMAND_PARAM_VOLTAGE3)           value = config.voltage[id - COMMAND_PARAM_VOLTAGE1];
+  else if(id >= COMMAND_PARAM_CURRENT1 && id <= COMMAND_PARAM_CURRENT3)      value = config.current[id - COMMAND_PARAM_CURRENT1];
+  else if(id == COMMAND_PARAM_FLEX_CURRENT)                                  value = config.flexCurrent;
+  else if(id == COMMAND_PARAM_PDO_NUMBER)                                    value = config.pdoNumber;
+  else if(id >= COMMAND_PARAM_UPPER_LIMIT1 && id <= COMMAND_PARAM_UPPER_LIMIT3) value = config.upperVoltageLimit[id - COMMAND_PARAM_UPPER_LIMIT1];
+  else if(id >= COMMAND_PARAM_LOWER_LIMIT1 && id <= COMMAND_PARAM_LOWER_LIMIT3) value = config.lowerVoltageLimit[id - COMMAND_PARAM_LOWER_LIMIT1];
+  else if(id == COMMAND_PARAM_EXTERNAL_POWER)                                value = config.externalPower;
+  else if(id == COMMAND_PARAM_USB_COMM_CAPABLE)                              value = config.usbCommCapable;
+  else if(id == COMMAND_PARAM_CONFIG_OK_GPIO)                                value = config.configOkGpio;
+  else if(id == COMMAND_PARAM_GPIO_CTRL)                                     value = config.gpioCtrl;
+  else if(id == COMMAND_PARAM_POWER_ABOVE_5V)                                value = config.powerAbove5vOnly;
+  else if(id == COMMAND_PARAM_REQ_SRC_CURRENT)                               value = config.reqSrcCurrent;
+  else return false;
+
+  return true;
+}
+
+/*
+  Builds a complete frame (header, payload and CRC) into frame, which must hold
+  COMMAND_HEADER_LENGTH + length + 1 bytes. Returns the frame length.
+*/
+inline uint8_t commandFrame(uint8_t *frame, uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+  frame[0] = COMMAND_SYNC;
+  frame[1] = sequence;
+  frame[2] = length;
+  memcpy(&frame[COMMAND_HEADER_LENGTH], payload, length);
+  frame[COMMAND_HEADER_LENGTH + length] = telemetryCrc8(frame, COMMAND_HEADER_LENGTH + length);
+
+  return COMMAND_HEADER_LENGTH + length + 1;
+}
+
+#endif
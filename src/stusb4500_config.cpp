@@ -0,0 +1,137 @@
+/*
+  Decoded STUSB4500 configuration.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#include "stusb4500_config.h"
+
+static uint8_t clampPercent(uint8_t value)
+{
+  if(value < 5) return 5;
+  if(value > 20) return 20;
+  return value;
+}
+
+static uint16_t clampVoltage(uint16_t value)
+{
+  //5-20V in 50mV units
+  if(value < 100) return 100;
+  if(value > 400) return 400;
+  return value;
+}
+
+void STUSB4500_Config::decode(const uint8_t image[][8])
+{
+  memset(this, 0, sizeof(STUSB4500_Config));
+
+  voltage[0] = 100; //PDO1 is fixed at 5V
+  voltage[1] = nvmGet<NVM_V_SNK_PDO2>(image);
+  voltage[2] = nvmGet<NVM_V_SNK_PDO3>(image);
+
+  current[0] = nvmCurrentValue(nvmGet<NVM_I_SNK_PDO1>(image));
+  current[1] = nvmCurrentValue(nvmGet<NVM_I_SNK_PDO2>(image));
+  current[2] = nvmCurrentValue(nvmGet<NVM_I_SNK_PDO3>(image));
+
+  flexCurrent = nvmGet<NVM_I_SNK_PDO_FLEX>(image);
+  pdoNumber = nvmGet<NVM_SNK_PDO_NUMB>(image);
+
+  upperVoltageLimit[0] = nvmGet<NVM_SHIFT_VBUS_HL1>(image) + 5;
+  upperVoltageLimit[1] = nvmGet<NVM_SHIFT_VBUS_HL2>(image) + 5;
+  upperVoltageLimit[2] = nvmGet<NVM_SHIFT_VBUS_HL3>(image) + 5;
+
+  lowerVoltageLimit[0] = 0; //PDO1 has a fixed threshold of 3.3V
+  lowerVoltageLimit[1] = nvmGet<NVM_SHIFT_VBUS_LL2>(image) + 5;
+  lowerVoltageLimit[2] = nvmGet<NVM_SHIFT_VBUS_LL3>(image) + 5;
+
+  externalPower    = nvmGet<NVM_SNK_UNCONS_POWER>(image);
+  usbCommCapable   = nvmGet<NVM_USB_COMM_CAPABLE>(image);
+  configOkGpio     = nvmGet<NVM_POWER_OK_CFG>(image);
+  gpioCtrl         = nvmGet<NVM_GPIO_CFG>(image);
+  powerAbove5vOnly = nvmGet<NVM_POWER_ONLY_ABOVE_5V>(image);
+  reqSrcCurrent    = nvmGet<NVM_REQ_SRC_CURRENT>(image);
+}
+
+void STUSB4500_Config::decodePdos(const uint8_t pdoRegisters[12], uint8_t pdoNumb)
+{
+  for(uint8_t i=0; i<3; i++)
+  {
+    uint32_t pdoData = (uint32_t)pdoRegisters[i*4] | ((uint32_t)pdoRegisters[i*4+1]<<8) |
+                       ((uint32_t)pdoRegisters[i*4+2]<<16);
+
+    voltage[i] = (pdoData>>10) & 0x3FF; //Bits 10:19, 50mV resolution
+    current[i] = pdoData & 0x3FF;       //Bits 0:9, 10mA resolution
+  }
+
+  pdoNumber = pdoNumb & 0x07;
+}
+
+void STUSB4500_Config::encode(uint8_t image[][8]) const
+{
+  nvmSet<NVM_V_SNK_PDO2>(image, clampVoltage(voltage[1]));
+  nvmSet<NVM_V_SNK_PDO3>(image, clampVoltage(voltage[2]));
+
+  nvmSet<NVM_I_SNK_PDO1>(image, nvmCurrentCode(current[0]));
+  nvmSet<NVM_I_SNK_PDO2>(image, nvmCurrentCode(current[1]));
+  nvmSet<NVM_I_SNK_PDO3>(image, nvmCurrentCode(current[2]));
+
+  nvmSet<NVM_I_SNK_PDO_FLEX>(image, flexCurrent > 500 ? 500 : flexCurrent);
+  nvmSet<NVM_SNK_PDO_NUMB>(image, pdoNumber > 3 ? 3 : pdoNumber);
+
+  nvmSet<NVM_SHIFT_VBUS_HL1>(image, clampPercent(upperVoltageLimit[0]) - 5);
+  nvmSet<NVM_SHIFT_VBUS_HL2>(image, clampPercent(upperVoltageLimit[1]) - 5);
+  nvmSet<NVM_SHIFT_VBUS_HL3>(image, clampPercent(upperVoltageLimit[2]) - 5);
+
+  nvmSet<NVM_SHIFT_VBUS_LL2>(image, clampPercent(lowerVoltageLimit[1]) - 5);
+  nvmSet<NVM_SHIFT_VBUS_LL3>(image, clampPercent(lowerVoltageLimit[2]) - 5);
+
+  nvmSet<NVM_SNK_UNCONS_POWER>(image, externalPower != 0);
+  nvmSet<NVM_USB_COMM_CAPABLE>(image, usbCommCapable != 0);
+  nvmSet<NVM_POWER_OK_CFG>(image, configOkGpio < 2 ? 0 : configOkGpio > 3 ? 3 : configOkGpio);
+  nvmSet<NVM_GPIO_CFG>(image, gpioCtrl > 3 ? 3 : gpioCtrl);
+  nvmSet<NVM_POWER_ONLY_ABOVE_5V>(image, powerAbove5vOnly != 0);
+  nvmSet<NVM_REQ_SRC_CURRENT>(image, reqSrcCurrent != 0);
+}
+
+void STUSB4500_Config::encodePdos(uint8_t pdoRegisters[12]) const
+{
+  for(uint8_t i=0; i<3; i++)
+  {
+    uint32_t pdoData = (uint32_t)pdoRegisters[i*4] | ((uint32_t)pdoRegisters[i*4+1]<<8) |
+                       ((uint32_t)pdoRegisters[i*4+2]<<16);
+
+    uint16_t digitalVoltage = (i == 0) ? 100 : clampVoltage(voltage[i]);
+
+    pdoData &= ~0xFFFFFUL;
+    pdoData |= ((uint32_t)digitalVoltage<<10) | (current[i] & 0x3FF);
+
+    pdoRegisters[i*4]   = pdoData & 0xFF;
+    pdoRegisters[i*4+1] = (pdoData>>8) & 0xFF;
+    pdoRegisters[i*4+2] = (pdoData>>16) & 0xFF;
+  }
+}
+
+uint32_t STUSB4500_Config::diff(const STUSB4500_Config &other) const
+{
+  uint32_t mask = 0;
+
+  for(uint8_t i=0; i<3; i++)
+  {
+    if(voltage[i] != other.voltage[i])                     mask |= CONFIG_VOLTAGE(i+1);
+    if(current[i] != other.current[i])                     mask |= CONFIG_CURRENT(i+1);
+    if(upperVoltageLimit[i] != other.upperVoltageLimit[i]) mask |= CONFIG_UPPER_LIMIT(i+1);
+    if(lowerVoltageLimit[i] != other.lowerVoltageLimit[i]) mask |= CONFIG_LOWER_LIMIT(i+1);
+  }
+
+  if(flexCurrent != other.flexCurrent)           mask |= CONFIG_FLEX_CURRENT;
+  if(pdoNumber != other.pdoNumber)               mask |= CONFIG_PDO_NUMBER;
+  if(externalPower != other.externalPower)       mask |= CONFIG_EXTERNAL_POWER;
+  if(usbCommCapable != other.usbCommCapable)     mask |= CONFIG_USB_COMM_CAPABLE;
+  if(configOkGpio != other.configOkGpio)         mask |= CONFIG_CONFIG_OK_GPIO;
+  if(gpioCtrl != other.gpioCtrl)                 mask |= CONFIG_GPIO_CTRL;
+  if(powerAbove5vOnly != other.powerAbove5vOnly) mask |= CONFIG_POWER_ABOVE_5V_ONLY;
+  if(reqSrcCurrent != other.reqSrcCurrent)       mask |= CONFIG_REQ_SRC_CURRENT;
+
+  return mask;
+}
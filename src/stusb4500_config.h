@@ -0,0 +1,93 @@
+/*
+  Decoded STUSB4500 configuration.
+
+  STUSB4500_Config holds every parameter the library exposes, in integer units,
+  so it can be filled from the NVM image in one pass, written back in one
+  pass, and compared with memcmp(). It has no padding and decode() clears it
+  first, so two configurations are equal exactly when their bytes are equal.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_CONFIG_H
+#define STUSB4500_CONFIG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "stusb4500_nvm_fields.h"
+
+//Bits returned by STUSB4500_Config::diff()
+#define CONFIG_VOLTAGE(pdo)          (1UL << ((pdo)-1))     //PDO1-3
+#define CONFIG_CURRENT(pdo)          (1UL << ((pdo)+2))     //PDO1-3
+#define CONFIG_FLEX_CURRENT          (1UL << 6)
+#define CONFIG_PDO_NUMBER            (1UL << 7)
+#define CONFIG_UPPER_LIMIT(pdo)      (1UL << ((pdo)+7))     //PDO1-3
+#define CONFIG_LOWER_LIMIT(pdo)      (1UL << ((pdo)+10))    //PDO1-3
+#define CONFIG_EXTERNAL_POWER        (1UL << 14)
+#define CONFIG_USB_COMM_CAPABLE      (1UL << 15)
+#define CONFIG_CONFIG_OK_GPIO        (1UL << 16)
+#define CONFIG_GPIO_CTRL             (1UL << 17)
+#define CONFIG_POWER_ABOVE_5V_ONLY   (1UL << 18)
+#define CONFIG_REQ_SRC_CURRENT       (1UL << 19)
+
+struct STUSB4500_Config {
+  uint16_t voltage[3];            //PDO1-3 voltage, 50mV units (PDO1 is always 100 = 5V)
+  uint16_t current[3];            //PDO1-3 current, 10mA units
+  uint16_t flexCurrent;           //FLEX_I, 10mA units
+  uint8_t  pdoNumber;             //Number of sink PDOs (1-3)
+  uint8_t  upperVoltageLimit[3];  //OVLO, 5-20%
+  uint8_t  lowerVoltageLimit[3];  //UVLO, 5-20% (0 for PDO1, fixed at 3.3V)
+  uint8_t  externalPower;
+  uint8_t  usbCommCapable;
+  uint8_t  configOkGpio;
+  uint8_t  gpioCtrl;
+  uint8_t  powerAbove5vOnly;
+  uint8_t  reqSrcCurrent;
+  uint8_t  reserved;              //Keeps the size even, always 0
+
+  /*
+    Fills every field from a 5 x 8 byte NVM image. The PDO voltages, currents and
+	number are the values stored in the NVM, which are loaded into the volatile
+	registers at power up.
+  */
+  void decode(const uint8_t image[][8]);
+
+  /*
+    Replaces the PDO voltages, currents and number with the volatile values.
+	Parameter: pdoRegisters - the 12 bytes of DPM_SNK_PDO1-3 (0x85-0x90)
+	           pdoNumber    - the DPM_PDO_NUMB register
+  */
+  void decodePdos(const uint8_t pdoRegisters[12], uint8_t pdoNumber);
+
+  /*
+    Writes every field into a 5 x 8 byte NVM image, leaving the other bits unchanged.
+	Values are clamped the same way as the setters and write() do.
+  */
+  void encode(uint8_t image[][8]) const;
+
+  /*
+    Writes the PDO voltages and currents into the 12 bytes of DPM_SNK_PDO1-3,
+	leaving the other bits of the PDOs unchanged.
+  */
+  void encodePdos(uint8_t pdoRegisters[12]) const;
+
+  /*
+    Returns a mask of the fields that differ, see CONFIG_*.
+  */
+  uint32_t diff(const STUSB4500_Config &other) const;
+
+  bool operator==(const STUSB4500_Config &other) const
+  {
+    return memcmp(this, &other, sizeof(STUSB4500_Config)) == 0;
+  }
+
+  bool operator!=(const STUSB4500_Config &other) const
+  {
+    return !(*this == other);
+  }
+};
+
+static_assert(sizeof(STUSB4500_Config) == 28, "STUSB4500_Config must not contain padding");
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  Location of the STUSB4500 NVM parameters in the 5 x 8 byte sector image.
+
+  Each parameter is described by its sector and its bit range inside the
+  sector, counting bit 0 of byte 0 as offset 0 (the sector seen as a 64-bit
+  little-endian value). Parameters that straddle two bytes, like FLEX_I, are
+  therefore still a single contiguous range.
+
+  nvmGet()/nvmSet() extract and insert a field. The descriptors are constants,
+  so the shifts and masks are resolved at compile time and each access compiles
+  to the same code as a hand-written mask and shift.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_NVM_FIELDS_H
+#define STUSB4500_NVM_FIELDS_H
+
+#include <stdint.h>
+
+template<uint8_t Sector, uint8_t Offset, uint8_t Width>
+struct NvmField {
+  static const uint8_t  sector = Sector;
+  static const uint8_t  offset = Offset;
+  static const uint8_t  byte   = Offset / 8;
+  static const uint8_t  shift  = Offset % 8;
+  static const uint8_t  width  = Width;
+  static const uint16_t mask   = (1u << Width) - 1;
+  static const bool     split  = (Offset % 8) + Width > 8;
+
+  static_assert(Sector < 5, "The NVM has 5 sectors");
+  static_assert(Offset + Width <= 64, "A field must fit in its 8 byte sector");
+  static_assert((Offset % 8) + Width <= 16, "A field can span at most two bytes");
+};
+
+//                  Sector, bit offset, width          Bytes and bits
+typedef NvmField<1,  4,  2> NVM_GPIO_CFG;            //sector 1, byte 0, bits 4:5
+typedef NvmField<3, 16,  1> NVM_USB_COMM_CAPABLE;    //sector 3, byte 2, bit 0
+typedef NvmField<3, 17,  2> NVM_SNK_PDO_NUMB;        //sector 3, byte 2, bits 1:2
+typedef NvmField<3, 19,  1> NVM_SNK_UNCONS_POWER;    //sector 3, byte 2, bit 3
+typedef NvmField<3, 20,  4> NVM_I_SNK_PDO1;          //sector 3, byte 2, bits 4:7
+typedef NvmField<3, 28,  4> NVM_SHIFT_VBUS_HL1;      //sector 3, byte 3, bits 4:7
+typedef NvmField<3, 32,  4> NVM_I_SNK_PDO2;          //sector 3, byte 4, bits 0:3
+typedef NvmField<3, 36,  4> NVM_SHIFT_VBUS_LL2;      //sector 3, byte 4, bits 4:7
+typedef NvmField<3, 40,  4> NVM_SHIFT_VBUS_HL2;      //sector 3, byte 5, bits 0:3
+typedef NvmField<3, 44,  4> NVM_I_SNK_PDO3;          //sector 3, byte 5, bits 4:7
+typedef NvmField<3, 48,  4> NVM_SHIFT_VBUS_LL3;      //sector 3, byte 6, bits 0:3
+typedef NvmField<3, 52,  4> NVM_SHIFT_VBUS_HL3;      //sector 3, byte 6, bits 4:7
+typedef NvmField<4,  6, 10> NVM_V_SNK_PDO2;          //sector 4, byte 0 bits 6:7 and byte 1
+typedef NvmField<4, 16, 10> NVM_V_SNK_PDO3;          //sector 4, byte 2 and byte 3 bits 0:1
+typedef NvmField<4, 26, 10> NVM_I_SNK_PDO_FLEX;      //sector 4, byte 3 bits 2:7 and byte 4 bits 0:3
+typedef NvmField<4, 37,  2> NVM_POWER_OK_CFG;        //sector 4, byte 4, bits 5:6
+typedef NvmField<4, 51,  1> NVM_POWER_ONLY_ABOVE_5V; //sector 4, byte 6, bit 3
+typedef NvmField<4, 52,  1> NVM_REQ_SRC_CURRENT;     //sector 4, byte 6, bit 4
+
+template<class Field>
+inline uint16_t nvmGet(const uint8_t image[][8])
+{
+  uint16_t value = image[Field::sector][Field::byte] >> Field::shift;
+  if(Field::split) value |= (uint16_t)image[Field::sector][Field::byte+1] << (8 - Field::shift);
+
+  return value & Field::mask;
+}
+
+template<class Field>
+inline void nvmSet(uint8_t image[][8], uint16_t value)
+{
+  value &= Field::mask;
+
+  uint8_t &low = image[Field::sector][Field::byte];
+  low = (low & ~(uint8_t)(Field::mask << Field::shift)) | (uint8_t)(value << Field::shift);
+
+  if(Field::split)
+  {
+    uint8_t &high = image[Field::sector][Field::byte+1];
+    high = (high & ~(uint8_t)(Field::mask >> (8 - Field::shift))) | (uint8_t)(value >> (8 - Field::shift));
+  }
+}
+
+/*
+  Conversion between a current in 10mA units and the 4-bit current code used by
+  I_SNK_PDO1-3. Codes 1-10 are 0.5-2.75A in 0.25A steps, 11-15 are 3.0-5.0A in
+  0.5A steps, and 0 means the FLEX_I value is used instead.
+*/
+constexpr uint8_t nvmCurrentCode(uint16_t current)
+{
+  return current < 50 ? 0 : current <= 300 ? current/25 - 1 : current >= 500 ? 15 : current/50 + 5;
+}
+
+constexpr uint16_t nvmCurrentValue(uint8_t code)
+{
+  return code == 0 ? 0 : code < 11 ? code*25 + 25 : code*50 - 250;
+}
+
+/*
+  Returns a mask of the sectors that differ between two images (bit 0 = sector 0),
+  in the same format as the SECTOR_x erase flags.
+*/
+inline uint8_t nvmSectorDiff(const uint8_t a[][8], const uint8_t b[][8])
+{
+  uint8_t mask = 0;
+  for(uint8_t i=0; i<5; i++)
+  {
+    for(uint8_t j=0; j<8; j++)
+    {
+      if(a[i][j] != b[i][j])
+      {
+        mask |= (1<<i);
+        break;
+      }
+    }
+  }
+  return mask;
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+  Compile-time builder for the STUSB4500 NVM image.
+
+  STUSB4500_NvmImage starts from the factory defaults (the same values
+  write(DEFAULT) programs) and each call returns a copy with one parameter
+  changed. Everything is constexpr and the parameters are template arguments,
+  so an out of range value stops the build with a static_assert message
+  instead of being clamped at run time.
+
+  Example:
+    constexpr STUSB4500_NvmImage config = STUSB4500_NvmImage::defaults()
+      .pdoNumber<3>()
+      .voltage<2, 9000>().current<2, 3000>()
+      .voltage<3, 15000>().current<3, 2000>()
+      .upperVoltageLimit<3, 10>();
+
+    usb.writeImage(config);
+
+  Units are millivolts, milliamps and percent.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_NVM_IMAGE_H
+#define STUSB4500_NVM_IMAGE_H
+
+#include <stdint.h>
+#include "stusb4500_nvm_fields.h"
+
+struct STUSB4500_NvmImage {
+  uint64_t sector[5]; //Each sector as a little-endian 64-bit value, byte 0 in bits 0:7
+
+  static constexpr STUSB4500_NvmImage defaults()
+  {
+    return STUSB4500_NvmImage{{ 0x00004500AAB00000ULL, 0xDF3C01FF1C9C4010ULL, 0xF1FC0032000F4002ULL,
+                                0x005F35F5AF561900ULL, 0xFB40004321904B00ULL }};
+  }
+
+  //Constant shifts only: a shift by a variable count is a loop on 8-bit MCUs
+  constexpr uint8_t byte(uint8_t sectorNum, uint8_t byteNum) const
+  {
+    return byteNum == 0 ? (uint8_t)sector[sectorNum] :
+           byteNum == 1 ? (uint8_t)(sector[sectorNum] >> 8) :
+           byteNum == 2 ? (uint8_t)(sector[sectorNum] >> 16) :
+           byteNum == 3 ? (uint8_t)(sector[sectorNum] >> 24) :
+           byteNum == 4 ? (uint8_t)(sector[sectorNum] >> 32) :
+           byteNum == 5 ? (uint8_t)(sector[sectorNum] >> 40) :
+           byteNum == 6 ? (uint8_t)(sector[sectorNum] >> 48) :
+                          (uint8_t)(sector[sectorNum] >> 56);
+  }
+
+  //The five sectors as they are written to the NVM
+  void toBytes(uint8_t bytes[][8]) const
+  {
+    for(uint8_t i=0; i<5; i++)
+    {
+      uint32_t low = sector[i];
+      uint32_t high = sector[i] >> 32;
+      bytes[i][0] = low;
+      bytes[i][1] = low >> 8;
+      bytes[i][2] = low >> 16;
+      bytes[i][3] = low >> 24;
+      bytes[i][4] = high;
+      bytes[i][5] = high >> 8;
+      bytes[i][6] = high >> 16;
+      bytes[i][7] = high >> 24;
+    }
+  }
+
+  template<class Field> constexpr uint16_t get() const
+  {
+    return (sector[Field::sector] >> Field::offset) & Field::mask;
+  }
+
+  template<class Field> constexpr STUSB4500_NvmImage with(uint16_t value) const
+  {
+    return STUSB4500_NvmImage{{ insert<Field>(0, value), insert<Field>(1, value), insert<Field>(2, value),
+                                insert<Field>(3, value), insert<Field>(4, value) }};
+  }
+
+  template<uint8_t Pdo, uint16_t Millivolts> constexpr STUSB4500_NvmImage voltage() const
+  {
+    static_assert(Pdo == 2 || Pdo == 3, "Only the PDO2 and PDO3 voltages are stored in the NVM (PDO1 is fixed at 5V)");
+    static_assert(Millivolts >= 5000 && Millivolts <= 20000, "PDO voltage must be 5-20V");
+    static_assert(Millivolts % 50 == 0, "PDO voltage resolution is 50mV");
+    return Pdo == 2 ? with<NVM_V_SNK_PDO2>(Millivolts/50) : with<NVM_V_SNK_PDO3>(Millivolts/50);
+  }
+
+  template<uint8_t Pdo, uint16_t Milliamps> constexpr STUSB4500_NvmImage current() const
+  {
+    static_assert(Pdo >= 1 && Pdo <= 3, "PDO number must be 1-3");
+    static_assert(Milliamps == 0 || (Milliamps >= 500 && Milliamps <= 5000),
+                  "PDO current must be 0 (use FLEX_I) or 0.5-5A");
+    static_assert((Milliamps <= 3000 && Milliamps % 250 == 0) || Milliamps % 500 == 0,
+                  "PDO current must be a multiple of 0.25A up to 3A, and of 0.5A above");
+    return Pdo == 1 ? with<NVM_I_SNK_PDO1>(nvmCurrentCode(Milliamps/10)) :
+           Pdo == 2 ? with<NVM_I_SNK_PDO2>(nvmCurrentCode(Milliamps/10)) :
+                      with<NVM_I_SNK_PDO3>(nvmCurrentCode(Milliamps/10));
+  }
+
+  template<uint16_t Milliamps> constexpr STUSB4500_NvmImage flexCurrent() const
+  {
+    static_assert(Milliamps <= 5000, "FLEX_I must be 0-5A");
+    static_assert(Milliamps % 10 == 0, "FLEX_I resolution is 10mA");
+    return with<NVM_I_SNK_PDO_FLEX>(Milliamps/10);
+  }
+
+  template<uint8_t Value> constexpr STUSB4500_NvmImage pdoNumber() const
+  {
+    static_assert(Value >= 1 && Value <= 3, "Number of sink PDOs must be 1-3");
+    return with<NVM_SNK_PDO_NUMB>(Value);
+  }
+
+  template<uint8_t Pdo, uint8_t Percent> constexpr STUSB4500_NvmImage upperVoltageLimit() const
+  {
+    static_assert(Pdo >= 1 && Pdo <= 3, "PDO number must be 1-3");
+    static_assert(Percent >= 5 && Percent <= 20, "Upper voltage limit must be 5-20%");
+    return Pdo == 1 ? with<NVM_SHIFT_VBUS_HL1>(Percent-5) :
+           Pdo == 2 ? with<NVM_SHIFT_VBUS_HL2>(Percent-5) :
+                      with<NVM_SHIFT_VBUS_HL3>(Percent-5);
+  }
+
+  template<uint8_t Pdo, uint8_t Percent> constexpr STUSB4500_NvmImage lowerVoltageLimit() const
+  {
+    static_assert(Pdo == 2 || Pdo == 3, "Only PDO2 and PDO3 have a lower voltage limit (PDO1 is fixed at 3.3V)");
+    static_assert(Percent >= 5 && Percent <= 20, "Lower voltage limit must be 5-20%");
+    return Pdo == 2 ? with<NVM_SHIFT_VBUS_LL2>(Percent-5) : with<NVM_SHIFT_VBUS_LL3>(Percent-5);
+  }
+
+  template<bool Value> constexpr STUSB4500_NvmImage externalPower() const
+  {
+    return with<NVM_SNK_UNCONS_POWER>(Value);
+  }
+
+  template<bool Value> constexpr STUSB4500_NvmImage usbCommCapable() const
+  {
+    return with<NVM_USB_COMM_CAPABLE>(Value);
+  }
+
+  template<uint8_t Value> constexpr STUSB4500_NvmImage configOkGpio() const
+  {
+    static_assert(Value == 0 || Value == 2 || Value == 3, "POWER_OK_CFG must be 0, 2 or 3");
+    return with<NVM_POWER_OK_CFG>(Value);
+  }
+
+  template<uint8_t Value> constexpr STUSB4500_NvmImage gpioCtrl() const
+  {
+    static_assert(Value <= 3, "GPIO_CFG must be 0-3");
+    return with<NVM_GPIO_CFG>(Value);
+  }
+
+  template<bool Value> constexpr STUSB4500_NvmImage powerAbove5vOnly() const
+  {
+    return with<NVM_POWER_ONLY_ABOVE_5V>(Value);
+  }
+
+  template<bool Value> constexpr STUSB4500_NvmImage reqSrcCurrent() const
+  {
+    return with<NVM_REQ_SRC_CURRENT>(Value);
+  }
+
+  private:
+  template<class Field> constexpr uint64_t insert(uint8_t sectorNum, uint16_t value) const
+  {
+    return sectorNum != Field::sector ? sector[sectorNum] :
+           (sector[sectorNum] & ~((uint64_t)Field::mask << Field::offset)) |
+           ((uint64_t)(value & Field::mask) << Field::offset);
+  }
+};
+
+#endif
@@ -15,6 +15,8 @@
 #define TX_HEADER_LOW          0x51
 #define PD_COMMAND_CTRL        0x1A
 #define DPM_PDO_NUMB           0x70
+#define DPM_SNK_PDO1           0x85
+#define RDO_REG_STATUS         0x91
 
 #define READ                   0x00
 #define WRITE_PL               0x01
@@ -27,4 +29,48 @@
 #define SECTOR_1               0x02
 #define SECTOR_2               0x04
 #define SECTOR_3               0x08
-#define SECTOR_4               0x10
\ No newline at end of file
+#define SECTOR_4               0x10
+
+#define ALERT_STATUS_1         0x0B
+#define ALERT_STATUS_1_MASK    0x0C
+#define ALERT_PHY_STATUS       0x01   /* ALERT_STATUS_1 and ALERT_STATUS_1_MASK bits */
+#define ALERT_PRT_STATUS       0x02
+#define ALERT_PD_TYPEC_STATUS  0x08
+#define ALERT_HW_FAULT_STATUS  0x10
+#define ALERT_MONITORING_STATUS 0x20
+#define ALERT_CC_DETECTION_STATUS 0x40
+#define ALERT_HARD_RESET       0x80
+#define PORT_STATUS_0          0x0D
+#define PORT_STATUS_1          0x0E
+#define TYPEC_MONITORING_STATUS_0 0x0F
+#define TYPEC_MONITORING_STATUS_1 0x10
+#define CC_STATUS              0x11
+#define CC_HW_FAULT_STATUS_0   0x12
+#define CC_HW_FAULT_STATUS_1   0x13
+#define PD_TYPEC_STATUS        0x14
+#define TYPEC_STATUS           0x15
+#define PRT_STATUS             0x16
+#define STATUS_WINDOW_LENGTH   12     /* ALERT_STATUS_1 (0x0B) through PRT_STATUS (0x16) */
+
+#define RX_BYTE_CNT            0x30
+#define RX_HEADER              0x31   /* Header of the last PD message received, 2 bytes */
+#define RX_DATA_OBJ            0x33   /* Its data objects, up to 7 x 4 bytes */
+#define RX_MAX_DATA_OBJECTS    7
+#define PD_SOURCE_CAPABILITIES 0x01   /* Data message type in RX_HEADER bits 4:0 */
+
+#define PE_FSM                 0x29
+#define PE_INIT                0x00
+#define PE_SOFT_RESET          0x01
+#define PE_HARD_RESET          0x02
+#define PE_SEND_SOFT_RESET     0x03
+#define PE_SNK_STARTUP         0x12
+#define PE_SNK_DISCOVERY       0x13
+#define PE_SNK_WAIT_FOR_CAPABILITIES 0x14
+#define PE_SNK_EVALUATE_CAPABILITY   0x15
+#define PE_SNK_SELECT_CAPABILITY     0x16
+#define PE_SNK_TRANSITION_SINK 0x17
+#define PE_SNK_READY           0x18
+#define PE_SNK_READY_SENDING   0x19
+#define PE_HARD_RESET_SHUTDOWN 0x3A
+#define PE_HARD_RESET_RECOVERY 0x3B
+#define PE_ERRORRECOVERY       0x40
@@ -0,0 +1,185 @@
+/*
+  Binary record format used by STUSB4500_Telemetry, and a decoder for it.
+
+  This header has no Arduino dependencies so the same definitions can be
+  compiled into a host-side (PC) tool that parses the telemetry stream.
+
+  Record layout (multi-byte values are little-endian):
+    byte  0     - TELEMETRY_SYNC (0xA5)
+    byte  1     - sequence number, incremented for every record sent
+    bytes 2-5   - timestamp, millis() when the sample was taken
+    byte  6     - field mask, one bit per field included in the record
+    bytes 7-... - the included fields in bit order (see TELEMETRY_FIELD_*)
+    last byte   - CRC-8 (polynomial 0x07) of every byte before it
+
+  Only fields that changed since the previous record are included, except for
+  keyframes which carry all of them.
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_TELEMETRY_FORMAT_H
+#define STUSB4500_TELEMETRY_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define TELEMETRY_SYNC              0xA5
+#define TELEMETRY_HEADER_LENGTH     7
+
+#define TELEMETRY_FIELD_PDO1        0x01  //4 bytes, DPM_SNK_PDO1 register
+#define TELEMETRY_FIELD_PDO2        0x02  //4 bytes, DPM_SNK_PDO2 register
+#define TELEMETRY_FIELD_PDO3        0x04  //4 bytes, DPM_SNK_PDO3 register
+#define TELEMETRY_FIELD_PDO_NUMB    0x08  //1 byte,  DPM_PDO_NUMB register
+#define TELEMETRY_FIELD_RDO         0x10  //4 bytes, RDO_REG_STATUS register (negotiated contract)
+#define TELEMETRY_FIELD_STATUS      0x20  //12 bytes, ALERT_STATUS_1 through PRT_STATUS
+#define TELEMETRY_FIELD_ALL         0x3F
+
+#define TELEMETRY_STATE_LENGTH      29    //Sum of all field lengths
+#define TELEMETRY_MAX_RECORD_LENGTH (TELEMETRY_HEADER_LENGTH + TELEMETRY_STATE_LENGTH + 1)
+
+static const uint8_t telemetryFieldLength[6] = { 4, 4, 4, 1, 4, 12 };
+
+inline uint8_t telemetryCrc8(const uint8_t *data, uint8_t length, uint8_t crc = 0)
+{
+  while(length--)
+  {
+    crc ^= *data++;
+    for(uint8_t i=0; i<8; i++) crc = (crc & 0x80) ? (crc<<1) ^ 0x07 : (crc<<1);
+  }
+  return crc;
+}
+
+/*
+  Last known PD state, rebuilt from the telemetry stream.
+  The state[] bytes follow the field order: PDO1, PDO2, PDO3, PDO_NUMB, RDO, STATUS.
+*/
+struct STUSB4500_TelemetryState {
+  uint8_t  sequence;
+  uint32_t timestamp;
+  uint8_t  changed;   //Field mask of the last record
+  uint8_t  known;     //Fields received at least once since the decoder was reset
+  uint8_t  state[TELEMETRY_STATE_LENGTH];
+
+  uint32_t pdo(uint8_t pdo_numb) const { return field32((pdo_numb-1)*4); }
+  uint8_t  pdoNumber(void) const       { return state[12] & 0x07; }
+  uint32_t rdo(void) const             { return field32(13); }
+  const uint8_t *status(void) const    { return &state[17]; }
+
+  uint32_t field32(uint8_t offset) const
+  {
+    return (uint32_t)state[offset] | ((uint32_t)state[offset+1]<<8) |
+           ((uint32_t)state[offset+2]<<16) | ((uint32_t)state[offset+3]<<24);
+  }
+};
+
+/*
+  Byte-at-a-time parser for the telemetry stream. Bytes are skipped until a sync
+  byte is found, and records with a bad CRC are discarded. As a sync byte can also
+  appear inside a record, the bytes after a rejected one are scanned again so a
+  false sync does not swallow the records that follow it.
+*/
+class STUSB4500_TelemetryDecoder {
+  public:
+  STUSB4500_TelemetryDecoder(void) { reset(); }
+
+  void reset(void)
+  {
+    memset(&_state, 0, sizeof(_state));
+    _length = 0;
+    _records = 0;
+    _crcErrors = 0;
+    _lostRecords = 0;
+  }
+
+  /*
+    Feeds one byte of the stream to the decoder.
+	Returns true when a complete record was decoded and applied to state().
+  */
+  bool push(uint8_t c)
+  {
+    if(_length == 0 && c != TELEMETRY_SYNC) return false;
+
+    _buffer[_length++] = c;
+
+    while(_length >= TELEMETRY_HEADER_LENGTH)
+    {
+      uint8_t mask = _buffer[6];
+      uint8_t recordLength = TELEMETRY_HEADER_LENGTH + 1;
+      for(uint8_t i=0; i<6; i++)
+      {
+        if(mask & (1<<i)) recordLength += telemetryFieldLength[i];
+      }
+
+      //Not a valid header: rescan from the byte after the sync
+      if(mask & ~TELEMETRY_FIELD_ALL)
+      {
+        discard(1);
+        continue;
+      }
+
+      if(_length < recordLength) return false;
+
+      if(telemetryCrc8(_buffer, recordLength - 1) != _buffer[recordLength - 1])
+      {
+        _crcErrors++;
+        discard(1);
+        continue;
+      }
+
+      apply();
+      discard(recordLength);
+      return true;
+    }
+
+    return false;
+  }
+
+  const STUSB4500_TelemetryState &state(void) const { return _state; }
+  uint32_t records(void) const     { return _records; }
+  uint32_t crcErrors(void) const   { return _crcErrors; }
+  uint32_t lostRecords(void) const { return _lostRecords; }
+
+  private:
+  STUSB4500_TelemetryState _state;
+  uint8_t  _buffer[TELEMETRY_MAX_RECORD_LENGTH];
+  uint8_t  _length;
+  uint32_t _records;
+  uint32_t _crcErrors;
+  uint32_t _lostRecords;
+
+  void apply(void)
+  {
+    if(_records != 0) _lostRecords += (uint8_t)(_buffer[1] - _state.sequence - 1);
+    _records++;
+
+    _state.sequence = _buffer[1];
+    _state.timestamp = (uint32_t)_buffer[2] | ((uint32_t)_buffer[3]<<8) |
+                       ((uint32_t)_buffer[4]<<16) | ((uint32_t)_buffer[5]<<24);
+    _state.changed = _buffer[6];
+    _state.known |= _buffer[6];
+
+    uint8_t in = TELEMETRY_HEADER_LENGTH;
+    uint8_t out = 0;
+    for(uint8_t i=0; i<6; i++)
+    {
+      if(_buffer[6] & (1<<i))
+      {
+        memcpy(&_state.state[out], &_buffer[in], telemetryFieldLength[i]);
+        in += telemetryFieldLength[i];
+      }
+      out += telemetryFieldLength[i];
+    }
+  }
+
+  //Drops the first bytes of the buffer and anything up to the next sync byte
+  void discard(uint8_t count)
+  {
+    while(count < _length && _buffer[count] != TELEMETRY_SYNC) count++;
+    _length -= count;
+    memmove(_buffer, &_buffer[count], _length);
+  }
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+  I2C trace format used by STUSB4500_Trace, with a reader and a compare
+  function for captured traces.
+
+  This header has no Arduino dependencies so the same definitions can be
+  compiled into a host-side (PC) tool that loads a dumped trace.
+
+  Dump layout (multi-byte values are little-endian):
+    byte  0     - TRACE_MAGIC
+    byte  1     - TRACE_VERSION
+    byte  2     - I2C address of the STUSB4500
+    bytes 3-6   - number of entries that were overwritten before the dump
+    bytes 7-8   - number of entries that follow, oldest first
+  Each entry:
+    bytes 0-3   - timestamp, micros() at the end of the transaction
+    byte  4     - bit 7: 1 for a read, 0 for a write. bits 0-6: result (0 = success)
+    byte  5     - register
+    byte  6     - number of bytes transferred
+    bytes 7-... - the first min(length, TRACE_DATA_LENGTH) bytes transferred
+
+  For licence information see LICENSE.md
+  https://github.com/sparkfun/SparkFun_STUSB4500_Arduino_Library/blob/master/LICENSE.md
+*/
+
+#ifndef STUSB4500_TRACE_FORMAT_H
+#define STUSB4500_TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define TRACE_MAGIC                 0x54
+#define TRACE_VERSION               1
+#define TRACE_HEADER_LENGTH         9
+#define TRACE_ENTRY_HEADER_LENGTH   7
+#define TRACE_DATA_LENGTH           8    //Longer transfers keep only their first bytes
+
+#define TRACE_READ                  0x80
+#define TRACE_RESULT                0x7F
+
+struct STUSB4500_TraceEntry {
+  uint32_t time;
+  uint8_t  flags;
+  uint8_t  reg;
+  uint8_t  length;
+  uint8_t  data[TRACE_DATA_LENGTH];
+
+  bool    isRead(void) const  { return flags & TRACE_READ; }
+  uint8_t result(void) const  { return flags & TRACE_RESULT; }
+  uint8_t stored(void) const  { return length < TRACE_DATA_LENGTH ? length : TRACE_DATA_LENGTH; }
+};
+
+/*
+  Walks the entries of a dumped trace.
+*/
+class STUSB4500_TraceReader {
+  public:
+  /*
+    Returns false if the buffer doesn't start with a valid trace header.
+  */
+  bool begin(const uint8_t *dump, uint32_t length)
+  {
+    _dump = dump;
+    _length = length;
+    _offset = TRACE_HEADER_LENGTH;
+    _index = 0;
+    if(length < TRACE_HEADER_LENGTH || dump[0] != TRACE_MAGIC || dump[1] != TRACE_VERSION) return false;
+    return true;
+  }
+
+  uint8_t  address(void) const { return _dump[2]; }
+  uint32_t dropped(void) const { return get32(&_dump[3]); }
+  uint16_t count(void) const   { return _dump[7] | (_dump[8]<<8); }
+
+  /*
+    Reads the next entry. Returns false at the end of the trace.
+  */
+  bool next(STUSB4500_TraceEntry &entry)
+  {
+    if(_index >= count() || _offset + TRACE_ENTRY_HEADER_LENGTH > _length) return false;
+
+    const uint8_t *p = &_dump[_offset];
+    entry.time = get32(p);
+    entry.flags = p[4];
+    entry.reg = p[5];
+    entry.length = p[6];
+    if(_offset + TRACE_ENTRY_HEADER_LENGTH + entry.stored() > _length) return false;
+
+    memcpy(entry.data, &p[TRACE_ENTRY_HEADER_LENGTH], entry.stored());
+    _offset += TRACE_ENTRY_HEADER_LENGTH + entry.stored();
+    _index++;
+    return true;
+  }
+
+  private:
+  const uint8_t *_dump;
+  uint32_t _length;
+  uint32_t _offset;
+  uint16_t _index;
+
+  static uint32_t get32(const uint8_t *p)
+  {
+    return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24);
+  }
+};
+
+struct STUSB4500_TraceDiff {
+  uint16_t readsA;
+  uint16_t writesA;
+  uint16_t readsB;
+  uint16_t writesB;
+  int32_t  firstMismatch; //Index of the first entry that differs, -1 if none
+  int32_t  durationA;     //Time from the first to the last entry (microseconds)
+  int32_t  durationB;
+};
+
+/*
+  Compares two dumped traces. Entries match when they have the same direction,
+  register, length and, for writes, the same data. Timestamps are not compared.
+  Returns true if both traces contain the same sequence of transactions.
+*/
+inline bool traceCompare(const uint8_t *a, uint32_t aLength, const uint8_t *b, uint32_t bLength,
+                         STUSB4500_TraceDiff &diff)
+{
+  STUSB4500_TraceReader readerA, readerB;
+  STUSB4500_TraceEntry entryA, entryB;
+  uint32_t firstA = 0, lastA = 0, firstB = 0, lastB = 0;
+
+  memset(&diff, 0, sizeof(diff));
+  diff.firstMismatch = -1;
+
+  if(!readerA.begin(a, aLength) || !readerB.begin(b, bLength))
+  {
+    diff.firstMismatch = 0;
+    return false;
+  }
+
+  int32_t index = 0;
+  while(true)
+  {
+    bool moreA = readerA.next(entryA);
+    bool moreB = readerB.next(entryB);
+    if(!moreA && !moreB) break;
+
+    if(moreA)
+    {
+      if(entryA.isRead()) diff.readsA++; else diff.writesA++;
+      if(index == 0) firstA = entryA.time;
+      lastA = entryA.time;
+    }
+    if(moreB)
+    {
+      if(entryB.isRead()) diff.readsB++; else diff.writesB++;
+      if(index == 0) firstB = entryB.time;
+      lastB = entryB.time;
+    }
+
+    if(diff.firstMismatch < 0)
+    {
+      bool same = moreA && moreB && entryA.flags == entryB.flags && entryA.reg == entryB.reg &&
+                  entryA.length == entryB.length &&
+                  (entryA.isRead() || memcmp(entryA.data, entryB.data, entryA.stored()) == 0);
+      if(!same) diff.firstMismatch = index;
+    }
+    index++;
+  }
+
+  diff.durationA = lastA - firstA;
+  diff.durationB = lastB - firstB;
+
+  return diff.firstMismatch < 0;
+}
+
+#endif